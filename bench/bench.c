@@ -0,0 +1,352 @@
+#define _POSIX_C_SOURCE 200809L
+
+/*
+ * Zilo benchmark suite (`make bench`).
+ *
+ * Every result is one JSON object per line (JSON Lines) so runs can be
+ * diffed or loaded into a spreadsheet:
+ *
+ *   {"suite":"row","bench":"insert_char_mid","param":"row=80B","iters":..,
+ *    "ns_per_op_min":..,"ns_per_op_median":..,"mb_per_s":..}
+ *
+ * Each benchmark is repeated BENCH_REPS times; the minimum and the median
+ * are reported.
+ *
+ * usage: zilo-bench [-o results.jsonl] [-s 10M,100M,2G] [-d tmpdir]
+ */
+
+#include "edit.h"
+#include "file.h"
+#include "mem.h"
+#include "output.h"
+#include "page.h"
+#include "row.h"
+#include "zilo.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_REPS 5
+
+static FILE *g_out;
+
+static int64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int cmp_i64(const void *a, const void *b) {
+  int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief Print one result (JSON line to the output, summary to stderr).
+ *
+ * @param suite  Suite name.
+ * @param bench  Benchmark name.
+ * @param param  Parameters ("size=10M").
+ * @param iters  Operations per repetition.
+ * @param bytes  Bytes processed per repetition (0 if not meaningful).
+ * @param ns     Duration of each repetition.
+ */
+static void report(const char *suite, const char *bench, const char *param,
+                   long iters, int64_t bytes, int64_t ns[BENCH_REPS]) {
+  qsort(ns, BENCH_REPS, sizeof(int64_t), cmp_i64);
+  double min = (double)ns[0] / iters;
+  double median = (double)ns[BENCH_REPS / 2] / iters;
+  double mbps = bytes ? bytes / (ns[BENCH_REPS / 2] / 1e9) / 1e6 : 0;
+
+  fprintf(g_out, "{\"suite\":\"%s\",\"bench\":\"%s\",\"param\":\"%s\",\"iters\":%ld,"
+                 "\"ns_per_op_min\":%.1f,\"ns_per_op_median\":%.1f,\"mb_per_s\":%.1f}\n",
+          suite, bench, param, iters, min, median, mbps);
+  fflush(g_out);
+
+  fprintf(stderr, "%-6s %-22s %-16s %12.1f ns/op", suite, bench, param, median);
+  if (bytes) fprintf(stderr, " %10.1f MB/s", mbps);
+  fprintf(stderr, "\n");
+}
+
+/**
+ * @brief Reset the editor to an empty buffer of the given screen size.
+ */
+static void bench_reset(int rows, int cols) {
+  free_editor();
+  init_editor();
+  E.screenrows = rows;
+  E.screencols = cols;
+}
+
+/**
+ * @brief Fill `buf` with a line of words (some tabs and UTF-8) of `len` bytes.
+ */
+static void make_line(char *buf, int len, unsigned *seed) {
+  static const char *words[] = {
+    "int", "return", "editor", "row", "{", "}", "/* note */", "\"str\"",
+    "42", "\t", "naïve", "日本", "size", "x", "->", "buffer",
+  };
+  int n = 0;
+  while (n < len) {
+    *seed = *seed * 1103515245 + 12345;
+    const char *w = words[(*seed >> 16) % (sizeof(words) / sizeof(words[0]))];
+    int wl = strlen(w);
+    if (n + wl + 1 > len) break;
+    memcpy(buf + n, w, wl);
+    n += wl;
+    buf[n ++] = ' ';
+  }
+  while (n < len) buf[n ++] = 'x';
+}
+
+/*------------------------------------------
+              ROW / EDIT
+ ------------------------------------------*/
+static void bench_row_chars(int row_len) {
+  char param[32];
+  snprintf(param, sizeof(param), "row=%dB", row_len);
+
+  char *line = malloc(row_len);
+  unsigned seed = 1;
+  make_line(line, row_len, &seed);
+
+  const long iters = 20000;
+  int64_t ins[BENCH_REPS], del[BENCH_REPS];
+
+  for (int r = 0; r < BENCH_REPS; ++ r) {
+    bench_reset(24, 80);
+    editor_insert_row(0, line, row_len);
+    erow_t *row = editor_row_at(0);
+
+    // Insert/remove pairs keep the row at its nominal size
+    ins[r] = del[r] = 0;
+    for (long i = 0; i < iters; ++ i) {
+      int64_t t0 = now_ns();
+      editor_row_insert_char(row, row_len / 2, 'a' + i % 26);
+      int64_t t1 = now_ns();
+      editor_row_remove_char(row, row_len / 2);
+      int64_t t2 = now_ns();
+
+      ins[r] += t1 - t0;
+      del[r] += t2 - t1;
+    }
+  }
+
+  report("row", "insert_char_mid", param, iters, 0, ins);
+  report("row", "remove_char_mid", param, iters, 0, del);
+  free(line);
+}
+
+static void bench_edit_rows(int nrows) {
+  char param[32];
+  snprintf(param, sizeof(param), "rows=%d", nrows);
+
+  char line[80];
+  unsigned seed = 2;
+  make_line(line, sizeof(line), &seed);
+
+  const long iters = 2000;
+  int64_t ins[BENCH_REPS], del[BENCH_REPS];
+
+  for (int r = 0; r < BENCH_REPS; ++ r) {
+    bench_reset(24, 80);
+    for (int i = 0; i < nrows; ++ i) editor_insert_row(E.numrows, line, sizeof(line));
+
+    int64_t t0 = now_ns();
+    for (long i = 0; i < iters; ++ i) editor_insert_row(E.numrows / 2, line, sizeof(line));
+    int64_t t1 = now_ns();
+    for (long i = 0; i < iters; ++ i) editor_del_row(E.numrows / 2);
+    int64_t t2 = now_ns();
+
+    ins[r] = t1 - t0;
+    del[r] = t2 - t1;
+  }
+
+  report("edit", "insert_row_mid", param, iters, 0, ins);
+  report("edit", "del_row_mid", param, iters, 0, del);
+}
+
+/*------------------------------------------
+              FILE LOAD / SAVE
+ ------------------------------------------*/
+/**
+ * @brief Parse "10M", "2G", "512K" or a byte count.
+ */
+static int64_t parse_size(const char *s) {
+  char *end;
+  double v = strtod(s, &end);
+  switch (*end) {
+    case 'K': case 'k': v *= 1024; break;
+    case 'M': case 'm': v *= 1024 * 1024; break;
+    case 'G': case 'g': v *= 1024.0 * 1024 * 1024; break;
+    default: break;
+  }
+  return (int64_t)v;
+}
+
+/**
+ * @brief Write a file of about `size` bytes of 20..120 byte lines.
+ */
+static int generate_file(const char *path, int64_t size) {
+  FILE *fp = fopen(path, "w");
+  if (!fp) return -1;
+
+  char line[128];
+  unsigned seed = 3;
+  int64_t written = 0;
+  while (written < size) {
+    seed = seed * 1103515245 + 12345;
+    int len = 20 + (seed >> 16) % 100;
+    make_line(line, len, &seed);
+    line[len] = '\n';
+    if (fwrite(line, 1, len + 1, fp) != (size_t)len + 1) {
+      fclose(fp);
+      return -1;
+    }
+    written += len + 1;
+  }
+
+  return fclose(fp);
+}
+
+static void bench_file(const char *dir, const char *size_str) {
+  int64_t size = parse_size(size_str);
+  if (size <= 0) return;
+
+  char path[512], out[512], param[32];
+  snprintf(path, sizeof(path), "%s/zilo-bench-%s.txt", dir, size_str);
+  snprintf(out, sizeof(out), "%s/zilo-bench-%s.out", dir, size_str);
+  snprintf(param, sizeof(param), "size=%s", size_str);
+
+  if (generate_file(path, size) == -1) {
+    fprintf(stderr, "bench: cannot generate <%s>\n", path);
+    unlink(path);
+    return;
+  }
+
+  // Large files are repeated fewer times (the minimum is still reported)
+  int reps = size > (int64_t)512 * 1024 * 1024 ? 1 : BENCH_REPS;
+  int64_t load[BENCH_REPS], save[BENCH_REPS];
+
+  for (int r = 0; r < BENCH_REPS; ++ r) {
+    if (r >= reps) {
+      load[r] = load[0];
+      save[r] = save[0];
+      continue;
+    }
+
+    bench_reset(24, 80);
+    int64_t t0 = now_ns();
+    editor_open(path);
+    int64_t t1 = now_ns();
+
+    zilo_free(MEM_FILE, E.filename);
+    E.filename = zilo_strdup(MEM_FILE, out);
+    int64_t t2 = now_ns();
+    editor_save();
+    int64_t t3 = now_ns();
+
+    load[r] = t1 - t0;
+    save[r] = t3 - t2;
+  }
+
+  report("file", "load", param, 1, size, load);
+  report("file", "save", param, 1, size, save);
+
+  bench_reset(24, 80);
+  unlink(path);
+  unlink(out);
+}
+
+/*------------------------------------------
+              FRAME BUILDING
+ ------------------------------------------*/
+static void bench_frames(int rows, int cols, bool wrap) {
+  char param[32];
+  snprintf(param, sizeof(param), "%dx%d%s", cols, rows, wrap ? ",wrap" : "");
+
+  // Frames are written to /dev/null
+  int saved = dup(STDOUT_FILENO);
+  int null = open("/dev/null", O_WRONLY);
+  if (saved == -1 || null == -1) return;
+  dup2(null, STDOUT_FILENO);
+  close(null);
+
+  bench_reset(rows, cols);
+  E.filename = zilo_strdup(MEM_FILE, "bench.c");
+  char line[160];
+  unsigned seed = 4;
+  for (int i = 0; i < 10000; ++ i) {
+    int len = 20 + i % 140;
+    make_line(line, len, &seed);
+    editor_insert_row(E.numrows, line, len);
+  }
+  E.wrap = wrap;
+
+  const long iters = 200;
+  int64_t ns[BENCH_REPS];
+  for (int r = 0; r < BENCH_REPS; ++ r) {
+    int64_t t0 = now_ns();
+    for (long i = 0; i < iters; ++ i) {
+      // Scroll a line per frame so nothing is reused between frames
+      E.cy = (i * 7) % E.numrows;
+      editor_refresh_screen();
+    }
+    ns[r] = now_ns() - t0;
+  }
+
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+
+  report("frame", "refresh_screen", param, iters, 0, ns);
+}
+
+int main(int argc, char *argv[]) {
+  const char *out_path = NULL;
+  const char *sizes = "10M,100M";
+  const char *dir = "/tmp";
+
+  int opt;
+  while ((opt = getopt(argc, argv, "o:s:d:")) != -1) {
+    switch (opt) {
+      case 'o': out_path = optarg; break;
+      case 's': sizes = optarg; break;
+      case 'd': dir = optarg; break;
+      default:
+        fprintf(stderr, "usage: zilo-bench [-o results.jsonl] [-s 10M,100M,2G] [-d tmpdir]\n");
+        return 1;
+    }
+  }
+
+  g_out = out_path ? fopen(out_path, "w") : stdout;
+  if (!g_out) {
+    fprintf(stderr, "bench: cannot open <%s>\n", out_path);
+    return 1;
+  }
+
+  init_editor();
+
+  bench_row_chars(80);
+  bench_row_chars(4096);
+  bench_edit_rows(1000);
+  bench_edit_rows(100000);
+
+  char *list = strdup(sizes);
+  for (char *tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+    bench_file(dir, tok);
+  }
+  free(list);
+
+  bench_frames(24, 80, false);
+  bench_frames(60, 200, false);
+  bench_frames(120, 400, false);
+  bench_frames(60, 200, true);
+
+  free_editor();
+  if (g_out != stdout) fclose(g_out);
+  return 0;
+}
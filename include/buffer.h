@@ -0,0 +1,102 @@
+#ifndef ZILO_BUFFER_H
+#define ZILO_BUFFER_H
+
+#include "zilo.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define WINDOW_MAX 16   // Most windows on screen at once
+
+// Cursor and scroll position of a view
+typedef struct {
+  int cx, cy, rx;
+  int rowoff, coloff, lineoff;
+} view_t;
+
+// A loaded file: its rows and what is derived from them
+typedef struct buffer {
+  int id;                       // Unique, never reused (high bits of `generation`)
+  row_store_t rows;
+  int numrows;
+  uint64_t generation;
+  char *filename;
+  int64_t file_bytes;
+  bool file_eol;
+  int file_rows;
+  int modified_rows;
+  uint64_t file_hash;
+  file_stamp_t file_stamp;
+  file_stamp_t file_refused;
+  const editor_syntax_t *syntax;
+  wrap_index_t wrap_index;
+  struct cold_file *page;       // File clean rows are paged from (see cold.h)
+  view_t last;                  // Where the last window showing it was
+} buffer_t;
+
+// A part of the screen showing a buffer
+typedef struct {
+  buffer_t *buf;
+  view_t view;
+  int height;                   // Text rows (a status bar follows)
+} window_t;
+
+// The windows of one client of the daemon (see daemon.h)
+typedef struct {
+  window_t win[WINDOW_MAX];
+  int nwin;
+  int cur;
+} layout_t;
+
+// Show `filename` in the current window, loading it unless a buffer already has it (`:e`).
+int editor_buffer_edit(const char *filename);
+
+// Id of the buffer loaded in E.
+int editor_buffer_id(void);
+
+// Show the next (`dir` 1) or previous (-1) buffer in the current window (`:bn`, `:bp`).
+void editor_buffer_cycle(int dir);
+
+// Describe the buffers in `out` (`:ls`).
+void editor_buffer_list(char *out, size_t size);
+
+// Split the current window in two, both showing its buffer (`:sp`). Returns -1 if there is no room.
+int editor_window_split(void);
+
+// Close the current window unless it is the last one (`:close`).
+int editor_window_close(void);
+
+// Close every window but the current one (`:only`).
+void editor_window_only(void);
+
+// Move to the next window (Ctrl-W).
+void editor_window_next(void);
+
+// Number of windows on screen (1 without splits).
+int editor_window_count(void);
+
+// Index of the current window.
+int editor_window_current(void);
+
+// Load window `i` into E (drawing). Call again with the current window to go back.
+void editor_window_enter(int i);
+
+// Screen row of the first text row of window `i`.
+int editor_window_top(int i);
+
+// Text rows of the whole screen (the message bar is on the last one).
+int editor_window_screen_rows(void);
+
+// Park the buffer and view in E and the windows into `out`; E is left with no rows.
+void editor_layout_park(layout_t *out);
+
+// Load a layout parked by editor_layout_park().
+void editor_layout_load(const layout_t *in);
+
+// Start a layout of one window showing `filename` while none is loaded. Returns -1 on failure.
+int editor_layout_open(const char *filename);
+
+// Free every buffer that is not loaded in E and forget the windows.
+void editor_buffers_free(void);
+
+#endif // !ZILO_BUFFER_H
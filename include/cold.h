@@ -0,0 +1,91 @@
+#ifndef ZILO_COLD_H
+#define ZILO_COLD_H
+
+#include "zilo.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define COLD_BLOCK_BYTES  (64 * 1024)             // Uncompressed bytes gathered in one block
+#define COLD_MIN_CACHE    (4 * COLD_BLOCK_BYTES)  // Smallest cache of decompressed blocks
+#define COLD_DEFAULT_MIB  64                      // Budget of `:set compress`
+
+struct cold_file;   // A file clean rows are paged from (one per buffer)
+
+// Counters of the compressed rows
+typedef struct {
+  int64_t rows;         // Compressed rows
+  int64_t blocks;       // Blocks holding them
+  int64_t raw_bytes;    // Their uncompressed size
+  int64_t zip_bytes;    // Their compressed size
+  int64_t cache_bytes;  // Decompressed blocks kept in the cache
+  int64_t temp_bytes;   // Compressed bytes spilled to the temp file
+  int64_t file_blocks;  // Blocks re-read from the loaded file
+} cold_stats_t;
+
+// Compress rows far from the view once row memory passes `budget` bytes (0 turns it off).
+void editor_cold_set_budget(int64_t budget);
+
+// The current budget (0 when off).
+int64_t editor_cold_budget(void);
+
+// Row memory counted against the budget.
+int64_t editor_cold_resident(void);
+
+// Compress rows far from the view if row memory is over the budget. Returns the rows compressed.
+int editor_cold_sweep(void);
+
+// Bytes of a compressed row (valid until the next call into this module), NULL on failure.
+const char *editor_cold_bytes(const erow_t *row);
+
+// Give a compressed row (in E.row) its bytes back. Returns -1 on failure.
+int editor_row_thaw(erow_t *row);
+
+// Drop the block reference of a compressed row being freed.
+void editor_cold_release(erow_t *row);
+
+// Snapshot the counters.
+void editor_cold_stats(cold_stats_t *out);
+
+// Let sweeps drop pages and blocks to the loaded file or a temp file (`zilo --page`, see page.h).
+void editor_page_enable(bool on);
+
+// True while paging is on.
+bool editor_page_enabled(void);
+
+// Read clean pages back from `fd` (the file being loaded or saved; it is duplicated). Returns -1 on failure.
+int editor_page_attach(int fd);
+
+// Stop reading pages from the loaded file, moving them to the temp file. Returns -1 on failure.
+int editor_page_detach(void);
+
+// Move every page read from `path` to the temp file before it is rewritten. Returns -1 on failure.
+int editor_page_detach_path(const char *path);
+
+// Attach `file` (taken from a parked buffer, may be NULL) and return the file attached so far.
+struct cold_file *editor_page_swap(struct cold_file *file);
+
+// Drop a reference to a file returned by editor_page_swap() or taken with editor_page_hold().
+void editor_page_release(struct cold_file *file);
+
+// The file attached to the buffer being edited (NULL if none).
+struct cold_file *editor_page_file(void);
+
+// True if rows up to offset `end` of `file` may be dropped to it (paging on, file unchanged).
+bool editor_page_file_fits(const struct cold_file *file, int64_t end);
+
+// Take a reference to `file`.
+void editor_page_hold(struct cold_file *file);
+
+// Read `len` bytes at `pos` of `file` (the caller checks them). Returns -1 on failure.
+int editor_page_read(struct cold_file *file, int64_t pos, char *buf, int64_t len);
+
+// Append `len` bytes to the temp file. Returns their offset, -1 on failure.
+int64_t editor_spill_write(const char *buf, int64_t len);
+
+// Read back `len` bytes written at `pos` by editor_spill_write(). Returns -1 on failure.
+int editor_spill_read(int64_t pos, char *buf, int64_t len);
+
+// Forget `len` bytes of the temp file.
+void editor_spill_free(int64_t len);
+
+#endif // !ZILO_COLD_H
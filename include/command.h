@@ -0,0 +1,13 @@
+#ifndef ZILO_COMMAND_H
+#define ZILO_COMMAND_H
+
+// Start typing a command line (':' in Normal mode).
+void editor_command_start(void);
+
+// Handle a key typed on the command line.
+void editor_command_keypress(char c);
+
+// Execute a command line (without the leading ':').
+void editor_command_execute(const char *line);
+
+#endif // !ZILO_COMMAND_H
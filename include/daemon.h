@@ -0,0 +1,18 @@
+#ifndef ZILO_DAEMON_H
+#define ZILO_DAEMON_H
+
+#include <stddef.h>
+
+#define DAEMON_MAX_CLIENTS 32     // Clients attached at once
+#define DAEMON_HELLO_MAX   4352   // Longest first line a client sends ("ZILO1 rows cols path\n")
+
+// Path of the daemon socket ($XDG_RUNTIME_DIR/zilo.sock, or /tmp/zilo-<uid>.sock).
+void editor_daemon_socket_path(char *out, size_t size);
+
+// Serve clients on the socket until SIGINT or SIGTERM (`zilo --daemon`). Returns the exit status.
+int editor_daemon_run(void);
+
+// Edit `filename` in a running daemon from this terminal. Returns -1 if no daemon of this user answers.
+int editor_client_run(const char *filename);
+
+#endif // !ZILO_DAEMON_H
@@ -1,10 +1,33 @@
 #ifndef ZILO_FILE_H
 #define ZILO_FILE_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 // Open the file, read its contents, and fill E.row.
 void editor_open(char *filename);
 
-// Save the edited content.
-void editor_save(void);
+// Append bytes that follow the end of the buffer as rows (the last row stays open until a newline).
+// `origin` is their offset in the file, -1 if they come from elsewhere.
+void editor_append_text(const char *buf, int len, int64_t origin);
+
+// Save the edited content (only the rows that changed, if the file is still what was read).
+// Returns -1 if the file was not saved.
+int editor_save(void);
+
+// The rows were extended with what the file gained (follow mode): describe the file as it is now.
+void editor_file_grown(int fd);
+
+// Read E.filename again in place of the rows. Returns -1 on failure.
+int editor_file_reload(void);
+
+// True if the rows differ from the file as last loaded or saved (compared by hash).
+bool editor_file_modified(void);
+
+// True if the file on disk is no longer what was last loaded or saved.
+bool editor_file_changed(void);
+
+// Rows [*from, *to) differ from lines [*from, *disk_to) of the file on disk. Returns 1, 0 if equal, -1 on failure.
+int editor_file_diff(int *from, int *to, int *disk_to);
 
 #endif // !ZILO_FILE_H
@@ -0,0 +1,21 @@
+#ifndef ZILO_FOLLOW_H
+#define ZILO_FOLLOW_H
+
+#include <stdbool.h>
+
+// Start following E.filename (append what the file gains, reload if it is replaced).
+int editor_follow_start(void);
+
+// Stop following.
+void editor_follow_stop(void);
+
+// True while follow mode is on.
+bool editor_follow_active(void);
+
+// The inotify descriptor to poll (-1 when not following).
+int editor_follow_fd(void);
+
+// Consume inotify events and bring the rows up to date. Returns true if they changed.
+bool editor_follow_poll(void);
+
+#endif // !ZILO_FOLLOW_H
@@ -0,0 +1,66 @@
+#ifndef ZILO_HEX_H
+#define ZILO_HEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define HEX_LINE_BYTES 16   // Bytes per line of the hex view
+
+// Which half of a line the cursor edits
+typedef enum {
+  HEX_PANE_HEX = 0,   // Two hex digits per byte
+  HEX_PANE_ASCII,     // One character per byte
+} hex_pane_e;
+
+// A file shown as bytes, straight from a private mapping
+typedef struct {
+  char *filename;
+  int fd;                // Kept open for the save
+  unsigned char *data;   // Mapping of the file (NULL if it is empty)
+  int64_t size;
+  bool readonly;         // The file could not be opened for writing
+  int64_t off;           // Byte under the cursor
+  int64_t top;           // First line on screen
+  hex_pane_e pane;
+  int nibble;            // Digit of the byte being typed in the hex pane (0: high, 1: low)
+  uint64_t *dirty;       // Pages written to since the last save (sorted, each once)
+  int ndirty;
+  int dirtycap;
+} hex_view_t;
+
+// The hex view of a session that is not being served (daemon mode)
+typedef struct {
+  hex_view_t view;
+  bool active;
+  bool standalone;
+  bool quit_warned;
+} hex_park_t;
+
+// Show `filename` as bytes instead of the rows (`zilo --hex`, `:hex`). Returns -1 on failure.
+int editor_hex_open(const char *filename);
+
+// Leave the hex view (unsaved bytes are dropped).
+void editor_hex_close(void);
+
+// The hex view, NULL when the rows are shown.
+hex_view_t *editor_hex(void);
+
+// Apply a key while the hex view is shown.
+void editor_hex_key(char c);
+
+// Move the cursor to byte `off` (`:go`).
+void editor_hex_goto(int64_t off);
+
+// Scroll so that the cursor is on one of `rows` screen lines.
+void editor_hex_scroll(int rows);
+
+// Write the changed pages back to the file. Returns -1 on failure.
+int editor_hex_save(void);
+
+// Move the hex view out to `out` (none is shown afterwards).
+void editor_hex_park(hex_park_t *out);
+
+// Show the hex view parked in `in`.
+void editor_hex_load(const hex_park_t *in);
+
+#endif // !ZILO_HEX_H
@@ -3,7 +3,10 @@
 
 #define CTRL_KEY(k) ((k) & 0x1f)
 
-// Handling key input.
+// Handling key input (read one key from the terminal and apply it).
 void editor_process_keypress(void);
 
+// Apply one key in the current mode.
+void editor_process_key(char c);
+
 #endif // !ZILO_INPUT_H
@@ -0,0 +1,30 @@
+#ifndef ZILO_INTERN_H
+#define ZILO_INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Counters of the interning table
+typedef struct {
+  int64_t strings;    // Distinct payloads
+  int64_t refs;       // Rows pointing at them
+  int64_t bytes;      // Bytes held by the payloads
+  int64_t saved;      // Bytes the extra references would have cost as copies
+} intern_stats_t;
+
+// Fast 64-bit hash of `len` bytes.
+uint64_t intern_hash(const char *s, size_t len);
+
+// Shared, read-only copy of `len` bytes of `s` ('\0' terminated), with one more reference.
+char *intern_get(const char *s, size_t len);
+
+// Take one more reference to a string returned by intern_get().
+char *intern_ref(char *s);
+
+// Drop a reference to a string returned by intern_get().
+void intern_release(char *s);
+
+// Snapshot the counters.
+void intern_stats(intern_stats_t *out);
+
+#endif // !ZILO_INTERN_H
@@ -0,0 +1,60 @@
+#ifndef ZILO_LINEIDX_H
+#define ZILO_LINEIDX_H
+
+#include "lline.h"
+#include "zilo.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#define LINE_INDEX_STRIDE     ROW_PAGE_ROWS       // Lines of an indexed run (one page of rows)
+#define LINE_INDEX_MIN_BYTES  (4 * 1024 * 1024)   // Smaller files are not indexed
+#define LINE_INDEX_TAIL       4096                // Bytes checked to accept an appended file
+
+// Result of line_index_load()
+typedef enum {
+  LINE_INDEX_MISS = 0,   // No usable index: build it from the whole file
+  LINE_INDEX_EXACT,      // The index covers the file as it is
+  LINE_INDEX_APPENDED,   // The file grew: read on from the end of the runs
+} line_index_state_e;
+
+// LINE_INDEX_STRIDE consecutive lines of the file, each ended by '\n'
+typedef struct {
+  int64_t pos;      // Offset of the first line
+  int64_t len;      // Bytes, line breaks included
+  int64_t crlf;     // Lines ended by "\r\n"
+  lhash_t text;     // Hash of the lines, as pages keep it (see page_hash_add())
+  uint64_t eol;
+} line_run_t;
+
+// Sparse line index of a file: the runs of its first lines
+typedef struct {
+  line_run_t *runs;
+  int64_t count;
+  int64_t cap;
+  line_run_t cur;   // The run being fed
+  int cur_lines;    // Its lines so far
+} line_index_t;
+
+// Initialize an empty index.
+void line_index_init(line_index_t *idx);
+
+// Release the index.
+void line_index_free(line_index_t *idx);
+
+// Account the next line of the file: at `origin`, `len` bytes, then "\r\n" (`crlf`) or '\n'.
+void line_index_add(line_index_t *idx, int64_t origin, int len, bool crlf, uint64_t hash);
+
+// Offset of the end of the last run (0 if there is none).
+int64_t line_index_end(const line_index_t *idx);
+
+// Load the cached index of `path` (identified by `st`) and check it still applies.
+line_index_state_e line_index_load(line_index_t *idx, const char *path, const struct stat *st);
+
+// Store the index of `path`, read up to offset `size`, in the cache directory.
+int line_index_save(const line_index_t *idx, const char *path, const struct stat *st, int64_t size);
+
+// Forget the cached index of `path` (it was rewritten).
+void line_index_drop(const char *path);
+
+#endif // !ZILO_LINEIDX_H
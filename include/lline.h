@@ -0,0 +1,107 @@
+#ifndef ZILO_LLINE_H
+#define ZILO_LLINE_H
+
+#include <stdint.h>
+
+// Rows longer than this are stored in chunks (long-line mode)
+#define LLINE_THRESHOLD   (64 * 1024)
+// Long rows shorter than this go back to a flat buffer
+#define LLINE_FLATTEN     (LLINE_THRESHOLD / 2)
+// Chunks are filled to LLINE_CHUNK bytes and split once they exceed LLINE_CHUNK_MAX
+#define LLINE_CHUNK       4096
+#define LLINE_CHUNK_MAX   (2 * LLINE_CHUNK)
+
+typedef struct {
+  char *data;     // Chunk bytes (always starts and ends on a UTF-8 character boundary)
+  int len;        // Number of bytes
+  int width;      // Display width (a tab counts as ZILO_TAB_STOP columns)
+  uint64_t hash;  // Polynomial hash of the bytes (see lline_hash_bytes())
+  uint64_t pow;   // The base raised to `len` (shifts a hash past the chunk)
+} lchunk_t;
+
+// Hash and shift of a run of chunks (a node of the hash tree), or of lines (see page.h)
+typedef struct {
+  uint64_t hash;
+  uint64_t pow;
+} lhash_t;
+
+// Hashes are polynomials modulo the prime 2^61 - 1 (see lline.c)
+#define LHASH_MOD  ((1ULL << 61) - 1)
+#define LHASH_BASE 0x16a09e667f3bcc9ULL
+
+static inline uint64_t lhash_mul(uint64_t a, uint64_t b) {
+  __uint128_t p = (__uint128_t)a * b;
+  uint64_t r = (uint64_t)(p & LHASH_MOD) + (uint64_t)(p >> 61);
+  r = (r & LHASH_MOD) + (r >> 61);
+  return r >= LHASH_MOD ? r - LHASH_MOD : r;
+}
+
+static inline uint64_t lhash_add(uint64_t a, uint64_t b) {
+  uint64_t r = a + b;
+  return r >= LHASH_MOD ? r - LHASH_MOD : r;
+}
+
+// The run `a` followed by the run `b`.
+static inline lhash_t lhash_join(lhash_t a, lhash_t b) {
+  return (lhash_t){ lhash_add(lhash_mul(a.hash, b.pow), b.hash), lhash_mul(a.pow, b.pow) };
+}
+
+// A run of one element of any 64-bit value.
+static inline lhash_t lhash_one(uint64_t v) {
+  return (lhash_t){ v % LHASH_MOD, LHASH_BASE };
+}
+
+// A long row: chunks plus Fenwick trees over their lengths and widths, and a
+// segment tree folding their hashes in order
+typedef struct lline {
+  lchunk_t *chunks;
+  int nchunks;
+  int cap;
+  int *len_tree;    // Fenwick tree over chunk lengths (1-based)
+  int *width_tree;  // Fenwick tree over chunk widths (1-based)
+  lhash_t *hash_tree; // Segment tree over chunk hashes (root at 1, leaves from `hash_leaves`)
+  int hash_leaves;  // Leaves of `hash_tree` (a power of two >= nchunks)
+  int size;         // Total bytes
+  int width;        // Total display width
+} lline_t;
+
+// Build a long row from `len` bytes of `s`.
+lline_t *lline_new(const char *s, int len);
+
+// Release a long row.
+void lline_free(lline_t *ll);
+
+// Insert `len` bytes of `s` at byte offset `at`.
+void lline_insert(lline_t *ll, int at, const char *s, int len);
+
+// Delete `len` bytes starting at byte offset `at`.
+void lline_delete(lline_t *ll, int at, int len);
+
+// Copy `len` bytes starting at byte offset `at` into `dst`.
+void lline_read(const lline_t *ll, int at, int len, char *dst);
+
+// Overwrite the byte at offset `at`.
+void lline_set_byte(lline_t *ll, int at, char c);
+
+// Convert a byte offset into a display column.
+int lline_cx_to_rx(const lline_t *ll, int cx);
+
+// Convert a display column into the byte offset of the character covering it.
+int lline_rx_to_cx(const lline_t *ll, int rx);
+
+// Byte offset of the next character.
+int lline_next_char(const lline_t *ll, int cx);
+
+// Byte offset of the previous character.
+int lline_prev_char(const lline_t *ll, int cx);
+
+// Display width of the character starting at `s` (`len` bytes available).
+int lline_char_width(const char *s, int len, int *n);
+
+// Polynomial hash of `len` bytes (the same bytes in a long row give lline_hash()).
+uint64_t lline_hash_bytes(const char *s, int len);
+
+// Hash of the bytes of a long row (kept up to date by every edit: O(1)).
+uint64_t lline_hash(const lline_t *ll);
+
+#endif // !ZILO_LLINE_H
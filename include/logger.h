@@ -6,17 +6,53 @@ typedef enum {
   LOG_DEBUG = 0,
   LOG_INFO,
   LOG_WARN,
-  LOG_ERROR
+  LOG_ERROR,
+  LOG_OFF             // Only used as a threshold
 } log_level_e;
 
+// Log modules, each with its own runtime level.
+// A source file picks its module by defining ZILO_LOG_MODULE before any include.
+typedef enum {
+  LOG_MODULE_CORE = 0,
+  LOG_MODULE_RENDER,
+  LOG_MODULE_INPUT,
+  LOG_MODULE_FILE,
+  LOG_MODULE_EDIT,
+  LOG_MODULE_COUNT
+} log_module_e;
+
+#ifndef ZILO_LOG_MODULE
+#define ZILO_LOG_MODULE LOG_MODULE_CORE
+#endif
+
+// Compile-time minimum level (0 = DEBUG ... 4 = OFF).
+// Log sites below it compile to nothing (set with `make LOG_MIN_LEVEL=n`).
+#ifndef ZILO_LOG_MIN_LEVEL
+#define ZILO_LOG_MIN_LEVEL 0
+#endif
+
+// Runtime level of each module (LOG_OFF until the log file is open)
+extern unsigned char zilo_log_levels[LOG_MODULE_COUNT];
+
+// What a producer does when the log ring buffer is full
+typedef enum {
+  LOG_OVERFLOW_DROP = 0,  // Discard the record (the count is logged later)
+  LOG_OVERFLOW_BLOCK      // Wait until the writer thread makes room
+} log_overflow_e;
 
-// Initialize the log system (open the log file).
+// Initialize the log system (open the log file, read ZILO_LOG_LEVEL).
 void zilo_log_init(const char *filename);
 
-// Close the log system.
+// Close the log system (pending records are flushed).
 void zilo_log_close(void);
 
-// The core print function.
+// Set the runtime level of one module.
+void zilo_log_set_level(log_module_e module, log_level_e level);
+
+// Choose what happens when the log ring buffer is full.
+void zilo_log_set_overflow(log_overflow_e policy);
+
+// The core print function (queues the record for the writer thread).
 void zilo_log_write(log_level_e level, 
                     const char *func,
                     const char *file, 
@@ -25,16 +61,41 @@ void zilo_log_write(log_level_e level,
 
 // External Interface (Macros)
 // Use `##VA_ARGS` to handle variadic argguments.
-#define LOG_DEBUG(func, fmt, ...) \
-  zilo_log_write(LOG_DEBUG, func, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
-  
-#define LOG_INFO(func, fmt, ...) \
-  zilo_log_write(LOG_INFO, func, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+// An enabled site costs one branch on the module level before the arguments
+// are evaluated; a site below ZILO_LOG_MIN_LEVEL is type-checked and dropped.
+#define ZILO_LOG(level, func, fmt, ...) \
+  do { \
+    if (__builtin_expect((level) >= zilo_log_levels[ZILO_LOG_MODULE], 0)) \
+      zilo_log_write(level, func, __FILE__, __LINE__, fmt, ##__VA_ARGS__); \
+  } while (0)
+
+#define ZILO_LOG_NOTHING(func, fmt, ...) \
+  do { \
+    if (0) zilo_log_write(LOG_OFF, func, __FILE__, __LINE__, fmt, ##__VA_ARGS__); \
+  } while (0)
+
+#if ZILO_LOG_MIN_LEVEL <= 0
+#define LOG_DEBUG(func, fmt, ...) ZILO_LOG(LOG_DEBUG, func, fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(func, fmt, ...) ZILO_LOG_NOTHING(func, fmt, ##__VA_ARGS__)
+#endif
+
+#if ZILO_LOG_MIN_LEVEL <= 1
+#define LOG_INFO(func, fmt, ...) ZILO_LOG(LOG_INFO, func, fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(func, fmt, ...) ZILO_LOG_NOTHING(func, fmt, ##__VA_ARGS__)
+#endif
 
-#define LOG_WARN(func, fmt, ...) \
-  zilo_log_write(LOG_WARN, func, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#if ZILO_LOG_MIN_LEVEL <= 2
+#define LOG_WARN(func, fmt, ...) ZILO_LOG(LOG_WARN, func, fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN(func, fmt, ...) ZILO_LOG_NOTHING(func, fmt, ##__VA_ARGS__)
+#endif
 
-#define LOG_ERROR(func, fmt, ...) \
-  zilo_log_write(LOG_ERROR, func, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#if ZILO_LOG_MIN_LEVEL <= 3
+#define LOG_ERROR(func, fmt, ...) ZILO_LOG(LOG_ERROR, func, fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(func, fmt, ...) ZILO_LOG_NOTHING(func, fmt, ##__VA_ARGS__)
+#endif
 
 #endif // !ZILO_LOGGER_H
@@ -0,0 +1,13 @@
+#ifndef ZILO_LZ_H
+#define ZILO_LZ_H
+
+// Largest output of lz_compress() for `len` input bytes
+#define LZ_BOUND(len) ((len) + (len) / 255 + 16)
+
+// Compress `len` bytes of `src` into `dst` (`cap` bytes). Returns the compressed size, -1 if it does not fit.
+int lz_compress(const char *src, int len, char *dst, int cap);
+
+// Decompress `len` bytes of `src` into `dst` (`cap` bytes). Returns the decompressed size, -1 if the input is corrupt.
+int lz_decompress(const char *src, int len, char *dst, int cap);
+
+#endif // !ZILO_LZ_H
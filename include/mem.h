@@ -0,0 +1,66 @@
+#ifndef ZILO_MEM_H
+#define ZILO_MEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Allocation tags (one per subsystem)
+typedef enum {
+  MEM_ROWS = 0,     // Row bytes (flat rows and long-line chunks)
+  MEM_ROW_ARRAY,    // Row pages and their descriptors (E.rows)
+  MEM_RENDER,       // Per-row render caches (render, cx2rx, cx2rb)
+  MEM_FRAME,        // Output buffer of a frame
+  MEM_SYNTAX,       // Highlight spans
+  MEM_WRAP,         // Soft-wrap index
+  MEM_FILE,         // Load/save buffers, file names
+  MEM_LOGGER,       // Log ring buffer
+  MEM_POOL,         // Worker pool jobs and queues
+  MEM_SNAPSHOT,     // Read-only row snapshots handed to workers
+  MEM_UNDO,         // Undo history
+  MEM_SEARCH,       // Search state
+  MEM_INTERN,       // Shared row payloads and their hash table
+  MEM_COLD,         // Compressed row blocks and the cache of decompressed ones
+  MEM_TAG_COUNT
+} mem_tag_e;
+
+// Counters of one tag
+typedef struct {
+  int64_t live;       // Bytes currently allocated
+  int64_t peak;       // Highest value of `live`
+  int64_t allocs;     // malloc/calloc/strdup calls
+  int64_t reallocs;   // realloc calls
+  int64_t frees;      // free calls
+  int64_t failures;   // Allocations that returned NULL
+} mem_stats_t;
+
+// Tagged malloc.
+void *zilo_malloc(mem_tag_e tag, size_t size);
+
+// Tagged calloc.
+void *zilo_calloc(mem_tag_e tag, size_t n, size_t size);
+
+// Tagged realloc: on failure NULL is returned and `ptr` is left untouched.
+void *zilo_realloc(mem_tag_e tag, void *ptr, size_t size);
+
+// Tagged strdup.
+char *zilo_strdup(mem_tag_e tag, const char *s);
+
+// Free memory from the zilo_* allocators (NULL is allowed).
+void zilo_free(mem_tag_e tag, void *ptr);
+
+// Account memory that is not allocated through the wrappers (static buffers).
+void zilo_mem_account(mem_tag_e tag, int64_t delta);
+
+// Snapshot the counters of one tag.
+void zilo_mem_stats(mem_tag_e tag, mem_stats_t *out);
+
+// Allocations (malloc/calloc/strdup/realloc calls) of every tag so far.
+int64_t zilo_mem_allocs(void);
+
+// Format "mem <live> peak <peak>" for the status bar.
+int zilo_mem_status(char *buf, int size);
+
+// Write the per-subsystem memory report to the log.
+void zilo_mem_report(void);
+
+#endif // !ZILO_MEM_H
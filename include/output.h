@@ -8,4 +8,10 @@ void editor_refresh_screen(void);
 // Set status message.
 void editor_set_status_message(const char *fmt, ...);
 
+// Takes a whole frame instead of standard output (a client of the daemon).
+typedef void (*editor_frame_sink_t)(const char *frame, int len, void *arg);
+
+// Hand the next frames to `sink` (NULL: write them to standard output).
+void editor_set_output_sink(editor_frame_sink_t sink, void *arg);
+
 #endif // !ZILO_OUTPUT_H
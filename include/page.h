@@ -0,0 +1,120 @@
+#ifndef ZILO_PAGE_H
+#define ZILO_PAGE_H
+
+#include "lline.h"
+#include "zilo.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Where the rows of a page are
+typedef enum {
+  PAGE_RESIDENT = 0,  // In `rows`
+  PAGE_IN_FILE,       // The lines at `pos` of `file`, as they were loaded or saved
+  PAGE_IN_TEMP,       // Written to the temp file at `pos` (see page.c)
+} page_state_e;
+
+// A run of consecutive rows: about ROW_PAGE_ROWS, split at twice as many
+typedef struct row_page {
+  erow_t *rows;           // The rows (NULL while paged out)
+  int n;                  // Number of rows
+  int cap;                // Room in `rows`
+  page_state_e state;
+  unsigned pinned;        // Sweep epoch of the last editor_row_at() on the page
+  bool used;              // Read back since the clock hand passed
+  bool keep;              // Left where it is in the file by the save under way
+  unsigned char hl_end;   // Lexer state at the end of the last row (HL_STATE_UNKNOWN: never lexed)
+
+  // While paged out
+  int modified;           // Rows counted in E.modified_rows
+  int64_t bytes;          // Bytes of the rows, one '\n' each
+  bool clean;             // The rows are the lines at `file_pos` on of the last load or save, in order
+  int64_t file_pos;
+  lhash_t text;           // Line hashes of the rows (see page_hash_add())
+  uint64_t eol;           // Their line breaks ("\r\n" counts 1), with the shifts of `text`
+  int64_t pos;            // IN_FILE: offset in `file`; IN_TEMP: offset in the temp file
+  int64_t len;            // Bytes at `pos`
+  struct cold_file *file; // IN_FILE: the file
+  struct row_page *file_prev, *file_next;   // Pages IN_FILE, of every buffer
+} row_page_t;
+
+// Counters of the pages of every buffer
+typedef struct {
+  int64_t pages;      // Pages
+  int64_t in_file;    // Pages to be read back from their file
+  int64_t in_temp;    // Pages spilled to the temp file
+  int64_t temp_bytes; // Bytes they take there
+} page_stats_t;
+
+// Add a line (its hash, see editor_hash_line(), and its line break) to the hash of a run of lines.
+static inline void page_hash_add(lhash_t *text, uint64_t *eol, uint64_t line, bool crlf) {
+  *text = lhash_join(*text, lhash_one(line));
+  *eol = lhash_add(lhash_mul(*eol, LHASH_BASE), crlf);
+}
+
+// Add the hash of a run of lines (`text`, `eol`) to the hash of the lines before it.
+static inline void page_hash_join(lhash_t *text, uint64_t *eol, lhash_t more, uint64_t more_eol) {
+  *eol = lhash_add(lhash_mul(*eol, more.pow), more_eol);
+  *text = lhash_join(*text, more);
+}
+
+// Row `at` of E, read back first if its page is out (it then stays until the next sweep).
+erow_t *editor_row_at(int at);
+
+// Row `at` of E for a pass over many rows: pages passed before may be dropped on the way.
+erow_t *editor_row_scan(int at);
+
+// Row `at` of E if its page is in memory, NULL otherwise.
+erow_t *editor_row_peek(int at);
+
+// First row after the page holding row `at`.
+int editor_row_page_end(int at);
+
+// Lexer state at the end of row `at`, whether or not its page is in memory.
+unsigned char editor_row_end_state(int at);
+
+// Index in E of a row handed out by editor_row_at() or editor_row_scan().
+int editor_row_index(const erow_t *row);
+
+// Insert `row` (taken over) at `at` in E. Returns -1 on failure (the row is not taken).
+int editor_rows_insert(int at, const erow_t *row);
+
+// Append `n` rows that are the lines at `pos` of the attached file, left there. Returns -1 on failure.
+int editor_rows_append_file(int n, int64_t pos, int64_t len, int64_t bytes, lhash_t text, uint64_t eol);
+
+// Remove row `at` from E (its memory was released by the caller).
+void editor_rows_remove(int at);
+
+// Free every row of E, paged out or not (E.modified_rows follows).
+void editor_rows_clear(void);
+
+// Free the rows of a parked buffer.
+void editor_rows_free(row_store_t *rows);
+
+// Bytes of the rows of E, one '\n' each.
+int64_t editor_rows_bytes(void);
+
+// Hash of the rows of E as lines of a file (see page_hash_add()).
+void editor_rows_hash(lhash_t *text, uint64_t *eol);
+
+// Leave in the file the pages a save to it from offset 0 does not move (`size`: its size, -1: none).
+void editor_rows_keep(int64_t size);
+
+// If row `at` starts a page left in the file, its rows in `*n`: returns its bytes (0 otherwise).
+int64_t editor_rows_kept(int at, int *n);
+
+// The rows were saved (`ok`) as the lines of the file attached: pages read from it again.
+void editor_rows_saved(bool ok);
+
+// Move every page read from `file` to the temp file (it is about to change). Returns -1 on failure.
+int editor_pages_detach_file(struct cold_file *file);
+
+// A sweep point: the pages faulted in so far may be dropped again.
+void editor_pages_unpin(void);
+
+// Drop pages far from the view until row memory is back to `target`. Returns the pages dropped.
+int editor_pages_trim(int64_t target);
+
+// Snapshot the counters.
+void editor_pages_stats(page_stats_t *out);
+
+#endif // !ZILO_PAGE_H
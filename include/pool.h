@@ -0,0 +1,56 @@
+#ifndef ZILO_POOL_H
+#define ZILO_POOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Status passed to the completion of a job whose token was cancelled
+#define POOL_CANCELLED (-1)
+
+typedef struct pool_job pool_job_t;
+typedef struct pool_token pool_token_t;
+
+// Job body, run on a worker thread. Returns a status for the completion.
+typedef int (*pool_work_fn)(pool_job_t *job, void *arg);
+
+// Progress report, run on the main thread (only the latest value is delivered).
+typedef void (*pool_progress_fn)(void *arg, int64_t done, int64_t total);
+
+// Completion, run on the main thread (`status` is POOL_CANCELLED if cancelled).
+typedef void (*pool_done_fn)(void *arg, int status);
+
+// Create a cancellation token (one reference, shared by every job it is given to).
+pool_token_t *pool_token_new(void);
+
+// Ask every job holding `token` to stop.
+void pool_token_cancel(pool_token_t *token);
+
+// True once the token was cancelled.
+bool pool_token_cancelled(const pool_token_t *token);
+
+// Drop a reference to the token.
+void pool_token_release(pool_token_t *token);
+
+// Queue a job (the pool is started on first use). Returns -1 on failure.
+int pool_submit(pool_token_t *token, pool_work_fn work,
+                pool_progress_fn progress, pool_done_fn done, void *arg);
+
+// Called by a job body: true if it should return early.
+bool pool_job_cancelled(const pool_job_t *job);
+
+// Called by a job body: report how far it got.
+void pool_job_progress(pool_job_t *job, int64_t done, int64_t total);
+
+// File descriptor that becomes readable when results are waiting (-1 before the pool starts).
+int pool_wake_fd(void);
+
+// Run pending progress and completion callbacks (main thread). Returns how many ran.
+int pool_dispatch(void);
+
+// Number of jobs queued or running.
+int pool_busy(void);
+
+// Cancel every job, wait for the workers and run the remaining completions.
+void pool_shutdown(void);
+
+#endif // !ZILO_POOL_H
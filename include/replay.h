@@ -0,0 +1,18 @@
+#ifndef ZILO_REPLAY_H
+#define ZILO_REPLAY_H
+
+#include <stdbool.h>
+
+// Start recording every key read from the terminal into `path`.
+int editor_record_start(const char *path);
+
+// Append one key to the recording (no-op when not recording).
+void editor_record_key(char c);
+
+// Stop recording and close the trace file.
+void editor_record_stop(void);
+
+// Replay a key trace on `filename` against a pseudo-terminal and report costs.
+int editor_replay(const char *trace, char *filename, bool timed);
+
+#endif // !ZILO_REPLAY_H
@@ -2,11 +2,35 @@
 #define ZILO_ROW_H
 
 #include "zilo.h"
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+
+// Characters of a flat row (NULL for long rows, which live in `ll`; compressed rows must be thawed first).
+static inline char *editor_row_chars(const erow_t *row) {
+  return row->is_inline ? (char *)row->buf : row->chars;
+}
+
+// The row holds the line at `origin` of the file (by hash: it may have been edited back to it).
+static inline bool editor_row_in_file(const erow_t *row) {
+  return row->origin >= 0 && row->hash == row->file_hash;
+}
+
+// Hash of `len` bytes of a line (the value of `hash` for a row with these bytes).
+uint64_t editor_hash_line(const char *s, size_t len);
+
+// Record that the row is the line at `origin` of the file (just loaded or saved).
+void editor_row_set_origin(erow_t *row, int64_t origin, bool crlf);
+
+// Initialize the row object `row` with a copy of the string `s`.
+int editor_row_init(erow_t *row, char *s, size_t len);
 
 // Append the string `s` (length `len`) as a new line to the end of the editor.
 void editor_append_row(char *s, size_t len);
 
+// Make the rows already loaded share their payloads. Returns the number of shared rows.
+int editor_intern_rows(void);
+
 // Insert the character `c` at position `at` in row.
 void editor_row_insert_char(erow_t *row, int at, int c);
 
@@ -19,7 +43,49 @@ void editor_row_remove_range(erow_t *row, int start, int len);
 // Concatenate the string to the end of row.
 void editor_row_append_string(erow_t *row, char *s, size_t len);
 
-// Release memory for one row.
+// Refresh the derived data of a row (render cache, highlighting) after its content changed.
+void editor_update_row(erow_t *row);
+
+// Rebuild the hash and render cache of a row read back from a page (no change is counted).
+void editor_row_restore(erow_t *row);
+
+// Return the rendered bytes of a row.
+const char *editor_row_render(const erow_t *row);
+
+// Convert a byte offset into a display column.
+int editor_row_cx_to_rx(const erow_t *row, int cx);
+
+// Convert a byte offset into an offset in the render buffer.
+int editor_row_cx_to_rb(const erow_t *row, int cx);
+
+// Convert a display column into the byte offset of the character that covers it.
+int editor_row_rx_to_cx(const erow_t *row, int rx);
+
+// Move a byte offset back to the start of its character.
+int editor_row_char_start(const erow_t *row, int cx);
+
+// Byte offset of the next character.
+int editor_row_next_char(const erow_t *row, int cx);
+
+// Byte offset of the previous character.
+int editor_row_prev_char(const erow_t *row, int cx);
+
+// Concatenate the bytes [from, size) of row `src` to the end of `dst`.
+void editor_row_append_row(erow_t *dst, const erow_t *src, int from);
+
+// Overwrite the byte at position `at` (Replace mode).
+void editor_row_set_char(erow_t *row, int at, int c);
+
+// Copy `len` bytes of a row starting at `at` into `dst` (any storage). Returns -1 on failure.
+int editor_row_read(const erow_t *row, int at, int len, char *dst);
+
+// Row `at` of E, read back and thawed if needed (for drawing). NULL if its page cannot be read.
+erow_t *editor_row(int at);
+
+// Release memory for one row of E.
 void editor_free_row(erow_t *row);
 
+// Release memory for a row not counted in E (not yet inserted, or parked).
+void editor_row_release(erow_t *row);
+
 #endif // !ZILO_ROW_H
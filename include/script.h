@@ -0,0 +1,8 @@
+#ifndef ZILO_SCRIPT_H
+#define ZILO_SCRIPT_H
+
+// Apply the key script `path` to every file (in parallel), save and exit.
+// Returns the number of files that failed.
+int editor_run_script(const char *path, char **files, int nfiles);
+
+#endif // !ZILO_SCRIPT_H
@@ -0,0 +1,36 @@
+#ifndef ZILO_SNAPSHOT_H
+#define ZILO_SNAPSHOT_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Read-only view of the rows, safe to read from any thread
+typedef struct {
+  atomic_int refs;
+  uint64_t generation;  // E.generation when it was taken
+  int numrows;
+  int64_t size;         // Bytes of the rows, one '\n' per row included
+  const char **rows;    // Bytes of every row (an interned payload or a copy in `data`)
+  int *lens;            // Length of every row
+  char **held;          // Interned payloads the snapshot holds a reference to
+  int nheld;
+  char **data;          // Blocks of copies of the rows that cannot be shared
+  int ndata;
+} row_snapshot_t;
+
+// Snapshot the current rows (main thread). Row payloads are shared, not copied.
+row_snapshot_t *editor_snapshot_take(void);
+
+// Drop a reference (main thread).
+void editor_snapshot_release(row_snapshot_t *snap);
+
+// Stop handing out the current snapshot (the buffer is being freed).
+void editor_snapshot_forget(void);
+
+// Bytes of row `i` (without the '\n').
+static inline const char *snapshot_row(const row_snapshot_t *snap, int i, int *len) {
+  *len = snap->lens[i];
+  return snap->rows[i];
+}
+
+#endif // !ZILO_SNAPSHOT_H
@@ -0,0 +1,40 @@
+#ifndef ZILO_STATS_H
+#define ZILO_STATS_H
+
+#include <stdint.h>
+
+// Log-linear (HDR) histogram: 64 linear sub-buckets per power of two,
+// so any recorded value is known to within ~1.6%.
+#define HIST_SUB_BITS   6
+#define HIST_SUB        (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS    (HIST_SUB + (63 - HIST_SUB_BITS) * (HIST_SUB / 2))
+
+typedef struct {
+  uint64_t counts[HIST_BUCKETS];
+  uint64_t total;
+  int64_t min;
+  int64_t max;
+} hist_t;
+
+// Record one value (nanoseconds, bytes or a count) in O(1).
+void hist_record(hist_t *h, int64_t value);
+
+// Value below which `p` percent of the recorded values fall.
+int64_t hist_percentile(const hist_t *h, double p);
+
+// A key was read (starts a keystroke-to-frame measurement).
+void editor_stats_key_read(void);
+
+// A frame of `bytes` bytes was built and written between `start_ns` and `end_ns`, with `allocs` allocations.
+void editor_stats_frame(int64_t start_ns, int64_t end_ns, int64_t bytes, int64_t allocs);
+
+// Monotonic clock in nanoseconds.
+int64_t editor_stats_now(void);
+
+// Format the keystroke latency "p50 .. p99 ..ms" and the median frame size for the status bar.
+int editor_stats_status(char *buf, int size);
+
+// Write the latency, frame cost, frame size and frame allocation summaries to the log.
+void editor_stats_report(void);
+
+#endif // !ZILO_STATS_H
@@ -0,0 +1,24 @@
+#ifndef ZILO_STREAM_H
+#define ZILO_STREAM_H
+
+#include <stdbool.h>
+
+#define STREAM_READ_SIZE  65536               // Largest chunk read at once
+#define STREAM_QUEUE_MAX  (8 * 1024 * 1024)   // Bytes read ahead of the editor before the reader waits
+
+// Read `fd` (stdin for `zilo -`) on a background thread and append it to the buffer loaded in E.
+int editor_stream_start(int fd);
+
+// Stop reading and close the descriptor.
+void editor_stream_stop(void);
+
+// True until the end of the input has been appended.
+bool editor_stream_active(void);
+
+// The descriptor to poll for new chunks (-1 when not reading).
+int editor_stream_fd(void);
+
+// Append the chunks read so far. Returns true if the rows changed.
+bool editor_stream_poll(void);
+
+#endif // !ZILO_STREAM_H
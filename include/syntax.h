@@ -0,0 +1,52 @@
+#ifndef ZILO_SYNTAX_H
+#define ZILO_SYNTAX_H
+
+// Highlight classes (stored in `hl_span_t.hl`)
+typedef enum {
+  HL_NORMAL = 0,
+  HL_COMMENT,
+  HL_KEYWORD1,
+  HL_KEYWORD2,
+  HL_STRING,
+  HL_NUMBER,
+  HL_PREPROC,
+} editor_highlight_e;
+
+// End-of-line lexer state (stored in `erow_t.hl_state`)
+typedef enum {
+  HL_STATE_NORMAL = 0,    // Nothing is open at the end of the line
+  HL_STATE_COMMENT,       // Inside a multi-line comment
+  HL_STATE_STRING,        // Inside a string continued with a trailing '\'
+  HL_STATE_UNKNOWN = 0xff // The row has never been lexed
+} editor_hl_state_e;
+
+#define HL_DEFAULT_COLOR      39  // SGR code of the default foreground
+
+#define HL_HIGHLIGHT_NUMBERS  (1 << 0)
+#define HL_HIGHLIGHT_STRINGS  (1 << 1)
+#define HL_HIGHLIGHT_PREPROC  (1 << 2)
+
+// Language description
+typedef struct {
+  const char *filetype;           // Name shown in the status bar
+  const char **filematch;         // File extensions (".c") or base names ("Makefile")
+  const char **keywords;          // Keywords, a trailing '|' marks a type (HL_KEYWORD2)
+  const char *singleline_comment_start;
+  const char *multiline_comment_start;
+  const char *multiline_comment_end;
+  int flags;                      // HL_HIGHLIGHT_* bits
+} editor_syntax_t;
+
+// Select the language for E.filename (E.syntax is NULL if nothing matches).
+void editor_select_syntax(void);
+
+// Re-lex rows starting at `at` until the end-of-line state converges.
+int editor_update_syntax(int at);
+
+// Re-lex every row in memory (used after the language changes).
+void editor_update_syntax_all(void);
+
+// Return the SGR color code of a highlight class.
+int editor_syntax_to_color(int hl);
+
+#endif // !ZILO_SYNTAX_H
@@ -1,6 +1,8 @@
 #ifndef ZILO_TERMINAL_H
 #define ZILO_TERMINAL_H
 
+#include <stdbool.h>
+
 #define ANSI_CLEAR_SCREEN       "\x1b[2J"         // Clear screen
 #define ANSI_CURSOR_HOME        "\x1b[H"          // Move the cursor back to the top left corner
 #define ANSI_CURSOR_HIDE        "\x1b[?25l"       // Hide cursor
@@ -8,9 +10,12 @@
 #define ANSI_CLEAR_LINE         "\x1b[K"          // Clear the content from the cursor to the end of the line
 #define ANSI_REVERSE_DISPLAY    "\x1b[7m"         // Enable reverse dislplay
 #define ANSI_RESET              "\x1b[m"          // Reset attributes
+#define ANSI_COLOR_FMT          "\x1b[%dm"        // Set foreground color (SGR code)
 #define ANSI_CURSOR_SHAPE_BLOCK "\x1b[2 q"        // Cursor shape (Block)
 #define ANSI_CURSOR_SHAPE_BAR   "\x1b[6 q"        // Cursor shape (Bar)
 
+#define EDITOR_WAIT_FDS 4   // Descriptors editor_wait_input() can watch besides the terminal
+
 // Enable terminal 'Raw' mode.
 void enable_raw_mode(void);
 
@@ -23,6 +28,9 @@ void set_cursor_shape_block(void);
 // Read a key.
 char editor_readkey(void);
 
+// Wait until a key can be read (true) or one of `fds` becomes readable (false).
+bool editor_wait_input(const int *fds, int nfds);
+
 // Get window size of terminal.
 int get_window_size(int *rows, int *cols);
 
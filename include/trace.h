@@ -0,0 +1,46 @@
+#ifndef ZILO_TRACE_H
+#define ZILO_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// A span being measured (see TRACE_SPAN)
+typedef struct {
+  const char *name;   // String literal, never copied
+  int64_t start_ns;   // 0 when tracing is off
+} trace_span_t;
+
+// True while spans are recorded (ZILO_TRACE is set)
+extern bool zilo_trace_enabled;
+
+// Start tracing if ZILO_TRACE=path is set.
+void zilo_trace_init(void);
+
+// Write every recorded span to the trace file (Chrome/Perfetto JSON).
+int zilo_trace_dump(void);
+
+// Dump the trace and stop tracing.
+void zilo_trace_close(void);
+
+// Monotonic clock in nanoseconds.
+int64_t zilo_trace_now(void);
+
+// Record a finished span into the calling thread's buffer.
+void zilo_trace_record(const char *name, int64_t start_ns, int64_t end_ns);
+
+// Cleanup handler of TRACE_SPAN.
+static inline void zilo_trace_span_end(trace_span_t *span) {
+  if (span->start_ns) zilo_trace_record(span->name, span->start_ns, zilo_trace_now());
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+// Measure the rest of the enclosing block as a span called `name`.
+// When tracing is off this costs one branch on entry and one on exit.
+#define TRACE_SPAN(name) \
+  trace_span_t TRACE_CONCAT(trace_span_, __LINE__) \
+  __attribute__((cleanup(zilo_trace_span_end))) = \
+    { (name), __builtin_expect(zilo_trace_enabled, 0) ? zilo_trace_now() : 0 }
+
+#endif // !ZILO_TRACE_H
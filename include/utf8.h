@@ -0,0 +1,23 @@
+#ifndef ZILO_UTF8_H
+#define ZILO_UTF8_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define UTF8_REPLACEMENT_CHAR     0xFFFD
+#define UTF8_REPLACEMENT_BYTES    "\xef\xbf\xbd"
+
+// Return true if `c` is a UTF-8 continuation byte (10xxxxxx).
+#define UTF8_IS_CONT(c) (((unsigned char)(c) & 0xC0) == 0x80)
+
+// Decode one code point from `s` (at most `len` bytes).
+int utf8_decode(const char *s, int len, uint32_t *cp);
+
+// Return the display width of a code point (0, 1 or 2).
+int utf8_width(uint32_t cp);
+
+// Return true if every byte of `s` is printable ASCII (0x20 ~ 0x7e).
+bool utf8_is_plain_ascii(const char *s, size_t len);
+
+#endif // !ZILO_UTF8_H
@@ -0,0 +1,42 @@
+#ifndef ZILO_WRAP_H
+#define ZILO_WRAP_H
+
+#include "zilo.h"
+
+// Mark the visual-line index stale (every row is measured again at the next query).
+void editor_wrap_invalidate(void);
+
+// A row was inserted at `at` (O(log n)).
+void editor_wrap_insert_row(int at);
+
+// Row `at` was deleted (O(log n)).
+void editor_wrap_delete_row(int at);
+
+// Free the blocks of an index.
+void editor_wrap_free(wrap_index_t *wi);
+
+// Refresh the visual-line count of row `at` after its content changed.
+void editor_wrap_update_row(int at);
+
+// Number of visual lines of row `at`.
+int editor_wrap_row_lines(int at);
+
+// Index of the first visual line of row `at` (`at == E.numrows` gives the total).
+int editor_wrap_row_to_line(int at);
+
+// Map a visual line to its row and the visual line inside that row.
+int editor_wrap_line_to_row(int line, int *sub);
+
+// Byte offset where the visual line starting at `cx` ends.
+int editor_wrap_segment_end(const erow_t *row, int cx);
+
+// Byte offset where visual line `sub` of the row starts.
+int editor_wrap_segment_start(const erow_t *row, int sub);
+
+// Visual line of the row that contains `cx` (its start is stored in `seg_start`).
+int editor_wrap_segment_of(const erow_t *row, int cx, int *seg_start);
+
+// Display column of the row shown at the left edge of visual line `sub`.
+int editor_wrap_segment_col(const erow_t *row, int sub, int seg);
+
+#endif // !ZILO_WRAP_H
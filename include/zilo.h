@@ -1,9 +1,14 @@
 #ifndef ZILO_ZILO_H
 #define ZILO_ZILO_H
 
+#include "syntax.h"
+#include <stdbool.h>
+#include <stdint.h>
 #include <termios.h>
 #include <time.h>
 
+#define ZILO_TAB_STOP 8
+
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 
@@ -15,18 +20,98 @@ typedef enum {
   MODE_VISUAL,
   MODE_VISUAL_LINE,
   MODE_VISUAL_BLOCK,
+  MODE_COMMAND,
 } editor_mode_e;
 
+typedef struct {
+  int start;          // Start byte offset in the row
+  int len;            // Length of the span in bytes
+  unsigned char hl;   // Highlight class (editor_highlight_e)
+} hl_span_t;
+
+// Rows up to this many bytes keep their characters inside erow_t (no allocation)
+#define ROW_INLINE_MAX 22
+
 typedef struct {
   int size;       // Record how many bytes this line contains
-  char *chars;    // Pointer to the actual character data (Does not contain \r\n)
+  bool is_inline; // The characters are in `buf` (see editor_row_chars())
+  bool is_shared; // `chars` is an interned payload shared with identical rows (read-only)
+  bool is_cold;   // The bytes are compressed in `cold.block` (see cold.h)
+  bool origin_crlf; // The line ended with "\r\n" in the loaded file
+  union {
+    char *chars;                   // Heap character data (Does not contain \r\n), NULL for long rows
+    char buf[ROW_INLINE_MAX + 1];  // Inline character data of a short row ('\0' terminated)
+    struct {
+      struct cold_block *block;    // Compressed block holding the bytes
+      int off;                     // Offset of the row in the uncompressed block
+    } cold;
+  };
+  struct lline *ll; // Chunked storage of a row longer than LLINE_THRESHOLD (see lline.h)
+  int64_t origin;   // Offset of the line in the file at the last load or save, -1 for a new row
+  uint64_t hash;      // Hash of the bytes (see editor_row_hash())
+  uint64_t file_hash; // Hash of the line at `origin` (the row is unchanged while both are equal)
+
+  int rsize;      // Length of the rendered row in bytes
+  char *render;   // Rendered row (tabs expanded, control bytes escaped), NULL if identical to the characters
+  int *cx2rx;     // Display column of every byte offset (`size + 1` entries), NULL for plain ASCII
+  int *cx2rb;     // Render buffer offset of every byte offset, NULL if `render` is NULL
+
+  hl_span_t *hl;          // Run-length highlight spans, sorted by `start` (gaps are HL_NORMAL)
+  int hl_count;           // Number of spans
+  unsigned char hl_state; // Lexer state at the end of the line (editor_hl_state_e)
 } erow_t;
 
+// Rows a page of rows is filled to (it is split at twice as many, see page.h)
+#define ROW_PAGE_ROWS 1024
+
+// The rows of a buffer, in pages that can be dropped and read back (see page.h)
+typedef struct {
+  struct row_page **pages;  // Consecutive runs of rows, in order
+  int npages;
+  int cap;
+  int *tree;        // Fenwick tree over the rows of the pages (1-based, `npages + 1` entries)
+  int hint;         // Page of the last lookup
+  int hint_first;   // Its first row (-1: look it up again)
+  int hand;         // Clock hand of the pages to drop
+} row_store_t;
+
+// Rows per block of the soft-wrap index (a block holds up to twice as many)
+#define WRAP_BLOCK_ROWS 256
+
+// Soft-wrap index: visual lines per row, in blocks, and prefix sums over the blocks (see wrap.c)
+typedef struct {
+  struct wrap_block **blocks;   // Consecutive runs of rows, in order
+  int nblocks;
+  int blockcap;
+  int *rows_tree;   // Fenwick tree over the rows of the blocks (1-based, `nblocks + 1` entries)
+  int *lines_tree;  // Fenwick tree over the visual lines of the blocks
+  int n;            // Number of indexed rows
+  int width;        // Screen width the counts were computed for
+  bool dirty;       // Stale (wrapping was off, width changed, rows reloaded): rebuild before the next query
+} wrap_index_t;
+
+// Identity of the file on disk at the last load or save
+typedef struct {
+  uint64_t dev, ino;
+  int64_t size;
+  int64_t mtime_ns;
+} file_stamp_t;
+
 typedef struct {
   int cx, cy;     // The logical position of the cursor in the file (Cursor X, Y)
+  int rx;         // The cursor display column in the rendered row
   
   int rowoff;     // The first line of the screen corresponds to which line of the file (for vertical scrolling)
   int coloff;     // The first column of the screen corresponds to which column of the file (for horizontal scrolling)
+  int lineoff;    // The first visual line of the screen (soft-wrap mode)
+
+  bool wrap;                // Soft-wrap long rows instead of scrolling horizontally
+  bool show_stats;          // Show keystroke latency percentiles in the status bar
+  bool show_mem;            // Show live/peak heap usage in the status bar
+  bool headless;            // Driven by a script or a replay: 'q' stops it instead of exiting
+  bool quit;                // 'q' was pressed in headless mode
+  bool intern;              // Identical new rows share one payload (see intern.h)
+  wrap_index_t wrap_index;  // Visual-line index used in soft-wrap mode
 
   int screenrows; // Terminal row number
   int screencols; // Terminal column number
@@ -35,18 +120,31 @@ typedef struct {
   int select_cy;  // Selection start y
 
   int numrows;    // The total row number of file
-  erow_t *row;    // The row array pointer
+  row_store_t rows;     // The rows (editor_row_at() gives one)
+  uint64_t generation;  // Bumped by every change to the rows (never reset)
 
   char statusmsg[80];           // Store messages string
   time_t statusmsg_time;        // Message timestamp
 
   char pending_key;             // Record key presses while waiting
 
+  char cmdbuf[128];             // Command line being typed (MODE_COMMAND)
+  int cmdlen;                   // Length of the command line
+
   char *filename;               // The currently opened file (heap memory)
+  int64_t file_bytes;           // Bytes read from the file by the last load
+  bool file_eol;                // The last loaded line ended with a newline
+  int file_rows;                // Lines of the file at the last load or save
+  int modified_rows;            // Rows that are not the line of the file they came from (new or edited)
+  uint64_t file_hash;           // Hash of every line of the file at the last load or save
+  file_stamp_t file_stamp;      // The file the rows were loaded from (zero: none yet)
+  file_stamp_t file_refused;    // The changed file a save was refused over (a save over it again overwrites)
+  const editor_syntax_t *syntax; // The current language (NULL means no highlighting)
   editor_mode_e mode;           // The current mode
   struct termios orig_termios;  // Save the original state when the terminal exists
 } editor_config_t;
 
+// The buffer being edited and its current window (the others are parked, see buffer.h)
 extern editor_config_t E;
 
 // Initialize editor state.
@@ -0,0 +1,526 @@
+#define ZILO_LOG_MODULE LOG_MODULE_EDIT
+#include "buffer.h"
+#include "cold.h"
+#include "file.h"
+#include "follow.h"
+#include "logger.h"
+#include "mem.h"
+#include "page.h"
+#include "row.h"
+#include "wrap.h"
+#include "zilo.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Buffers and windows. Every module works on the rows, cursor and scroll
+ * offsets in E, so the buffer being edited stays in E and the others are
+ * parked in buffer_t objects: switching copies a few fields each way and
+ * never reloads anything.
+ *
+ * Windows stack the screen vertically, each with its own status bar. The
+ * current window is the one loaded in E (with E.screenrows its height);
+ * drawing enters every window in turn and comes back to it.
+ *
+ * Generations of a buffer start at its id << 48, so a snapshot (see
+ * snapshot.h) of one buffer is never taken for another.
+ *
+ * Nothing is set up until the first `:e` or split: until then E is the
+ * only buffer and the whole screen its window.
+ *
+ * The daemon (see daemon.h) gives every attached client its own windows
+ * over the same buffers: a layout is parked while another client is
+ * served, and E holds no rows in between.
+ */
+
+#define BUFFER_GENERATION_SHIFT 48
+
+typedef struct {
+  buffer_t **bufs;    // Every loaded buffer, in the order they were opened
+  int nbufs;
+  int cap;
+  window_t win[WINDOW_MAX];   // Windows from the top of the screen down
+  int nwin;           // 0 until the first split or `:e`
+  int cur;            // The current window
+  int shown;          // The window loaded in E (the current one, except while drawing)
+  int next_id;
+} buffers_t;
+
+static buffers_t B;
+
+/*------------------------------------------
+               PARKING STATE
+ ------------------------------------------*/
+/**
+ * @brief Move the buffer fields of E into `b`.
+ */
+static void buffer_park(buffer_t *b) {
+  b->rows = E.rows;
+  b->numrows = E.numrows;
+  b->generation = E.generation;
+  b->filename = E.filename;
+  b->file_bytes = E.file_bytes;
+  b->file_eol = E.file_eol;
+  b->file_rows = E.file_rows;
+  b->modified_rows = E.modified_rows;
+  b->file_hash = E.file_hash;
+  b->file_stamp = E.file_stamp;
+  b->file_refused = E.file_refused;
+  b->syntax = E.syntax;
+  b->wrap_index = E.wrap_index;
+  b->page = editor_page_swap(NULL);
+}
+
+/**
+ * @brief Load a parked buffer into E.
+ */
+static void buffer_load(buffer_t *b) {
+  E.rows = b->rows;
+  E.numrows = b->numrows;
+  E.generation = b->generation;
+  E.filename = b->filename;
+  E.file_bytes = b->file_bytes;
+  E.file_eol = b->file_eol;
+  E.file_rows = b->file_rows;
+  E.modified_rows = b->modified_rows;
+  E.file_hash = b->file_hash;
+  E.file_stamp = b->file_stamp;
+  E.file_refused = b->file_refused;
+  E.syntax = b->syntax;
+  E.wrap_index = b->wrap_index;
+  editor_page_swap(b->page);
+  b->page = NULL;
+}
+
+/**
+ * @brief Empty buffer fields in E for a buffer about to be loaded (NULL:
+ *        for no buffer at all).
+ */
+static void buffer_reset(buffer_t *b) {
+  E.rows = (row_store_t){ .hint_first = -1 };
+  E.numrows = 0;
+  E.generation = b ? (uint64_t)b->id << BUFFER_GENERATION_SHIFT : 0;
+  E.filename = NULL;
+  E.file_bytes = 0;
+  E.file_eol = true;
+  E.file_rows = 0;
+  E.modified_rows = 0;
+  E.file_hash = 0;
+  E.file_stamp = (file_stamp_t){ 0 };
+  E.file_refused = (file_stamp_t){ 0 };
+  E.syntax = NULL;
+  E.wrap_index = (wrap_index_t){ .dirty = true };
+}
+
+static view_t view_park(void) {
+  return (view_t){ E.cx, E.cy, E.rx, E.rowoff, E.coloff, E.lineoff };
+}
+
+/**
+ * @brief Put a view back in E, inside the rows of the buffer loaded there
+ *        (another window may have deleted some).
+ */
+static void view_load(const view_t *v) {
+  E.cx = v->cx;
+  E.cy = MIN(v->cy, E.numrows);
+  E.rx = v->rx;
+  E.rowoff = MIN(v->rowoff, E.cy);
+  E.coloff = v->coloff;
+  E.lineoff = v->lineoff;
+
+  erow_t *row = editor_row_at(E.cy);
+  if (row && E.cx > row->size) E.cx = row->size;
+  if (E.cy == E.numrows) E.cx = 0;
+}
+
+/**
+ * @brief Create an empty buffer and add it to the list.
+ *
+ * @return Returns the buffer, NULL on failure.
+ */
+static buffer_t *buffers_add(void) {
+  if (B.nbufs == B.cap) {
+    int cap = B.cap ? B.cap * 2 : 4;
+    buffer_t **bufs = zilo_realloc(MEM_FILE, B.bufs, sizeof(buffer_t *) * cap);
+    if (!bufs) return NULL;
+    B.bufs = bufs;
+    B.cap = cap;
+  }
+
+  buffer_t *b = zilo_calloc(MEM_FILE, 1, sizeof(buffer_t));
+  if (!b) {
+    LOG_ERROR("malloc", "Failed to allocate a buffer.");
+    return NULL;
+  }
+  b->id = B.next_id ++;
+  B.bufs[B.nbufs ++] = b;
+  return b;
+}
+
+/**
+ * @brief The parked buffer of `filename`, NULL if it is not loaded.
+ */
+static buffer_t *buffers_find(const char *filename) {
+  for (int i = 0; i < B.nbufs; ++ i) {
+    buffer_t *b = B.bufs[i];
+    bool loaded = B.nwin > 0 && b == B.win[B.shown].buf;
+    const char *name = loaded ? E.filename : b->filename;
+    if (name && !strcmp(name, filename)) return b;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Turn E into the first buffer and the whole screen into its window.
+ *
+ * @return Returns 0 on success, -1 on failure.
+ */
+static int buffers_init(void) {
+  if (B.nwin > 0) return 0;
+
+  buffer_t *b = buffers_add();
+  if (!b) return -1;
+
+  B.win[0] = (window_t){ .buf = b, .height = E.screenrows };
+  B.nwin = 1;
+  B.cur = 0;
+  B.shown = 0;
+  return 0;
+}
+
+/**
+ * @brief Text rows of window `i` (E.screenrows for the one loaded in E).
+ */
+static int window_height(int i) {
+  return i == B.shown ? E.screenrows : B.win[i].height;
+}
+
+/**
+ * @brief Load window `i` into E.
+ */
+static void window_load(int i) {
+  if (i == B.shown) return;
+
+  window_t *from = &B.win[B.shown];
+  window_t *to = &B.win[i];
+  from->view = view_park();
+  from->height = E.screenrows;
+
+  if (from->buf != to->buf) {
+    buffer_park(from->buf);
+    buffer_load(to->buf);
+  }
+  view_load(&to->view);
+  E.screenrows = to->height;
+  B.shown = i;
+}
+
+/**
+ * @brief Show the parked buffer `b` in the current window.
+ */
+static void window_show(buffer_t *b) {
+  window_t *w = &B.win[B.cur];
+  if (w->buf == b) return;
+
+  // Follow mode reads into E: it belongs to the buffer being left
+  editor_follow_stop();
+
+  w->buf->last = view_park();
+  buffer_park(w->buf);
+  buffer_load(b);
+  view_load(&b->last);
+  w->buf = b;
+}
+
+/*------------------------------------------
+                  BUFFERS
+ ------------------------------------------*/
+/**
+ * @brief Show `filename` in the current window (`:e`).
+ *
+ * A file that is already in a buffer is switched to, not read again.
+ *
+ * @return Returns 0 on success, -1 on failure.
+ */
+int editor_buffer_edit(const char *filename) {
+  if (buffers_init() == -1) return -1;
+
+  buffer_t *b = buffers_find(filename);
+  if (b) {
+    window_show(b);
+    return 0;
+  }
+
+  // editor_open() may be given E.filename of the buffer being parked
+  char *name = zilo_strdup(MEM_FILE, filename);
+  if (!name || !(b = buffers_add())) {
+    zilo_free(MEM_FILE, name);
+    return -1;
+  }
+
+  editor_follow_stop();
+
+  window_t *w = &B.win[B.cur];
+  w->buf->last = view_park();
+  buffer_park(w->buf);
+  buffer_reset(b);
+  view_load(&b->last);
+  w->buf = b;
+
+  editor_open(name);
+  zilo_free(MEM_FILE, name);
+  return 0;
+}
+
+/**
+ * @brief Id of the buffer loaded in E (it never changes while it is loaded).
+ */
+int editor_buffer_id(void) {
+  return (int)(E.generation >> BUFFER_GENERATION_SHIFT);
+}
+
+/**
+ * @brief Show the next (`dir` 1) or previous (`dir` -1) buffer in the
+ *        current window (`:bn`, `:bp`).
+ */
+void editor_buffer_cycle(int dir) {
+  if (B.nbufs <= 1) return;
+
+  int at = 0;
+  while (B.bufs[at] != B.win[B.cur].buf) at ++;
+  window_show(B.bufs[(at + dir + B.nbufs) % B.nbufs]);
+}
+
+/**
+ * @brief Describe the buffers (`:ls`): "1 a.c  2 %b.c", % marking the
+ *        current one.
+ */
+void editor_buffer_list(char *out, size_t size) {
+  out[0] = '\0';
+  if (B.nbufs == 0) {
+    snprintf(out, size, "1 %%%s", E.filename ? E.filename : "[No Name]");
+    return;
+  }
+
+  size_t len = 0;
+  for (int i = 0; i < B.nbufs && len < size; ++ i) {
+    buffer_t *b = B.bufs[i];
+    bool current = b == B.win[B.cur].buf;
+    const char *name = current ? E.filename : b->filename;
+    len += snprintf(out + len, size - len, "%s%d %s%s", i ? "  " : "", i + 1,
+                    current ? "%" : "", name ? name : "[No Name]");
+  }
+}
+
+/*------------------------------------------
+                  WINDOWS
+ ------------------------------------------*/
+/**
+ * @brief Split the current window (`:sp`). The new window goes on top,
+ *        shows the same place and becomes current.
+ *
+ * @return Returns 0 on success, -1 if there is no room for another window.
+ */
+int editor_window_split(void) {
+  if (buffers_init() == -1) return -1;
+  if (B.nwin == WINDOW_MAX || E.screenrows < 3) return -1;
+
+  int h = E.screenrows;
+  memmove(&B.win[B.cur + 1], &B.win[B.cur], sizeof(window_t) * (B.nwin - B.cur));
+  B.nwin ++;
+
+  // The new window keeps the extra row of an odd split; one row goes to its status bar
+  B.win[B.cur + 1].view = view_park();
+  B.win[B.cur + 1].height = h / 2;
+  B.win[B.cur].height = h - 1 - h / 2;
+  E.screenrows = B.win[B.cur].height;
+  return 0;
+}
+
+/**
+ * @brief Close the current window (`:close`). Its rows go to the window
+ *        below it (above for the bottom one); the buffer stays loaded.
+ *
+ * @return Returns 0 on success, -1 if it is the last window.
+ */
+int editor_window_close(void) {
+  if (B.nwin <= 1) return -1;
+
+  int i = B.cur;
+  int j = i + 1 < B.nwin ? i + 1 : i - 1;
+  window_t *w = &B.win[i];
+  if (w->buf != B.win[j].buf) editor_follow_stop();
+
+  window_load(j);
+  w->buf->last = w->view;
+  E.screenrows += w->height + 1;
+
+  memmove(&B.win[i], &B.win[i + 1], sizeof(window_t) * (B.nwin - i - 1));
+  B.nwin --;
+  B.cur = B.shown = j > i ? j - 1 : j;
+  return 0;
+}
+
+/**
+ * @brief Close every other window (`:only`).
+ */
+void editor_window_only(void) {
+  if (B.nwin <= 1) return;
+
+  int rows = editor_window_screen_rows();
+  for (int i = 0; i < B.nwin; ++ i) {
+    if (i != B.cur) B.win[i].buf->last = B.win[i].view;
+  }
+
+  B.win[0] = B.win[B.cur];
+  B.nwin = 1;
+  B.cur = B.shown = 0;
+  E.screenrows = rows;
+}
+
+/**
+ * @brief Make the next window current (Ctrl-W).
+ */
+void editor_window_next(void) {
+  if (B.nwin <= 1) return;
+
+  int next = (B.cur + 1) % B.nwin;
+  if (B.win[next].buf != B.win[B.cur].buf) editor_follow_stop();
+  window_load(next);
+  B.cur = next;
+}
+
+/**
+ * @brief Number of windows on screen.
+ */
+int editor_window_count(void) {
+  return MAX(B.nwin, 1);
+}
+
+/**
+ * @brief Index of the current window.
+ */
+int editor_window_current(void) {
+  return B.cur;
+}
+
+/**
+ * @brief Load window `i` into E to draw it. Entering the current window
+ *        again restores the editing state.
+ */
+void editor_window_enter(int i) {
+  if (B.nwin > 1) window_load(i);
+}
+
+/**
+ * @brief Screen row (0-based) of the first text row of window `i`.
+ */
+int editor_window_top(int i) {
+  int top = 0;
+  for (int k = 0; k < i && k < B.nwin; ++ k) top += window_height(k) + 1;
+  return top;
+}
+
+/**
+ * @brief Text rows of the whole screen: every window and every status bar
+ *        but the last.
+ */
+int editor_window_screen_rows(void) {
+  if (B.nwin <= 1) return E.screenrows;
+  return editor_window_top(B.nwin - 1) + window_height(B.nwin - 1);
+}
+
+/*------------------------------------------
+                  LAYOUTS
+ ------------------------------------------*/
+/**
+ * @brief Park the buffer and view loaded in E, and the windows, into `out`.
+ *        E is left with no rows until a layout is loaded.
+ */
+void editor_layout_park(layout_t *out) {
+  out->nwin = 0;
+  if (B.nwin == 0) return;
+
+  editor_follow_stop();
+  window_load(B.cur);
+
+  window_t *w = &B.win[B.cur];
+  w->view = view_park();
+  w->height = E.screenrows;
+  buffer_park(w->buf);
+  buffer_reset(NULL);
+
+  // A client attaching later starts where this one was
+  for (int i = 0; i < B.nwin; ++ i) B.win[i].buf->last = B.win[i].view;
+
+  memcpy(out->win, B.win, sizeof(window_t) * B.nwin);
+  out->nwin = B.nwin;
+  out->cur = B.cur;
+  B.nwin = 0;
+}
+
+/**
+ * @brief Load a layout parked by editor_layout_park().
+ */
+void editor_layout_load(const layout_t *in) {
+  if (in->nwin == 0) return;
+
+  memcpy(B.win, in->win, sizeof(window_t) * in->nwin);
+  B.nwin = in->nwin;
+  B.cur = B.shown = in->cur;
+
+  window_t *w = &B.win[B.cur];
+  buffer_load(w->buf);
+  view_load(&w->view);
+  E.screenrows = w->height;
+}
+
+/**
+ * @brief Start a layout of one window showing `filename`, while none is
+ *        loaded. A file already in a buffer is not read again.
+ *
+ * @return Returns 0 on success, -1 on failure.
+ */
+int editor_layout_open(const char *filename) {
+  if (B.nwin > 0) return -1;
+
+  buffer_t *b = buffers_find(filename);
+  bool loaded = b != NULL;
+  if (!b && !(b = buffers_add())) return -1;
+
+  B.win[0] = (window_t){ .buf = b, .view = b->last, .height = E.screenrows };
+  B.nwin = 1;
+  B.cur = B.shown = 0;
+
+  if (loaded) {
+    buffer_load(b);
+  } else {
+    buffer_reset(b);
+    editor_open((char *)filename);
+  }
+  view_load(&b->last);
+  return 0;
+}
+
+/**
+ * @brief Free the parked buffers and forget the windows. The buffer loaded
+ *        in E is left to free_editor().
+ */
+void editor_buffers_free(void) {
+  buffer_t *loaded = B.nwin > 0 ? B.win[B.shown].buf : NULL;
+
+  for (int i = 0; i < B.nbufs; ++ i) {
+    buffer_t *b = B.bufs[i];
+    if (b != loaded) {
+      editor_rows_free(&b->rows);
+      zilo_free(MEM_FILE, b->filename);
+      editor_wrap_free(&b->wrap_index);
+      editor_page_release(b->page);
+    }
+    zilo_free(MEM_FILE, b);
+  }
+  zilo_free(MEM_FILE, B.bufs);
+
+  if (B.nwin > 1) E.screenrows = editor_window_screen_rows();
+  B = (buffers_t){ 0 };
+}
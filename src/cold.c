@@ -0,0 +1,926 @@
+#define _POSIX_C_SOURCE 200809L
+#define ZILO_LOG_MODULE LOG_MODULE_EDIT
+#include "cold.h"
+#include "intern.h"
+#include "lline.h"
+#include "logger.h"
+#include "lz.h"
+#include "mem.h"
+#include "page.h"
+#include "row.h"
+#include "syntax.h"
+#include "trace.h"
+#include "zilo.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Cold rows. Once the memory held by rows passes the budget, rows far from
+ * the view and the cursor are packed into blocks of about COLD_BLOCK_BYTES
+ * and compressed (see lz.h); their own buffers, highlight spans included,
+ * are freed. A compressed row keeps its size and end-of-line lexer state,
+ * so scrolling, cursor motion and the wrap index work without its bytes.
+ *
+ * Reading a compressed row (save, snapshots, re-lexing) decompresses its
+ * block into a small LRU cache. Drawing or editing a row thaws it: the row
+ * gets its bytes back and stays hot until a later sweep.
+ *
+ * Only plain ASCII rows of the heap are compressed: inline, shared and long
+ * rows cost little or are handled elsewhere, and rows with a render cache
+ * would need it rebuilt to be measured.
+ *
+ * Paging (`zilo --page`) goes one step further, for buffers whose text is
+ * larger than memory. A block of rows that are still exactly as loaded,
+ * and consecutive in the file, is not compressed at all: it is re-read from
+ * the original file when needed. Compressed blocks that are still over the
+ * budget are spilled to an unlinked temporary file, chosen by a clock over
+ * all blocks so that recently read ones stay. Blocks never change, so a
+ * spilled block is written once and can be dropped again for free.
+ *
+ * Blocks only hold the bytes of rows; each row keeps its erow_t (about 112
+ * bytes). Paging therefore also drops whole pages of rows, descriptors and
+ * all, whatever their storage (see page.c): a page goes back to the file
+ * the same way, or to the temp file. Only the pages around the view and the
+ * cursor, and the ones read back since the last sweep, stay in memory.
+ *
+ * Every buffer has its own attached file (see buffer.h). A block read from
+ * a file holds a reference to it, so the file stays open for as long as one
+ * of its blocks lives, whichever buffer is shown.
+ *
+ * The file may be rewritten in place behind the rows: by another program,
+ * or by this one (a save from another buffer, the hex view). Blocks are
+ * moved to the temp file before any save over a file they read from (see
+ * editor_page_detach_path()). Every block read back is also checked against
+ * the hashes of its rows, and a file whose size or mtime moved since it was
+ * attached takes no new blocks.
+ */
+
+// Rows of one block (each compressed row has more than ROW_INLINE_MAX bytes)
+#define COLD_BLOCK_ROWS (COLD_BLOCK_BYTES / (ROW_INLINE_MAX + 1) + 1)
+
+// Where the bytes of a block come from once `zip` is dropped
+typedef enum {
+  COLD_IN_MEMORY = 0,   // Only in `zip`
+  COLD_IN_TEMP,         // `zip` was written to the temp file at `pos`
+  COLD_IN_FILE,         // The rows are the lines at `pos` of the original file (no `zip`)
+} cold_source_e;
+
+// A file rows can be re-read from
+typedef struct cold_file {
+  int fd;
+  int64_t size;       // Its size when it was attached
+  uint64_t dev, ino;  // Which file it is (a save over the same path detaches it)
+  int64_t mtime_ns;   // Its mtime when it was attached
+  bool stale;         // It changed since: no new block reads from it
+  int refs;           // The buffer it is attached to, and every block reading from it
+  struct cold_file *next;   // Every file attached and still referenced
+} cold_file_t;
+
+typedef struct cold_block {
+  int refs;           // Compressed rows pointing into the block
+  int raw_len;        // Uncompressed bytes
+  int zip_len;        // Bytes of `zip`
+  bool stored;        // `zip` holds the bytes as they are (they did not compress)
+  bool used;          // Read since the clock hand last passed
+  cold_source_e source;
+  int64_t pos;        // Offset in the temp file or in the original file
+  int file_len;       // Bytes of the original file covered (COLD_IN_FILE)
+  cold_file_t *file;  // That file (COLD_IN_FILE)
+  uint64_t hash;      // The hashes of its rows folded together (COLD_IN_FILE)
+  char *zip;          // Compressed bytes (NULL while paged out)
+  char *raw;          // Decompressed copy while the block is in the cache
+  struct cold_block *prev, *next;           // Cache order, most recent first
+  struct cold_block *all_prev, *all_next;   // Every block (clock order)
+} cold_block_t;
+
+typedef struct {
+  int64_t budget;     // Row memory allowed before compressing (0: off)
+  int64_t floor;      // No sweep below this much row memory (the last one fell short)
+  int scan;           // Row where the next sweep resumes
+  cold_block_t *head, *tail;
+  cold_block_t *all;  // List of every block
+  cold_block_t *hand; // Clock hand over `all`
+  cold_stats_t stats;
+
+  bool paged;         // Pages may be dropped (re-read from the file or the temp file)
+  cold_file_t *file;  // The file of the buffer being edited (NULL if not attached)
+  cold_file_t *files; // Every file still referenced (by a buffer or a block)
+  int temp_fd;        // Unlinked spill file (-1 until the first spill)
+  int64_t temp_end;   // Bytes written to it
+  int64_t temp_live;  // Bytes of it still referenced
+} cold_t;
+
+static cold_t C = { .temp_fd = -1 };
+
+/*------------------------------------------
+                BLOCK CACHE
+ ------------------------------------------*/
+static int64_t cold_cache_cap(void) {
+  return MAX(C.budget / 8, COLD_MIN_CACHE);
+}
+
+static void cold_lru_unlink(cold_block_t *b) {
+  if (b->prev) b->prev->next = b->next;
+  else C.head = b->next;
+  if (b->next) b->next->prev = b->prev;
+  else C.tail = b->prev;
+  b->prev = b->next = NULL;
+}
+
+static void cold_lru_push(cold_block_t *b) {
+  b->prev = NULL;
+  b->next = C.head;
+  if (C.head) C.head->prev = b;
+  C.head = b;
+  if (!C.tail) C.tail = b;
+}
+
+/**
+ * @brief Drop the decompressed copy of a block.
+ */
+static void cold_evict(cold_block_t *b) {
+  cold_lru_unlink(b);
+  zilo_free(MEM_COLD, b->raw);
+  b->raw = NULL;
+  C.stats.cache_bytes -= b->raw_len;
+}
+
+/**
+ * @brief Read back the compressed bytes of a block spilled to the temp file.
+ *
+ * @return Returns 0 on success, -1 on failure.
+ */
+static int cold_page_in(cold_block_t *b) {
+  char *zip = zilo_malloc(MEM_COLD, b->zip_len);
+  if (!zip || editor_spill_read(b->pos, zip, b->zip_len) == -1) {
+    LOG_ERROR("cold_page_in", "Failed to read a block back from the temp file.");
+    zilo_free(MEM_COLD, zip);
+    return -1;
+  }
+  b->zip = zip;
+  C.stats.zip_bytes += b->zip_len;
+  return 0;
+}
+
+static int64_t cold_mtime_ns(const struct stat *st) {
+  return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+}
+
+/**
+ * @brief Mix the hash of one more row of a block into `h`.
+ */
+static inline uint64_t cold_hash_fold(uint64_t h, uint64_t row) {
+  return (h ^ row) * 0x100000001b3ULL;
+}
+
+/**
+ * @brief Rebuild the bytes of a COLD_IN_FILE block from the original file.
+ *
+ * The lines are cut exactly as editor_open() does ('\n', with a '\r' before
+ * it dropped), so the result must be `raw_len` bytes, and the lines must
+ * hash as the rows did when the block was made.
+ *
+ * @return Returns 0 on success, -1 if the file cannot be read or changed.
+ */
+static int cold_read_file(cold_block_t *b) {
+  char *buf = zilo_malloc(MEM_COLD, b->file_len);
+  if (!buf || editor_page_read(b->file, b->pos, buf, b->file_len) == -1) {
+    zilo_free(MEM_COLD, buf);
+    return -1;
+  }
+
+  int len = 0;
+  uint64_t hash = 0;
+  const char *p = buf;
+  const char *end = buf + b->file_len;
+  const char *nl;
+  while (len >= 0 && (nl = memchr(p, '\n', end - p))) {
+    int n = nl - p;
+    if (n > 0 && p[n - 1] == '\r') n --;
+    if (len + n > b->raw_len) {
+      len = -1;
+    } else {
+      memcpy(b->raw + len, p, n);
+      hash = cold_hash_fold(hash, editor_hash_line(p, n));
+      len += n;
+    }
+    p = nl + 1;
+  }
+  zilo_free(MEM_COLD, buf);
+
+  if (len != b->raw_len || p != end || hash != b->hash) {
+    LOG_ERROR("cold_read_file", "The file changed under paged rows.");
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Uncompressed bytes of a block, decompressing it into the cache.
+ *
+ * Other blocks may be evicted, so a pointer returned earlier is only valid
+ * until the next call.
+ *
+ * @return Returns the bytes, NULL on failure.
+ */
+static const char *cold_block_data(cold_block_t *b) {
+  b->used = true;
+
+  if (b->raw) {
+    cold_lru_unlink(b);
+    cold_lru_push(b);
+    return b->raw;
+  }
+
+  if (b->source != COLD_IN_FILE && !b->zip && cold_page_in(b) == -1) return NULL;
+  if (b->stored) return b->zip;
+
+  b->raw = zilo_malloc(MEM_COLD, b->raw_len);
+  bool ok = b->raw && (b->source == COLD_IN_FILE
+                       ? cold_read_file(b) == 0
+                       : lz_decompress(b->zip, b->zip_len, b->raw, b->raw_len) == b->raw_len);
+  if (!ok) {
+    LOG_ERROR("cold_block_data", "Failed to load a block of rows.");
+    zilo_free(MEM_COLD, b->raw);
+    b->raw = NULL;
+    return NULL;
+  }
+  cold_lru_push(b);
+  C.stats.cache_bytes += b->raw_len;
+
+  while (C.stats.cache_bytes > cold_cache_cap() && C.tail != b) cold_evict(C.tail);
+  return b->raw;
+}
+
+/*------------------------------------------
+                 SPILLING
+ ------------------------------------------*/
+/**
+ * @brief The unlinked spill file, created on first use in $TMPDIR (or /tmp).
+ *
+ * @return Returns the descriptor, -1 on failure.
+ */
+static int cold_temp_fd(void) {
+  if (C.temp_fd != -1) return C.temp_fd;
+
+  const char *dir = getenv("TMPDIR");
+  if (!dir || !dir[0]) dir = "/tmp";
+
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/zilo-XXXXXX", dir);
+  int fd = mkstemp(path);
+  if (fd == -1) {
+    LOG_ERROR("mkstemp", "Failed to create a spill file in <%s>: %s.", dir, strerror(errno));
+    return -1;
+  }
+  unlink(path);
+
+  C.temp_fd = fd;
+  C.temp_end = 0;
+  C.temp_live = 0;
+  return fd;
+}
+
+/**
+ * @brief Append `len` bytes to the temp file.
+ *
+ * @return Returns their offset there, -1 on failure.
+ */
+int64_t editor_spill_write(const char *buf, int64_t len) {
+  int fd = cold_temp_fd();
+  if (fd == -1) return -1;
+
+  int64_t pos = C.temp_end;
+  for (int64_t done = 0; done < len; ) {
+    ssize_t n = pwrite(fd, buf + done, len - done, pos + done);
+    if (n <= 0) {
+      LOG_ERROR("pwrite", "Failed to spill rows to the temp file: %s.", n == -1 ? strerror(errno) : "disk full");
+      return -1;
+    }
+    done += n;
+  }
+  C.temp_end += len;
+  C.temp_live += len;
+  return pos;
+}
+
+/**
+ * @brief Read back `len` bytes written at `pos` by editor_spill_write().
+ *
+ * @return Returns 0 on success, -1 on failure.
+ */
+int editor_spill_read(int64_t pos, char *buf, int64_t len) {
+  for (int64_t done = 0; done < len; ) {
+    ssize_t n = pread(C.temp_fd, buf + done, len - done, pos + done);
+    if (n <= 0) {
+      LOG_ERROR("pread", "Failed to read rows back from the temp file.");
+      return -1;
+    }
+    done += n;
+  }
+  return 0;
+}
+
+/**
+ * @brief Forget `len` bytes of the temp file. Once nothing is left in it,
+ *        the space is given back.
+ */
+void editor_spill_free(int64_t len) {
+  C.temp_live -= len;
+  if (C.temp_live == 0 && ftruncate(C.temp_fd, 0) == 0) C.temp_end = 0;
+}
+
+/**
+ * @brief Drop the compressed bytes of a block, writing them to the temp file
+ *        first if they are only in memory.
+ *
+ * @return Returns 0 on success, -1 on failure (the block is unchanged).
+ */
+static int cold_page_out(cold_block_t *b) {
+  if (!b->zip) return 0;
+
+  if (b->source == COLD_IN_MEMORY) {
+    int64_t pos = editor_spill_write(b->zip, b->zip_len);
+    if (pos == -1) return -1;
+    b->source = COLD_IN_TEMP;
+    b->pos = pos;
+    C.stats.temp_bytes += b->zip_len;
+  }
+
+  zilo_free(MEM_COLD, b->zip);
+  b->zip = NULL;
+  C.stats.zip_bytes -= b->zip_len;
+  return 0;
+}
+
+/**
+ * @brief Page out blocks that were not read lately until row memory is back
+ *        to `target` (second-chance clock over every block).
+ */
+static void cold_spill(int64_t target) {
+  int64_t resident = editor_cold_resident();
+  int64_t visits = 2 * C.stats.blocks;
+
+  while (resident > target && visits -- > 0 && C.all) {
+    if (!C.hand) C.hand = C.all;
+    cold_block_t *b = C.hand;
+    C.hand = b->all_next;
+
+    if (b->used) {
+      b->used = false;
+      continue;
+    }
+    if (!b->zip) continue;
+
+    if (b->raw) cold_evict(b);
+    if (cold_page_out(b) == -1) return;
+    resident = editor_cold_resident();
+  }
+}
+
+/*------------------------------------------
+                COMPRESSION
+ ------------------------------------------*/
+/**
+ * @brief True if the row would be compressed by a sweep.
+ *
+ * Interned rows are left alone with `:set intern` (their payload is shared
+ * with identical rows); without it only a snapshot shares them.
+ */
+static bool cold_row_eligible(const erow_t *row) {
+  return !row->is_inline && !(row->is_shared && E.intern) && !row->is_cold && !row->ll &&
+         !row->render && !row->cx2rx;
+}
+
+/**
+ * @brief True if the row is on screen, next to it or next to the cursor.
+ */
+static bool cold_row_near_view(int i) {
+  int margin = MAX(E.screenrows, 1);
+  return (i >= E.rowoff - margin && i < E.rowoff + 2 * margin) ||
+         (i >= E.cy - margin && i <= E.cy + margin);
+}
+
+/**
+ * @brief Bytes the row takes in the loaded file, line break included.
+ */
+static int64_t cold_row_file_len(const erow_t *row) {
+  return row->size + (row->origin_crlf ? 2 : 1);
+}
+
+/**
+ * @brief True if the row can be re-read from the attached file.
+ */
+static bool cold_row_in_file(const erow_t *row) {
+  return C.paged && C.file && !C.file->stale && editor_row_in_file(row) &&
+         row->origin + cold_row_file_len(row) <= C.file->size;
+}
+
+/**
+ * @brief Turn the rows `rows` (their bytes concatenated in `raw`) into one block.
+ *
+ * @param in_file The rows are consecutive lines of the attached file: the
+ *                block keeps no bytes at all.
+ * @param zip     Scratch buffer of LZ_BOUND(len) bytes.
+ *
+ * @return Returns 0 on success, -1 on failure (the rows are unchanged).
+ */
+static int cold_freeze(const int *rows, int n, const char *raw, int len, bool in_file, char *zip) {
+  int zip_len = 0;
+  bool stored = false;
+  if (!in_file) {
+    zip_len = lz_compress(raw, len, zip, LZ_BOUND(len));
+    stored = zip_len == -1 || zip_len >= len;
+    if (stored) zip_len = len;
+  }
+
+  cold_block_t *b = zilo_malloc(MEM_COLD, sizeof(cold_block_t));
+  char *data = in_file ? NULL : zilo_malloc(MEM_COLD, zip_len);
+  if (!b || (!in_file && !data)) {
+    LOG_ERROR("malloc", "Failed to allocate a block of rows.");
+    zilo_free(MEM_COLD, b);
+    zilo_free(MEM_COLD, data);
+    return -1;
+  }
+  if (data) memcpy(data, stored ? raw : zip, zip_len);
+  *b = (cold_block_t){ .refs = n, .raw_len = len, .zip_len = zip_len, .stored = stored, .zip = data };
+
+  if (in_file) {
+    const erow_t *first = editor_row_peek(rows[0]);
+    const erow_t *last = editor_row_peek(rows[n - 1]);
+    b->source = COLD_IN_FILE;
+    b->pos = first->origin;
+    b->file_len = last->origin + cold_row_file_len(last) - first->origin;
+    b->file = C.file;
+    C.file->refs ++;
+  }
+
+  int off = 0;
+  for (int k = 0; k < n; ++ k) {
+    erow_t *row = editor_row_peek(rows[k]);
+    if (in_file) b->hash = cold_hash_fold(b->hash, row->file_hash);
+    if (row->is_shared) intern_release(row->chars);
+    else zilo_free(MEM_ROWS, row->chars);
+    row->is_shared = false;
+    zilo_free(MEM_SYNTAX, row->hl);
+    row->hl = NULL;
+    row->hl_count = 0;
+
+    row->is_cold = true;
+    row->cold.block = b;
+    row->cold.off = off;
+    off += row->size;
+  }
+
+  b->all_next = C.all;
+  if (C.all) C.all->all_prev = b;
+  C.all = b;
+
+  C.stats.rows += n;
+  C.stats.blocks ++;
+  C.stats.raw_bytes += len;
+  C.stats.zip_bytes += zip_len;
+  if (in_file) C.stats.file_blocks ++;
+  return 0;
+}
+
+/**
+ * @brief Compress rows far from the view if row memory is over the budget.
+ *
+ * With paging on, whole pages of rows are dropped first (see page.h). Rows
+ * are then taken in file order from where the previous sweep stopped, until
+ * row memory is back under 3/4 of the budget. If every candidate is already
+ * compressed, no sweep runs again before row memory grows by another block.
+ *
+ * Every sweep ends the pins of the pages read back since the last one.
+ *
+ * @return Returns the number of rows compressed.
+ */
+int editor_cold_sweep(void) {
+  editor_pages_unpin();
+  if (C.budget <= 0 || E.numrows == 0) return 0;
+
+  int64_t resident = editor_cold_resident();
+  if (resident <= C.budget || resident < C.floor) return 0;
+
+  TRACE_SPAN("cold_sweep");
+
+  // Whole pages first: they take their descriptors with them
+  int64_t target = C.budget - C.budget / 4;
+  if (C.paged) {
+    editor_pages_trim(target);
+    resident = editor_cold_resident();
+  }
+
+  int raw_cap = COLD_BLOCK_BYTES + LLINE_THRESHOLD;
+  char *raw = zilo_malloc(MEM_COLD, raw_cap);
+  char *zip = zilo_malloc(MEM_COLD, LZ_BOUND(raw_cap));
+  int *rows = zilo_malloc(MEM_COLD, sizeof(int) * COLD_BLOCK_ROWS);
+  if (!raw || !zip || !rows) {
+    LOG_ERROR("malloc", "Failed to allocate the compression buffers.");
+    zilo_free(MEM_COLD, raw);
+    zilo_free(MEM_COLD, zip);
+    zilo_free(MEM_COLD, rows);
+    return 0;
+  }
+
+  int frozen = 0;
+  int scanned = 0;
+  while (scanned < E.numrows && resident > target) {
+    // Gather a block of candidates. A block of lines that follow each other
+    // in the attached file ends at the first row that does not.
+    int n = 0, len = 0;
+    bool in_file = false;
+    int64_t next_origin = -1;
+    while (scanned < E.numrows && len < COLD_BLOCK_BYTES && n < COLD_BLOCK_ROWS) {
+      if (C.scan >= E.numrows) C.scan = 0;
+      erow_t *row = editor_row_peek(C.scan);
+      if (!row) {
+        // A page that is out: nothing of it is in memory
+        int end = editor_row_page_end(C.scan);
+        scanned += end - C.scan;
+        C.scan = end;
+        continue;
+      }
+      if (!cold_row_eligible(row) || cold_row_near_view(C.scan)) {
+        C.scan ++;
+        scanned ++;
+        continue;
+      }
+
+      bool follows = cold_row_in_file(row) && (n == 0 || row->origin == next_origin);
+      if (n == 0) in_file = follows;
+      else if (in_file && !follows) break;
+
+      memcpy(raw + len, row->chars, row->size);
+      len += row->size;
+      rows[n ++] = C.scan ++;
+      scanned ++;
+      next_origin = row->origin + cold_row_file_len(row);
+    }
+
+    if (n == 0 || cold_freeze(rows, n, raw, len, in_file, zip) == -1) break;
+    frozen += n;
+    resident = editor_cold_resident();
+  }
+
+  zilo_free(MEM_COLD, raw);
+  zilo_free(MEM_COLD, zip);
+  zilo_free(MEM_COLD, rows);
+
+  if (C.paged && resident > target) {
+    cold_spill(target);
+    resident = editor_cold_resident();
+  }
+
+  C.floor = resident > target ? resident + COLD_BLOCK_BYTES : 0;
+  LOG_DEBUG("editor_cold_sweep", "Compressed %d rows, row memory now %lld bytes.",
+            frozen, (long long)resident);
+  return frozen;
+}
+
+/*------------------------------------------
+              PUBLIC INTERFACE
+ ------------------------------------------*/
+/**
+ * @brief Set the row memory allowed before rows get compressed (0 turns it off).
+ *
+ * Rows already compressed stay so until they are drawn or edited.
+ */
+void editor_cold_set_budget(int64_t budget) {
+  C.budget = MAX(budget, 0);
+  C.floor = 0;
+}
+
+/**
+ * @brief The current budget (0 when off).
+ */
+int64_t editor_cold_budget(void) {
+  return C.budget;
+}
+
+/**
+ * @brief Memory held by rows: their descriptors, bytes, render caches,
+ *        spans, shared payloads and compressed blocks.
+ */
+int64_t editor_cold_resident(void) {
+  static const mem_tag_e tags[] = { MEM_ROWS, MEM_ROW_ARRAY, MEM_RENDER, MEM_SYNTAX, MEM_INTERN, MEM_COLD };
+
+  int64_t total = 0;
+  for (size_t i = 0; i < sizeof(tags) / sizeof(tags[0]); ++ i) {
+    mem_stats_t st;
+    zilo_mem_stats(tags[i], &st);
+    total += st.live;
+  }
+  return total;
+}
+
+/**
+ * @brief Bytes of a compressed row.
+ *
+ * @return Returns `row->size` bytes, valid until the next call into this
+ *         module, or NULL if the block cannot be decompressed.
+ */
+const char *editor_cold_bytes(const erow_t *row) {
+  const char *data = cold_block_data(row->cold.block);
+  return data ? data + row->cold.off : NULL;
+}
+
+/**
+ * @brief Drop the block reference of a compressed row (the row is being
+ *        freed or thawed). The last reference frees the block.
+ */
+void editor_cold_release(erow_t *row) {
+  cold_block_t *b = row->cold.block;
+  row->is_cold = false;
+  row->chars = NULL;
+  C.stats.rows --;
+  if (-- b->refs > 0) return;
+
+  if (b->raw) cold_evict(b);
+  if (C.hand == b) C.hand = b->all_next;
+  if (b->all_prev) b->all_prev->all_next = b->all_next;
+  else C.all = b->all_next;
+  if (b->all_next) b->all_next->all_prev = b->all_prev;
+
+  if (b->source == COLD_IN_TEMP) {
+    C.stats.temp_bytes -= b->zip_len;
+    editor_spill_free(b->zip_len);
+  }
+  if (b->source == COLD_IN_FILE) {
+    C.stats.file_blocks --;
+    editor_page_release(b->file);
+  }
+
+  C.stats.blocks --;
+  C.stats.raw_bytes -= b->raw_len;
+  if (b->zip) C.stats.zip_bytes -= b->zip_len;
+  zilo_free(MEM_COLD, b->zip);
+  zilo_free(MEM_COLD, b);
+}
+
+/**
+ * @brief Give a compressed row its bytes back (before it is drawn or edited).
+ *
+ * @param row Row object of E.
+ *
+ * @return Returns 0 on success, -1 on failure (the row stays compressed).
+ */
+int editor_row_thaw(erow_t *row) {
+  if (!row->is_cold) return 0;
+
+  const char *s = editor_cold_bytes(row);
+  char *chars = s ? zilo_malloc(MEM_ROWS, row->size + 1) : NULL;
+  if (!chars) {
+    LOG_ERROR("malloc", "Failed to thaw a compressed row.");
+    return -1;
+  }
+  memcpy(chars, s, row->size);
+  chars[row->size] = '\0';
+
+  editor_cold_release(row);
+  row->chars = chars;
+
+  // The spans were dropped with the bytes; the end state is unchanged
+  editor_update_syntax(editor_row_index(row));
+  return 0;
+}
+
+/**
+ * @brief Snapshot the counters.
+ */
+void editor_cold_stats(cold_stats_t *out) {
+  *out = C.stats;
+}
+
+/*------------------------------------------
+                  PAGING
+ ------------------------------------------*/
+/**
+ * @brief Turn paging on or off.
+ *
+ * While it is off no block is dropped; blocks already paged out are still
+ * read back when needed.
+ */
+void editor_page_enable(bool on) {
+  C.paged = on;
+  C.floor = 0;
+}
+
+/**
+ * @brief True while paging is on.
+ */
+bool editor_page_enabled(void) {
+  return C.paged;
+}
+
+/**
+ * @brief Use `fd` (the file being loaded) as the source of clean pages.
+ *
+ * Blocks read from a previous file are detached first. The descriptor is
+ * duplicated, so the caller still closes its own.
+ *
+ * @return Returns 0 on success, -1 on failure (no file is attached).
+ */
+int editor_page_attach(int fd) {
+  if (editor_page_detach() == -1) return -1;
+
+  struct stat st;
+  if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) return -1;
+
+  cold_file_t *file = zilo_malloc(MEM_COLD, sizeof(cold_file_t));
+  if (!file) return -1;
+  file->fd = dup(fd);
+  if (file->fd == -1) {
+    zilo_free(MEM_COLD, file);
+    return -1;
+  }
+  file->size = st.st_size;
+  file->dev = st.st_dev;
+  file->ino = st.st_ino;
+  file->mtime_ns = cold_mtime_ns(&st);
+  file->stale = false;
+  file->refs = 1;
+  file->next = C.files;
+  C.files = file;
+  C.file = file;
+  return 0;
+}
+
+/**
+ * @brief The file attached to the buffer being edited (NULL if none).
+ */
+struct cold_file *editor_page_file(void) {
+  return C.file;
+}
+
+/**
+ * @brief True if rows up to offset `end` of `file` may be dropped to it:
+ *        paging is on and the file did not change since it was attached.
+ */
+bool editor_page_file_fits(const struct cold_file *file, int64_t end) {
+  return C.paged && file && !file->stale && end <= file->size;
+}
+
+/**
+ * @brief Take a reference to `file` (dropped with editor_page_release()).
+ */
+void editor_page_hold(struct cold_file *file) {
+  file->refs ++;
+}
+
+/**
+ * @brief Read `len` bytes at `pos` of `file`, for rows paged to it.
+ *
+ * A file whose size or mtime moved since it was attached is marked stale:
+ * it takes no new pages. The caller checks the bytes against its rows.
+ *
+ * @return Returns 0 on success, -1 on failure.
+ */
+int editor_page_read(struct cold_file *file, int64_t pos, char *buf, int64_t len) {
+  struct stat st;
+  if (fstat(file->fd, &st) == -1) {
+    LOG_ERROR("fstat", "Failed to check the file of paged rows.");
+    return -1;
+  }
+  if (!file->stale && (st.st_size != file->size || cold_mtime_ns(&st) != file->mtime_ns)) {
+    LOG_WARN("editor_page_read", "The file of paged rows changed on disk: no new page goes to it.");
+    file->stale = true;
+  }
+
+  for (int64_t done = 0; done < len; ) {
+    ssize_t n = pread(file->fd, buf + done, len - done, pos + done);
+    if (n <= 0) {
+      LOG_ERROR("pread", "Failed to read paged rows back from the file.");
+      return -1;
+    }
+    done += n;
+  }
+  return 0;
+}
+
+/**
+ * @brief Move every block and page that lives in `file` to the temp file:
+ *        each block is read once more, compressed and spilled.
+ *
+ * @return Returns 0 on success, -1 if a block could not be moved.
+ */
+static int cold_detach_blocks(cold_file_t *file) {
+  TRACE_SPAN("page_detach");
+
+  char *zip = NULL;
+  int ret = editor_pages_detach_file(file);
+  file->refs ++;   // Held while its blocks let go of it
+  for (cold_block_t *b = C.all; b && ret == 0; b = b->all_next) {
+    if (b->source != COLD_IN_FILE || b->file != file) continue;
+
+    if (!zip) zip = zilo_malloc(MEM_COLD, LZ_BOUND(COLD_BLOCK_BYTES + LLINE_THRESHOLD));
+    const char *raw = cold_block_data(b);
+    if (!zip || !raw) {
+      ret = -1;
+      break;
+    }
+
+    int zip_len = lz_compress(raw, b->raw_len, zip, LZ_BOUND(b->raw_len));
+    bool stored = zip_len == -1 || zip_len >= b->raw_len;
+    if (stored) zip_len = b->raw_len;
+    char *data = zilo_malloc(MEM_COLD, zip_len);
+    if (!data) {
+      ret = -1;
+      break;
+    }
+    memcpy(data, stored ? raw : zip, zip_len);
+
+    b->source = COLD_IN_MEMORY;
+    b->zip = data;
+    b->zip_len = zip_len;
+    b->stored = stored;
+    b->file = NULL;
+    C.stats.zip_bytes += zip_len;
+    C.stats.file_blocks --;
+    file->refs --;
+
+    // The whole file may not fit in memory: move it out right away
+    if (b->raw) cold_evict(b);
+    if (cold_page_out(b) == -1) ret = -1;
+  }
+  zilo_free(MEM_COLD, zip);
+  editor_page_release(file);
+  return ret;
+}
+
+/**
+ * @brief Stop reading pages from the loaded file (another one is attached).
+ *
+ * @return Returns 0 on success, -1 if a block could not be moved (the file
+ *         stays attached).
+ */
+int editor_page_detach(void) {
+  if (!C.file) return 0;
+  if (cold_detach_blocks(C.file) == -1) return -1;
+
+  editor_page_release(C.file);
+  C.file = NULL;
+  return 0;
+}
+
+/**
+ * @brief Move every block read from `path` out of it before it is
+ *        rewritten, whichever buffer the blocks belong to (a save, the hex
+ *        view). The file takes no new blocks afterwards.
+ *
+ * @return Returns 0 on success, -1 if a block could not be moved.
+ */
+int editor_page_detach_path(const char *path) {
+  struct stat st;
+  if (stat(path, &st) == -1) return 0;   // No such file: nothing reads from it
+
+  for (cold_file_t *f = C.files, *next; f; f = next) {
+    next = f->next;
+    if (f->dev != (uint64_t)st.st_dev || f->ino != (uint64_t)st.st_ino) continue;
+
+    f->stale = true;
+    f->refs ++;   // Keep `f` (and `next`) while its blocks are moved
+    int ret = cold_detach_blocks(f);
+    next = f->next;
+    editor_page_release(f);
+    if (ret == -1) return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Swap the attached file with the one of the buffer being shown.
+ *
+ * @param file The file of that buffer (NULL if none).
+ *
+ * @return Returns the file that was attached, which the caller now owns.
+ */
+struct cold_file *editor_page_swap(struct cold_file *file) {
+  cold_file_t *old = C.file;
+  C.file = file;
+  return old;
+}
+
+/**
+ * @brief Drop a reference to a file returned by editor_page_swap(). The file
+ *        is closed once no block reads from it any more.
+ */
+void editor_page_release(struct cold_file *file) {
+  if (!file || -- file->refs > 0) return;
+
+  for (cold_file_t **p = &C.files; *p; p = &(*p)->next) {
+    if (*p == file) {
+      *p = file->next;
+      break;
+    }
+  }
+  close(file->fd);
+  zilo_free(MEM_COLD, file);
+}
@@ -0,0 +1,534 @@
+#define ZILO_LOG_MODULE LOG_MODULE_INPUT
+#include "command.h"
+#include "buffer.h"
+#include "cold.h"
+#include "file.h"
+#include "follow.h"
+#include "hex.h"
+#include "intern.h"
+#include "mem.h"
+#include "output.h"
+#include "page.h"
+#include "pool.h"
+#include "row.h"
+#include "snapshot.h"
+#include "syntax.h"
+#include "trace.h"
+#include "wrap.h"
+#include "zilo.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+  const char *name;                 // Command name (":name arg")
+  void (*handler)(const char *arg); // Handler, `arg` is never NULL
+} editor_command_t;
+
+/**
+ * @brief :set {option} -- change an editor option.
+ *
+ * Supported options:
+ *  - wrap / nowrap: soft-wrap long rows
+ *  - stats / nostats: keystroke latency percentiles in the status bar
+ *  - mem / nomem: live and peak heap usage in the status bar
+ *  - follow / nofollow: append what the file gains on disk (tail -f)
+ *  - intern / nointern: identical rows share one copy of their bytes
+ *  - compress[=MiB] / nocompress: compress rows far from the view once row
+ *    memory passes the budget (COLD_DEFAULT_MIB by default)
+ *  - page[=MiB] / nopage: as compress, and also drop whole pages of rows
+ *    and blocks to the file (or a temp file), so that a buffer need not fit
+ *    in memory (see page.c)
+ *
+ * @param arg Option name.
+ */
+static void command_set(const char *arg) {
+  if (!strcmp(arg, "wrap") || !strcmp(arg, "nowrap")) {
+    E.wrap = arg[0] != 'n';
+    E.coloff = 0;
+    E.lineoff = 0;
+    editor_wrap_invalidate();
+    return;
+  }
+
+  if (!strcmp(arg, "stats") || !strcmp(arg, "nostats")) {
+    E.show_stats = arg[0] != 'n';
+    return;
+  }
+
+  if (!strcmp(arg, "mem") || !strcmp(arg, "nomem")) {
+    E.show_mem = arg[0] != 'n';
+    return;
+  }
+
+  if (!strcmp(arg, "follow")) {
+    if (editor_follow_start() == -1) editor_set_status_message("Cannot follow this file");
+    return;
+  }
+
+  if (!strcmp(arg, "nofollow")) {
+    editor_follow_stop();
+    return;
+  }
+
+  if (!strcmp(arg, "intern")) {
+    E.intern = true;
+    int rows = editor_intern_rows();
+    intern_stats_t st;
+    intern_stats(&st);
+    editor_set_status_message("%d rows share %lld copies (%lld KiB saved)",
+                              rows, (long long)st.strings, (long long)(st.saved / 1024));
+    return;
+  }
+
+  if (!strcmp(arg, "nointern")) {
+    E.intern = false;
+    return;
+  }
+
+  if (!strncmp(arg, "compress", 8) && (arg[8] == '\0' || arg[8] == '=')) {
+    long long mib = arg[8] == '=' ? atoll(arg + 9) : COLD_DEFAULT_MIB;
+    if (mib <= 0) {
+      editor_set_status_message("compress: the budget is a number of MiB");
+      return;
+    }
+    editor_cold_set_budget(mib * 1024 * 1024);
+    editor_cold_sweep();
+
+    cold_stats_t st;
+    editor_cold_stats(&st);
+    editor_set_status_message("compress: %lld MiB budget, %lld rows in %lld blocks (%lld -> %lld KiB)",
+                              mib, (long long)st.rows, (long long)st.blocks,
+                              (long long)(st.raw_bytes / 1024), (long long)(st.zip_bytes / 1024));
+    return;
+  }
+
+  if (!strcmp(arg, "nocompress")) {
+    editor_cold_set_budget(0);
+    return;
+  }
+
+  if (!strncmp(arg, "page", 4) && (arg[4] == '\0' || arg[4] == '=')) {
+    long long mib = arg[4] == '=' ? atoll(arg + 5) : COLD_DEFAULT_MIB;
+    if (mib <= 0) {
+      editor_set_status_message("page: the budget is a number of MiB");
+      return;
+    }
+    if (!editor_page_enabled()) {
+      editor_page_enable(true);
+      // The rows may only be read back if the file is still what was loaded
+      int fd = E.filename && !editor_file_changed() ? open(E.filename, O_RDONLY) : -1;
+      if (fd != -1) {
+        editor_page_attach(fd);
+        close(fd);
+      }
+    }
+    editor_cold_set_budget(mib * 1024 * 1024);
+    editor_cold_sweep();
+
+    cold_stats_t st;
+    editor_cold_stats(&st);
+    page_stats_t ps;
+    editor_pages_stats(&ps);
+    editor_set_status_message("page: %lld MiB budget, %lld of %lld pages out, %lld rows in %lld blocks, %lld KiB spilled",
+                              mib, (long long)(ps.in_file + ps.in_temp), (long long)ps.pages,
+                              (long long)st.rows, (long long)st.blocks,
+                              (long long)((st.temp_bytes + ps.temp_bytes) / 1024));
+    return;
+  }
+
+  if (!strcmp(arg, "nopage")) {
+    editor_page_enable(false);
+    return;
+  }
+
+  editor_set_status_message("Unknown option: %s", arg);
+}
+
+/**
+ * @brief :trace -- write the recorded spans to the ZILO_TRACE file now.
+ *
+ * @param arg Unused.
+ */
+static void command_trace(const char *arg) {
+  (void)arg;
+
+  if (!zilo_trace_enabled) {
+    editor_set_status_message("Tracing is off (set ZILO_TRACE=path)");
+    return;
+  }
+
+  int n = zilo_trace_dump();
+  if (n < 0) editor_set_status_message("Failed to write the trace file");
+  else editor_set_status_message("%d trace events written", n);
+}
+
+/*------------------------------------------
+              BACKGROUND JOBS
+ ------------------------------------------*/
+#define WC_PROGRESS_ROWS 4096
+
+typedef struct {
+  row_snapshot_t *snap;
+  int64_t words;
+} wc_job_t;
+
+static pool_token_t *g_jobs_token = NULL;   // Cancels every job started by a command
+
+/**
+ * @brief Token for a new job (created again after :cancel).
+ */
+static pool_token_t *command_jobs_token(void) {
+  if (!g_jobs_token) g_jobs_token = pool_token_new();
+  return g_jobs_token;
+}
+
+static int wc_work(pool_job_t *job, void *arg) {
+  wc_job_t *wc = arg;
+  const row_snapshot_t *snap = wc->snap;
+
+  int64_t words = 0;
+  for (int i = 0; i < snap->numrows; ++ i) {
+    if (i % WC_PROGRESS_ROWS == 0) {
+      if (pool_job_cancelled(job)) return POOL_CANCELLED;
+      pool_job_progress(job, i, snap->numrows);
+    }
+
+    int len;
+    const char *s = snapshot_row(snap, i, &len);
+    bool in_word = false;
+    for (int j = 0; j < len; ++ j) {
+      bool space = isspace((unsigned char)s[j]);
+      if (!space && !in_word) words ++;
+      in_word = !space;
+    }
+  }
+
+  wc->words = words;
+  return 0;
+}
+
+static void wc_progress(void *arg, int64_t done, int64_t total) {
+  (void)arg;
+  editor_set_status_message("wc: %d%%", total ? (int)(done * 100 / total) : 100);
+}
+
+static void wc_done(void *arg, int status) {
+  wc_job_t *wc = arg;
+  if (status == 0) {
+    editor_set_status_message("%d lines, %lld words, %lld bytes",
+                              wc->snap->numrows, (long long)wc->words, (long long)wc->snap->size);
+  }
+  editor_snapshot_release(wc->snap);
+  zilo_free(MEM_POOL, wc);
+}
+
+/**
+ * @brief :wc -- count lines, words and bytes on a worker thread.
+ *
+ * @param arg Unused.
+ */
+static void command_wc(const char *arg) {
+  (void)arg;
+
+  wc_job_t *wc = zilo_malloc(MEM_POOL, sizeof(wc_job_t));
+  if (!wc) return;
+  wc->snap = editor_snapshot_take();
+  wc->words = 0;
+
+  if (!wc->snap || pool_submit(command_jobs_token(), wc_work, wc_progress, wc_done, wc) == -1) {
+    editor_set_status_message("wc: cannot start a background job");
+    editor_snapshot_release(wc->snap);
+    zilo_free(MEM_POOL, wc);
+  }
+}
+
+/**
+ * @brief :cancel -- stop every background job started by a command.
+ *
+ * @param arg Unused.
+ */
+static void command_cancel(const char *arg) {
+  (void)arg;
+
+  int busy = pool_busy();
+  pool_token_cancel(g_jobs_token);
+  pool_token_release(g_jobs_token);
+  g_jobs_token = NULL;
+  editor_set_status_message("%d job(s) cancelled", busy);
+}
+
+/**
+ * @brief :w [file] -- save, under a new name if one is given (text read
+ *        from stdin has none until then).
+ *
+ * @param arg File name (empty: the current one).
+ */
+static void command_write(const char *arg) {
+  if (editor_hex() && arg[0] == '\0') {
+    editor_hex_save();
+    return;
+  }
+
+  if (arg[0] != '\0') {
+    char *name = zilo_strdup(MEM_FILE, arg);
+    if (!name) return;
+    zilo_free(MEM_FILE, E.filename);
+    E.filename = name;
+    E.file_stamp = (file_stamp_t){ 0 };   // Another file: written whole
+    E.file_refused = (file_stamp_t){ 0 };
+    editor_select_syntax();
+  }
+  editor_save();
+}
+
+/**
+ * @brief :diff -- compare the rows with the file on disk (by line hashes)
+ *        and move to the first row that differs.
+ *
+ * @param arg Unused.
+ */
+static void command_diff(const char *arg) {
+  (void)arg;
+
+  int from, to, disk_to;
+  int ret = editor_file_diff(&from, &to, &disk_to);
+  if (ret == -1) {
+    editor_set_status_message("diff: cannot read <%s>", E.filename ? E.filename : "[No Name]");
+    return;
+  }
+  if (ret == 0) {
+    editor_set_status_message("No difference with <%s>", E.filename);
+    return;
+  }
+
+  E.cy = MIN(from, MAX(E.numrows - 1, 0));
+  E.cx = 0;
+  if (to == from) {
+    editor_set_status_message("Lines %d-%d on disk are not in the buffer", from + 1, disk_to);
+  } else if (disk_to == from) {
+    editor_set_status_message("Rows %d-%d are not on disk", from + 1, to);
+  } else {
+    editor_set_status_message("Rows %d-%d differ from lines %d-%d on disk",
+                              from + 1, to, from + 1, disk_to);
+  }
+}
+
+/**
+ * @brief :checktime -- tell whether the file changed on disk since it was
+ *        read or saved.
+ *
+ * @param arg Unused.
+ */
+static void command_checktime(const char *arg) {
+  (void)arg;
+
+  if (!E.filename) {
+    editor_set_status_message("checktime: no file");
+    return;
+  }
+  editor_set_status_message(editor_file_changed() ? "<%s> changed on disk" : "<%s> is unchanged on disk",
+                            E.filename);
+}
+
+/**
+ * @brief :hex [file] -- show a file (the current one by default) as bytes;
+ *        :hex again goes back to the rows.
+ *
+ * @param arg File name (empty: the current one).
+ */
+static void command_hex(const char *arg) {
+  if (arg[0] == '\0' && editor_hex()) {
+    if (editor_hex()->ndirty > 0) editor_set_status_message("Unsaved bytes dropped");
+    editor_hex_close();
+    return;
+  }
+
+  const char *name = arg[0] != '\0' ? arg : E.filename;
+  if (!name) {
+    editor_set_status_message("hex: a file name is needed");
+    return;
+  }
+  if (editor_hex_open(name) == -1) editor_set_status_message("hex: cannot map <%s>", name);
+}
+
+/**
+ * @brief :go {offset} -- move to a byte of the hex view (decimal, 0x hex or
+ *        0 octal).
+ *
+ * @param arg Offset.
+ */
+static void command_go(const char *arg) {
+  char *end;
+  long long off = strtoll(arg, &end, 0);
+  if (!editor_hex() || arg[0] == '\0' || *end != '\0') {
+    editor_set_status_message(editor_hex() ? "go: an offset is needed" : "go: only in the hex view");
+    return;
+  }
+  editor_hex_goto(off);
+}
+
+/*------------------------------------------
+             BUFFERS AND WINDOWS
+ ------------------------------------------*/
+/**
+ * @brief :e {file} -- edit a file in the current window (a file already
+ *        loaded is switched to).
+ *
+ * @param arg File name.
+ */
+static void command_edit(const char *arg) {
+  if (arg[0] == '\0') {
+    editor_set_status_message("e: a file name is needed");
+    return;
+  }
+  if (editor_buffer_edit(arg) == -1) editor_set_status_message("e: cannot open <%s>", arg);
+}
+
+/**
+ * @brief :bn -- show the next buffer in the current window.
+ *
+ * @param arg Unused.
+ */
+static void command_bnext(const char *arg) {
+  (void)arg;
+  editor_buffer_cycle(1);
+}
+
+/**
+ * @brief :bp -- show the previous buffer in the current window.
+ *
+ * @param arg Unused.
+ */
+static void command_bprev(const char *arg) {
+  (void)arg;
+  editor_buffer_cycle(-1);
+}
+
+/**
+ * @brief :ls -- list the buffers in the status bar.
+ *
+ * @param arg Unused.
+ */
+static void command_ls(const char *arg) {
+  (void)arg;
+  char list[sizeof(E.statusmsg)];
+  editor_buffer_list(list, sizeof(list));
+  editor_set_status_message("%s", list);
+}
+
+/**
+ * @brief :sp [file] -- split the current window, then edit `file` in the new one.
+ *
+ * @param arg File name (empty: the same buffer).
+ */
+static void command_split(const char *arg) {
+  if (editor_window_split() == -1) {
+    editor_set_status_message("sp: no room for another window");
+    return;
+  }
+  if (arg[0] != '\0') command_edit(arg);
+}
+
+/**
+ * @brief :close -- close the current window.
+ *
+ * @param arg Unused.
+ */
+static void command_close(const char *arg) {
+  (void)arg;
+  if (editor_window_close() == -1) editor_set_status_message("close: cannot close the last window");
+}
+
+/**
+ * @brief :only -- close every other window.
+ *
+ * @param arg Unused.
+ */
+static void command_only(const char *arg) {
+  (void)arg;
+  editor_window_only();
+}
+
+static const editor_command_t commands[] = {
+  { "set", command_set },
+  { "trace", command_trace },
+  { "wc", command_wc },
+  { "cancel", command_cancel },
+  { "w", command_write },
+  { "hex", command_hex },
+  { "go", command_go },
+  { "diff", command_diff },
+  { "checktime", command_checktime },
+  { "e", command_edit },
+  { "bn", command_bnext },
+  { "bp", command_bprev },
+  { "ls", command_ls },
+  { "sp", command_split },
+  { "close", command_close },
+  { "only", command_only },
+};
+
+#define COMMANDS_SIZE (sizeof(commands) / sizeof(commands[0]))
+
+/**
+ * @brief Start typing a command line (':' in Normal mode).
+ */
+void editor_command_start(void) {
+  E.mode = MODE_COMMAND;
+  E.cmdlen = 0;
+  E.cmdbuf[0] = '\0';
+}
+
+/**
+ * @brief Handle a key typed on the command line.
+ *
+ * @param c The key.
+ */
+void editor_command_keypress(char c) {
+  if (c == 27) {
+    E.mode = MODE_NORMAL;
+  }
+  else if (c == '\r') {
+    E.mode = MODE_NORMAL;
+    editor_command_execute(E.cmdbuf);
+  }
+  else if (c == 127 || c == 8) {
+    // Deleting past the ':' leaves the command line
+    if (E.cmdlen == 0) E.mode = MODE_NORMAL;
+    else E.cmdbuf[-- E.cmdlen] = '\0';
+  }
+  else if ((unsigned char)c >= 32 && E.cmdlen < (int)sizeof(E.cmdbuf) - 1) {
+    E.cmdbuf[E.cmdlen ++] = c;
+    E.cmdbuf[E.cmdlen] = '\0';
+  }
+}
+
+/**
+ * @brief Execute a command line (without the leading ':').
+ *
+ * @param line Command line, e.g. "set wrap".
+ */
+void editor_command_execute(const char *line) {
+  while (*line == ' ') line ++;
+  if (*line == '\0') return;
+
+  // Split "name arg"
+  size_t name_len = strcspn(line, " ");
+  const char *arg = line + name_len;
+  while (*arg == ' ') arg ++;
+
+  for (size_t i = 0; i < COMMANDS_SIZE; ++ i) {
+    if (strlen(commands[i].name) == name_len &&
+        !strncmp(commands[i].name, line, name_len)) {
+      commands[i].handler(arg);
+      return;
+    }
+  }
+
+  editor_set_status_message("Not an editor command: %s", line);
+}
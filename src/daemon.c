@@ -0,0 +1,534 @@
+#define _GNU_SOURCE   // struct ucred (SO_PEERCRED)
+#define ZILO_LOG_MODULE LOG_MODULE_FILE
+#include "daemon.h"
+#include "buffer.h"
+#include "cold.h"
+#include "file.h"
+#include "hex.h"
+#include "input.h"
+#include "logger.h"
+#include "mem.h"
+#include "output.h"
+#include "pool.h"
+#include "terminal.h"
+#include "zilo.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+ * Server mode. `zilo --daemon` keeps buffers (rows, compressed blocks,
+ * pages) loaded between sessions; `zilo file` connects to it over a Unix
+ * socket and is only a terminal: it sends its size and the file name,
+ * then every key, and writes the frames it gets back.
+ *
+ * Every client is a session with its own windows (a layout, see buffer.h),
+ * hex view, mode, command line and messages (a copy of E). Sessions are
+ * served one at a time on this thread: the session being served is
+ * loaded into E and the others are parked, so all editing code runs as
+ * it does in a terminal. After each event every session gets a new
+ * frame, so clients on the same buffer see each other's edits.
+ *
+ * Client sockets are non-blocking and frames are queued per session. A
+ * frame repaints the whole screen, so one the client has not started to
+ * read is replaced by the next: a client that stops reading holds two
+ * frames at most and never holds up the others.
+ *
+ * A file already loaded opens with no reading at all, in the place the
+ * last client left it. 'q' detaches the client; the buffers stay.
+ *
+ * Both ends check that the other runs as the same user (SO_PEERCRED): the
+ * socket may sit in /tmp, where another user could have created it.
+ */
+
+#define DAEMON_HELLO_MAGIC "ZILO1"
+#define DAEMON_READ_SIZE   4096
+
+typedef struct {
+  int fd;
+  bool ready;                   // The first line was read
+  char hello[DAEMON_HELLO_MAX];
+  int hello_len;
+  editor_config_t state;        // E while another session is served
+  layout_t layout;              // Its windows, likewise
+  hex_park_t hex;               // Its hex view, likewise
+  char *out;                    // Frame being sent, from `out_at` on (NULL: none)
+  int out_len;
+  int out_at;
+  char *next;                   // Newest frame, sent after `out` (NULL: none)
+  int next_len;
+  bool broken;                  // A write failed: the client is gone
+} session_t;
+
+typedef struct {
+  int listen_fd;
+  char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+  session_t *sessions[DAEMON_MAX_CLIENTS];
+  int nsessions;
+  session_t *active;            // The session loaded in E (NULL: none)
+  editor_config_t blank;        // E as init_editor() left it, for new sessions
+} daemon_t;
+
+static daemon_t D = { .listen_fd = -1 };
+static volatile sig_atomic_t g_stop = 0;
+
+/**
+ * @brief Path of the daemon socket: $XDG_RUNTIME_DIR/zilo.sock, or
+ *        /tmp/zilo-<uid>.sock.
+ */
+void editor_daemon_socket_path(char *out, size_t size) {
+  const char *dir = getenv("XDG_RUNTIME_DIR");
+  if (dir && dir[0]) snprintf(out, size, "%s/zilo.sock", dir);
+  else snprintf(out, size, "/tmp/zilo-%u.sock", (unsigned)getuid());
+}
+
+/**
+ * @brief Fill `addr` with the socket path.
+ *
+ * @return Returns 0 on success, -1 if the path is too long.
+ */
+static int daemon_address(struct sockaddr_un *addr) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  editor_daemon_socket_path(addr->sun_path, sizeof(addr->sun_path));
+  return strlen(addr->sun_path) + 1 < sizeof(addr->sun_path) ? 0 : -1;
+}
+
+/**
+ * @brief True if the process at the other end of `fd` runs as this user.
+ */
+static bool daemon_peer_trusted(int fd) {
+  struct ucred cred;
+  socklen_t len = sizeof(cred);
+  return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0 && cred.uid == getuid();
+}
+
+/*------------------------------------------
+                 SESSIONS
+ ------------------------------------------*/
+/**
+ * @brief Load session `s` into E, parking the one there (NULL: park only).
+ */
+static void session_enter(session_t *s) {
+  if (D.active == s) return;
+
+  if (D.active) {
+    editor_layout_park(&D.active->layout);
+    editor_hex_park(&D.active->hex);
+    D.active->state = E;
+  }
+  if (s) {
+    E = s->state;
+    editor_layout_load(&s->layout);
+    editor_hex_load(&s->hex);
+  } else {
+    E = D.blank;
+  }
+  D.active = s;
+}
+
+/**
+ * @brief Send what the client takes of the queued frames without blocking.
+ *
+ * @return Returns false if the client is gone.
+ */
+static bool session_flush(session_t *s) {
+  while (s->out) {
+    ssize_t n = write(s->fd, s->out + s->out_at, s->out_len - s->out_at);
+    if (n == -1 && errno == EINTR) continue;
+    if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+    if (n <= 0) return false;
+
+    s->out_at += n;
+    if (s->out_at < s->out_len) continue;
+
+    zilo_free(MEM_FRAME, s->out);
+    s->out = s->next;
+    s->out_len = s->next_len;
+    s->out_at = 0;
+    s->next = NULL;
+    s->next_len = 0;
+  }
+  return true;
+}
+
+/**
+ * @brief Frame sink of a session: queue the frame in place of a stale one
+ *        and send what the client takes.
+ */
+static void session_frame(const char *frame, int len, void *arg) {
+  session_t *s = arg;
+  char *copy = zilo_malloc(MEM_FRAME, len);
+  if (!copy) return;   // The next frame repaints the screen anyway
+  memcpy(copy, frame, len);
+
+  if (s->out && s->out_at > 0) {
+    // Part of `out` is on its way: the rest must follow, then this frame
+    zilo_free(MEM_FRAME, s->next);
+    s->next = copy;
+    s->next_len = len;
+  } else {
+    zilo_free(MEM_FRAME, s->out);
+    s->out = copy;
+    s->out_len = len;
+    s->out_at = 0;
+  }
+
+  if (!session_flush(s)) s->broken = true;
+}
+
+/**
+ * @brief Draw a frame of session `s` for its client.
+ */
+static void session_render(session_t *s) {
+  session_enter(s);
+  editor_set_output_sink(session_frame, s);
+  editor_refresh_screen();
+  editor_set_output_sink(NULL, NULL);
+}
+
+/**
+ * @brief Detach a client. The buffers it showed stay loaded.
+ */
+static void session_close(session_t *s) {
+  if (s->ready) {
+    session_enter(s);
+    editor_hex_close();
+    session_enter(NULL);
+  }
+
+  for (int i = 0; i < D.nsessions; ++ i) {
+    if (D.sessions[i] == s) {
+      D.sessions[i] = D.sessions[-- D.nsessions];
+      break;
+    }
+  }
+  close(s->fd);
+  zilo_free(MEM_FRAME, s->out);
+  zilo_free(MEM_FRAME, s->next);
+  zilo_free(MEM_FILE, s);
+  LOG_INFO("session_close", "Client detached (%d left).", D.nsessions);
+}
+
+/**
+ * @brief Parse the first line of a client and open its file.
+ *
+ * @return Returns 0 on success, -1 if the line is not valid.
+ */
+static int session_start(session_t *s) {
+  int rows, cols, used = 0;
+  s->hello[s->hello_len - 1] = '\0';
+  if (sscanf(s->hello, DAEMON_HELLO_MAGIC " %d %d %n", &rows, &cols, &used) != 2 ||
+      used == 0 || rows < 1 || cols < 1 || s->hello[used] == '\0') {
+    LOG_WARN("session_start", "Invalid first line from a client.");
+    return -1;
+  }
+
+  session_enter(NULL);
+  E.screenrows = rows;
+  E.screencols = cols;
+  E.headless = true;   // 'q' detaches instead of exiting
+  if (editor_layout_open(s->hello + used) == -1) return -1;
+
+  D.active = s;
+  s->ready = true;
+  editor_set_status_message("Attached to the zilo daemon (%d client(s)).", D.nsessions);
+  LOG_INFO("session_start", "Client attached to <%s>.", E.filename);
+
+  // A buffer kept loaded may be older than its file: reload it unless it
+  // has edits, which a reload would lose
+  if (editor_file_changed()) {
+    if (!editor_file_modified() && editor_file_reload() == 0) {
+      editor_set_status_message("<%s> changed on disk: reloaded", E.filename);
+    } else {
+      editor_set_status_message("<%s> changed on disk since it was read (:diff compares)", E.filename);
+    }
+    LOG_INFO("session_start", "<%s> changed on disk.", E.filename);
+  }
+  return 0;
+}
+
+/**
+ * @brief Apply what a client sent: the first line, then keys.
+ *
+ * @return Returns false once the session is over (the client left or pressed 'q').
+ */
+static bool session_read(session_t *s) {
+  char buf[DAEMON_READ_SIZE];
+  ssize_t n = read(s->fd, buf, sizeof(buf));
+  if (n <= 0) return n == -1 && (errno == EINTR || errno == EAGAIN);
+
+  ssize_t at = 0;
+  if (!s->ready) {
+    while (at < n && s->hello_len < DAEMON_HELLO_MAX) {
+      char c = buf[at ++];
+      s->hello[s->hello_len ++] = c;
+      if (c == '\n') break;
+    }
+    if (s->hello[s->hello_len - 1] != '\n') return s->hello_len < DAEMON_HELLO_MAX;
+    if (session_start(s) == -1) return false;
+  }
+
+  session_enter(s);
+  for (; at < n; ++ at) {
+    editor_process_key(buf[at]);
+    if (E.quit) return false;
+  }
+  editor_cold_sweep();
+  return true;
+}
+
+/*------------------------------------------
+                  SERVER
+ ------------------------------------------*/
+static void daemon_on_signal(int sig) {
+  (void)sig;
+  g_stop = 1;
+}
+
+/**
+ * @brief Bind the socket. A socket nobody answers on is left over from a
+ *        daemon that died and is replaced.
+ *
+ * @return Returns 0 on success, -1 on failure (another daemon is running).
+ */
+static int daemon_listen(void) {
+  struct sockaddr_un addr;
+  if (daemon_address(&addr) == -1) {
+    fprintf(stderr, "zilo: the socket path is too long\n");
+    return -1;
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd == -1) return -1;
+
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+    fprintf(stderr, "zilo: a daemon is already listening on %s\n", addr.sun_path);
+    close(fd);
+    return -1;
+  }
+  unlink(addr.sun_path);
+
+  // Only this user may connect (peers are checked on accept as well)
+  mode_t mask = umask(0077);
+  int ret = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+  umask(mask);
+  if (ret == -1 || listen(fd, 16) == -1) {
+    fprintf(stderr, "zilo: cannot listen on %s: %s\n", addr.sun_path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  D.listen_fd = fd;
+  snprintf(D.path, sizeof(D.path), "%s", addr.sun_path);
+  return 0;
+}
+
+/**
+ * @brief Accept a client (it is refused when DAEMON_MAX_CLIENTS are attached).
+ */
+static void daemon_accept(void) {
+  int fd = accept(D.listen_fd, NULL, NULL);
+  if (fd == -1) return;
+
+  if (!daemon_peer_trusted(fd)) {
+    LOG_WARN("daemon_accept", "Client of another user refused.");
+    close(fd);
+    return;
+  }
+
+  session_t *s = D.nsessions < DAEMON_MAX_CLIENTS ? zilo_calloc(MEM_FILE, 1, sizeof(session_t)) : NULL;
+  if (!s) {
+    LOG_WARN("daemon_accept", "Client refused (%d attached).", D.nsessions);
+    close(fd);
+    return;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  s->fd = fd;
+  D.sessions[D.nsessions ++] = s;
+}
+
+/**
+ * @brief Serve clients until SIGINT or SIGTERM (`zilo --daemon`).
+ *
+ * @return Returns the exit status.
+ */
+int editor_daemon_run(void) {
+  if (daemon_listen() == -1) return 1;
+
+  struct sigaction sa = { .sa_handler = daemon_on_signal };
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);   // A client may vanish while a frame is written
+
+  zilo_log_init("zilo.log");
+  LOG_INFO("editor_daemon_run", "Listening on <%s>.", D.path);
+  fprintf(stderr, "zilo: listening on %s\n", D.path);
+
+  init_editor();
+  D.blank = E;
+
+  while (!g_stop) {
+    struct pollfd pfds[2 + DAEMON_MAX_CLIENTS];
+    pfds[0] = (struct pollfd){ .fd = D.listen_fd, .events = POLLIN };
+    pfds[1] = (struct pollfd){ .fd = pool_wake_fd(), .events = POLLIN };
+    for (int i = 0; i < D.nsessions; ++ i) {
+      session_t *s = D.sessions[i];
+      pfds[2 + i] = (struct pollfd){ .fd = s->fd, .events = POLLIN | (s->out ? POLLOUT : 0) };
+    }
+
+    int nfds = 2 + D.nsessions;
+    if (poll(pfds, nfds, -1) == -1) continue;   // EINTR: check g_stop
+
+    // Sessions from the end, so closing one does not move those not read yet
+    for (int i = nfds - 1; i >= 2; -- i) {
+      if (!pfds[i].revents) continue;
+      session_t *s = D.sessions[i - 2];
+      bool ok = true;
+      if (pfds[i].revents & POLLOUT) ok = session_flush(s);
+      if (ok && (pfds[i].revents & ~POLLOUT)) ok = session_read(s);
+      if (!ok) session_close(s);
+    }
+    if (pfds[0].revents) daemon_accept();
+
+    // Background job results go to the session that started them, or the last one served
+    pool_dispatch();
+
+    for (int i = 0; i < D.nsessions; ++ i) {
+      if (D.sessions[i]->ready) session_render(D.sessions[i]);
+    }
+    for (int i = D.nsessions - 1; i >= 0; -- i) {
+      if (D.sessions[i]->broken) session_close(D.sessions[i]);
+    }
+  }
+
+  LOG_INFO("editor_daemon_run", "Stopping with %d client(s) attached.", D.nsessions);
+  while (D.nsessions > 0) session_close(D.sessions[0]);
+
+  pool_shutdown();
+  free_editor();
+  close(D.listen_fd);
+  unlink(D.path);
+  zilo_mem_report();
+  zilo_log_close();
+  return 0;
+}
+
+/*------------------------------------------
+                  CLIENT
+ ------------------------------------------*/
+/**
+ * @brief Absolute path of `filename` (which may not exist yet), so that
+ *        every client names a file the same way.
+ *
+ * @return Returns 0 on success, -1 if the path cannot be made absolute
+ *         (the daemon would resolve a relative one against its own cwd).
+ */
+static int client_absolute_path(const char *filename, char *out, size_t size) {
+  char *real = realpath(filename, NULL);
+  if (real) {
+    int len = snprintf(out, size, "%s", real);
+    free(real);
+    return len < (int)size ? 0 : -1;
+  }
+
+  if (filename[0] == '/') return snprintf(out, size, "%s", filename) < (int)size ? 0 : -1;
+
+  char cwd[PATH_MAX];
+  if (!getcwd(cwd, sizeof(cwd))) return -1;
+  return snprintf(out, size, "%s/%s", cwd, filename) < (int)size ? 0 : -1;
+}
+
+/**
+ * @brief Write all of `len` bytes.
+ *
+ * @return Returns 0 on success, -1 on failure.
+ */
+static int client_write_all(int fd, const char *buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, buf, len);
+    if (n == -1 && errno == EINTR) continue;
+    if (n <= 0) return -1;
+    buf += n;
+    len -= n;
+  }
+  return 0;
+}
+
+/**
+ * @brief Edit `filename` in a running daemon: keys go to the socket,
+ *        frames come back to the terminal.
+ *
+ * @return Returns 0 once the session is over, -1 if no daemon of this
+ *         user answers (nothing was changed on the terminal).
+ */
+int editor_client_run(const char *filename) {
+  struct sockaddr_un addr;
+  if (daemon_address(&addr) == -1) return -1;
+
+  char path[PATH_MAX];
+  if (client_absolute_path(filename, path, sizeof(path)) == -1) return -1;
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd == -1) return -1;
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+    close(fd);
+    return -1;
+  }
+
+  // Keys and file names go only to a daemon of this user
+  if (!daemon_peer_trusted(fd)) {
+    LOG_WARN("editor_client_run", "<%s> is served by another user: not attached.", addr.sun_path);
+    close(fd);
+    return -1;
+  }
+
+  int rows, cols;
+  get_window_size(&rows, &cols);
+
+  char hello[DAEMON_HELLO_MAX];
+  int len = snprintf(hello, sizeof(hello), DAEMON_HELLO_MAGIC " %d %d %s\n", rows, cols, path);
+  if (len >= (int)sizeof(hello) || client_write_all(fd, hello, len) == -1) {
+    close(fd);
+    return -1;
+  }
+  LOG_INFO("editor_client_run", "Attached to <%s> for <%s>.", addr.sun_path, path);
+
+  enable_raw_mode();
+
+  char buf[DAEMON_READ_SIZE];
+  while (1) {
+    struct pollfd pfds[2] = {
+      { .fd = STDIN_FILENO, .events = POLLIN },
+      { .fd = fd, .events = POLLIN },
+    };
+    if (poll(pfds, 2, -1) == -1) {
+      if (errno == EINTR) continue;
+      break;
+    }
+
+    if (pfds[1].revents) {
+      ssize_t n = read(fd, buf, sizeof(buf));
+      if (n <= 0) break;   // The session is over
+      if (client_write_all(STDOUT_FILENO, buf, n) == -1) break;
+    }
+    if (pfds[0].revents) {
+      ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+      if (n > 0 && client_write_all(fd, buf, n) == -1) break;
+    }
+  }
+
+  close(fd);
+  return 0;
+}
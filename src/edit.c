@@ -1,6 +1,11 @@
+#define ZILO_LOG_MODULE LOG_MODULE_EDIT
 #include "edit.h"
+#include "page.h"
 #include "row.h"
 #include "logger.h"
+#include "syntax.h"
+#include "trace.h"
+#include "wrap.h"
 #include "zilo.h"
 #include <stddef.h>
 #include <stdlib.h>
@@ -13,6 +18,8 @@
  * @param c Inserted character.
  */
 void editor_insert_char(int c) {
+  TRACE_SPAN("insert_char");
+
   // Empty file, at this point E.cy = 0, E.numrows = 0
   if (E.cy == E.numrows) {
     // Append an empty line
@@ -20,7 +27,7 @@ void editor_insert_char(int c) {
   }
 
   // Insert character
-  erow_t *row = &E.row[E.cy];
+  erow_t *row = editor_row_at(E.cy);
   editor_row_insert_char(row, E.cx, c);
 
   // Update
@@ -37,52 +44,49 @@ void editor_insert_char(int c) {
  * @param len String length.
  */
 void editor_insert_row(int at, char *s, size_t len) {
+  TRACE_SPAN("insert_row");
+
   if (at < 0 || at > E.numrows) return;
 
-  // Expand `row` array
-  erow_t *new = realloc(E.row, sizeof(erow_t) * (E.numrows + 1));
-  if (!new) LOG_ERROR("realloc", "Failed to expand memory.");
-  E.row = new;
+  // Initialize the new line first so a failure leaves the buffer unchanged
+  erow_t row;
+  if (editor_row_init(&row, s, len) == -1) return;
 
-  // Move all lines after the 'at' key to the right
-  memmove(&E.row[at + 1], &E.row[at], sizeof(erow_t) * (E.numrows - at));
+  // Move all lines after the 'at' key to the right (E.numrows follows)
+  if (editor_rows_insert(at, &row) == -1) {
+    editor_row_release(&row);
+    return;
+  }
 
-  // Initialize a newline at the `at` position
-  E.row[at].size = len;
-  E.row[at].chars = malloc(len + 1);
-  memcpy(E.row[at].chars, s, len);
-  E.row[at].chars[len] = '\0';
+  // Update
+  E.modified_rows ++;
+  editor_wrap_insert_row(at);
 
-  // Update total number of rows
-  E.numrows ++;
+  editor_update_row(editor_row_at(at));
 }
 
 /**
  * @brief Insert a newline character at the current cursor position (Enter key logic).
  */
 void editor_insert_newline(void) {
+  TRACE_SPAN("insert_newline");
+
   if (E.cx == 0) {
     // If the cursor is at the beginning of the line, 
     // simply insert a blank line above the current line
     editor_insert_row(E.cy, "", 0);
   } else {
-    // Get the current row object
-    erow_t *row = &E.row[E.cy];
-
-    // Calculate the length of the next line
-    size_t nex_line_len = row->size - E.cx;
-
     // Insert a new line
     // The data in the next line is from the cursor position to the end of the line
-    editor_insert_row(E.cy + 1, row->chars + E.cx, nex_line_len);
+    editor_insert_row(E.cy + 1, "", 0);
 
-    // Re‑acquire the pointer to the current row 
-    // (since E.row may have been relocated by realloc)
-    row = &E.row[E.cy];
+    // Acquire the row pointers after the insertion
+    // (since its page may have been relocated by realloc or split)
+    erow_t *row = editor_row_at(E.cy);
+    editor_row_append_row(editor_row_at(E.cy + 1), row, E.cx);
 
     // It is now safe to truncate the current line
-    row->size = E.cx;
-    row->chars[row->size] = '\0';
+    editor_row_remove_range(row, E.cx, row->size - E.cx);
   }
 
   // Update cursor
@@ -94,28 +98,36 @@ void editor_insert_newline(void) {
  * @brief Delete the character to the left of the current cursor (Backspace logic).
  */
 void editor_del_left_char(void) {
+  TRACE_SPAN("del_left_char");
+
   // Get the current row object
-  erow_t *row = &E.row[E.cy];
+  erow_t *row = editor_row_at(E.cy);
+  if (!row) return;
 
   if (E.cx > 0) {
-    E.cx --;
-    editor_row_remove_char(row, E.cx);
+    // Remove the whole character (all bytes of a UTF-8 sequence)
+    int prev = editor_row_prev_char(row, E.cx);
+    editor_row_remove_range(row, prev, E.cx - prev);
+    E.cx = prev;
     return;
   } else if (E.cx == 0 && E.cy > 0) {
-    erow_t *target_row = &E.row[E.cy - 1];
+    erow_t *target_row = editor_row_at(E.cy - 1);
     size_t target_row_len = target_row->size;
 
     // Append the content of row[cy] to the target row
-    editor_row_append_string(target_row, row->chars, row->size);
+    editor_row_append_row(target_row, row, 0);
 
     // Delete row[cy]
     editor_free_row(row); // Only free chars array
-    memmove(&E.row[E.cy], &E.row[E.cy + 1], sizeof(erow_t) * (E.numrows - E.cy - 1));
+    editor_rows_remove(E.cy);
 
     // Update
     E.cx = target_row_len;
     E.cy --;
-    E.numrows --;
+    editor_wrap_delete_row(E.cy + 1);
+
+    // The row below the joined one now follows a different row
+    editor_update_syntax(E.cy + 1);
   }
 }
 
@@ -123,12 +135,19 @@ void editor_del_left_char(void) {
  * @brief Delete the current cursor position character (Normal mode 'x' logic).
  */
 void editor_del_current_char(void) {
+  TRACE_SPAN("del_current_char");
+
+  if (E.cy >= E.numrows) return;
+
   // Get the current row object
-  erow_t *row = &E.row[E.cy];
+  erow_t *row = editor_row_at(E.cy);
+  if (!row) return;
 
-  editor_row_remove_char(row, E.cx);
+  // Remove the whole character (all bytes of a UTF-8 sequence)
+  int next = editor_row_next_char(row, E.cx);
+  editor_row_remove_range(row, E.cx, next - E.cx);
 
-  if (E.cx == row->size) E.cx --;
+  if (E.cx == row->size) E.cx = editor_row_prev_char(row, row->size);
 }
 
 /**
@@ -137,17 +156,25 @@ void editor_del_current_char(void) {
  * @param at Position of the deleted line.
  */
 void editor_del_row(int at) {
+  TRACE_SPAN("del_row");
+
   // Cheeck `at` parameter
   if (at < 0 || at >= E.numrows) return;
 
   // Free characters array
-  editor_free_row(&E.row[at]);
+  erow_t *del = editor_row_at(at);
+  if (!del) return;
+  editor_free_row(del);
 
-  // Move
-  memmove(&E.row[at], &E.row[at + 1], sizeof(erow_t) * (E.numrows - at - 1));
+  // Move (E.numrows follows)
+  editor_rows_remove(at);
 
   // Update
-  E.numrows --;
+  E.generation ++;
+  editor_wrap_delete_row(at);
+
+  // The row that moved up now follows a different row
+  editor_update_syntax(at);
 
   // Correct cursor
   if (at == E.numrows) { // The last line
@@ -160,8 +187,8 @@ void editor_del_row(int at) {
     return;
   }
 
-  erow_t *row = &E.row[E.cy];
-  if (E.cx > row->size) {
+  erow_t *row = editor_row_at(E.cy);
+  if (row && E.cx > row->size) {
     E.cx = row->size;
     return;
   }
@@ -0,0 +1,129 @@
+#include "buffer.h"
+#include "follow.h"
+#include "hex.h"
+#include "logger.h"
+#include "mem.h"
+#include "output.h"
+#include "page.h"
+#include "zilo.h"
+#include "terminal.h"
+#include "replay.h"
+#include "pool.h"
+#include "row.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "stream.h"
+#include "trace.h"
+#include "wrap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+editor_config_t E;
+
+/**
+ * @brief Initialize editor state.
+ */
+void init_editor(void) {
+  E.cx = 0;
+  E.cy = 0;
+  E.rx = 0;
+
+  if (get_window_size(&E.screenrows, &E.screencols) == -1) 
+    LOG_WARN("get_window_size", "Unable to obtain terminal size, default value used.");
+
+  E.rowoff = 0;
+  E.coloff = 0;
+  E.lineoff = 0;
+
+  E.wrap = false;
+  E.show_stats = false;
+  E.show_mem = false;
+  E.headless = false;
+  E.quit = false;
+  E.intern = false;
+  E.wrap_index = (wrap_index_t){ .dirty = true };
+
+  E.numrows = 0;
+  E.rows = (row_store_t){ .hint_first = -1 };
+
+  E.filename = NULL;
+  E.file_bytes = 0;
+  E.file_eol = true;
+  E.file_rows = 0;
+  E.modified_rows = 0;
+  E.file_hash = 0;
+  E.file_stamp = (file_stamp_t){ 0 };
+  E.file_refused = (file_stamp_t){ 0 };
+  E.syntax = NULL;
+  E.mode = MODE_NORMAL;
+
+  E.pending_key = 0;
+
+  E.cmdlen = 0;
+  E.cmdbuf[0] = '\0';
+
+  E.select_cx = -1;
+  E.select_cy = -1;
+
+  editor_set_status_message("Welcome to Zilo.");
+}
+
+/**
+ * @brief Free editor memory resources.
+ */
+void free_editor(void) {
+  // Buffers parked behind the one in E (`:e`, split windows)
+  editor_buffers_free();
+
+  zilo_free(MEM_FILE, E.filename);
+
+  editor_rows_clear();
+  E.generation ++;
+  editor_snapshot_forget();
+
+  editor_wrap_free(&E.wrap_index);
+}
+
+/**
+ * @brief The cleanup function before program exit.
+ *
+ * This function is registered with 'atexit()' and does not need to be called manually.
+ */
+void editor_cleanup(void) {
+  // Restore the cursor shape to a block
+  set_cursor_shape_block();
+
+  // Restore terminal properties
+  disable_raw_mode();
+
+  // Stop the workers before the state they report to goes away
+  pool_shutdown();
+  editor_follow_stop();
+  editor_stream_stop();
+  editor_hex_close();
+
+  // Free heap memory
+  free_editor();
+
+  // Clean terminal
+  write(STDOUT_FILENO, ANSI_CLEAR_SCREEN, strlen(ANSI_CLEAR_SCREEN));
+  write(STDOUT_FILENO, ANSI_CURSOR_HOME, strlen(ANSI_CURSOR_HOME));
+
+  // Close the key trace (--record)
+  editor_record_stop();
+
+  // Latency summary
+  editor_stats_report();
+
+  // Per-subsystem memory (after free_editor, so `live` shows leaks)
+  zilo_mem_report();
+
+  // Write the trace file (ZILO_TRACE)
+  zilo_trace_close();
+
+  // Close the log system
+  LOG_INFO("", "Zilo editor exited safely.");
+  zilo_log_close();
+}
@@ -1,65 +1,361 @@
-#include "output.h"
 #define _POSIX_C_SOURCE 200809L
+#define ZILO_LOG_MODULE LOG_MODULE_FILE
 
 #include "file.h"
+#include "cold.h"
+#include "lineidx.h"
+#include "logger.h"
+#include "mem.h"
+#include "output.h"
+#include "page.h"
 #include "row.h"
+#include "syntax.h"
+#include "wrap.h"
 #include "zilo.h"
+#include <errno.h>
 #include <fcntl.h>
-#include "logger.h"
-#include <unistd.h>
-#include <stdio.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FILE_READ_CHUNK (1024 * 1024)
+#define FILE_HASH_SEED  0x2545f4914f6cdd1dULL
+
+
+/**
+ * @brief Append a loaded line, remembering where it sits in the file so that
+ *        a paged-out copy can be read back from there (see cold.h).
+ *
+ * @param origin Offset of the line in the file.
+ * @param crlf   The line ended with "\r\n".
+ *
+ * @return Returns the row, NULL if it could not be appended.
+ */
+static erow_t *editor_load_row(char *s, int len, int64_t origin, bool crlf) {
+  int numrows = E.numrows;
+  editor_append_row(s, len);
+  if (E.numrows == numrows) return NULL;
+
+  erow_t *row = editor_row_at(numrows);
+  if (row) editor_row_set_origin(row, origin, crlf);
+  return row;
+}
+
+/**
+ * @brief Append `len` bytes that follow the end of the buffer as rows.
+ *
+ * The last row stays open while no newline ended it, so a line that comes
+ * in several pieces ends up as one row.
+ *
+ * @param origin Offset of `buf` in the file (follow mode), -1 if the bytes
+ *               are not in a file (stdin): the rows are then modified.
+ */
+void editor_append_text(const char *buf, int len, int64_t origin) {
+  int at = 0;
+  while (at < len) {
+    const char *nl = memchr(buf + at, '\n', len - at);
+    int end = nl ? nl - buf : len;
+
+    int line_len = end - at;
+    bool crlf = nl && line_len > 0 && buf[end - 1] == '\r';
+    if (crlf) line_len --;
+
+    erow_t *row;
+    int64_t start = origin + at;
+    bool in_file = origin >= 0;
+    if (!E.file_eol && E.numrows > 0) {
+      row = editor_row_at(E.numrows - 1);
+      if (!row) return;
+      start = row->origin;
+      in_file = in_file && editor_row_in_file(row);
+      editor_row_append_string(row, (char *)buf + at, line_len);
+    } else {
+      int numrows = E.numrows;
+      editor_append_row((char *)buf + at, line_len);
+      if (E.numrows == numrows) return;
+      row = editor_row_at(numrows);
+      if (in_file) E.file_rows ++;
+    }
+    // The bytes on disk are still the line: the row is not modified
+    if (in_file) editor_row_set_origin(row, start, crlf);
 
+    E.file_eol = nl != NULL;
+    at = end + (nl ? 1 : 0);
+  }
+}
 
 /**
- * @brief Concatenate the contents of all row objects into a single large string (used for save).
+ * @brief Read the rows of `fd`, from its current offset (E.file_bytes) on,
+ *        into E.
  *
- * @return String pointer.
+ * Lines are cut with memchr in FILE_READ_CHUNK blocks; only a line that
+ * spans two blocks is carried over.
+ *
+ * @param fd  Open file.
+ * @param idx Line index fed with every line ended by '\n' (may be NULL).
  */
-static void all_row_to_string(char **s, size_t *len) {
-  // Calculate the total bytes
-  size_t bytes = 0;
-  for (int i = 0; i < E.numrows; ++ i) {
-    bytes += E.row[i].size + 1; // An additional 1 byte is required to store '\n'
+static void editor_load_rows(int fd, line_index_t *idx) {
+  size_t cap = FILE_READ_CHUNK;
+  char *buf = zilo_malloc(MEM_FILE, cap);
+  if (!buf) {
+    LOG_ERROR("malloc", "Failed to allocate memory.");
+    return;
   }
 
-  // Allocate memory space
-  char *buf = malloc(sizeof(char) * bytes);
-  if (!buf) LOG_ERROR("malloc", "Failed to allocate memory.");
-  
-  // Concatenate all rows
-  size_t p = 0;
-  for (int i = 0; i < E.numrows; ++ i) {
-    erow_t *row = &E.row[i];
-    // Copy
-    memcpy(buf + p, row->chars, row->size);
-    p += row->size;
+  size_t have = 0;  // Bytes of an unfinished line at the start of `buf`
+  ssize_t n;
+  while ((n = read(fd, buf + have, cap - have)) > 0) {
+    int64_t base = E.file_bytes - have;   // File offset of `buf`
+    E.file_bytes += n;
+    have += n;
+
+    char *p = buf;
+    char *end = buf + have;
+    char *nl;
+    while ((nl = memchr(p, '\n', end - p))) {
+      int len = nl - p;
+      bool crlf = len > 0 && p[len - 1] == '\r';
+      erow_t *row = editor_load_row(p, len - crlf, base + (p - buf), crlf);
+      if (idx) line_index_add(idx, base + (p - buf), len - crlf, crlf, row ? row->hash : editor_hash_line(p, len - crlf));
+      p = nl + 1;
+    }
+
+    have = end - p;
+    memmove(buf, p, have);
+
+    // Keep row memory within the budget while a large file comes in
+    editor_cold_sweep();
 
-    buf[p ++] = '\n';
+    // A line longer than the buffer
+    if (have == cap) {
+      char *new = zilo_realloc(MEM_FILE, buf, cap * 2);
+      if (!new) {
+        LOG_ERROR("realloc", "Failed to expand memory.");
+        break;
+      }
+      buf = new;
+      cap *= 2;
+    }
   }
+  if (n == -1) LOG_ERROR("read", "Failed to read the file <%s>.", E.filename);
+
+  // The last line has no newline (never paged: the line break is missing)
+  E.file_eol = have == 0;
+  if (have > 0) editor_load_row(buf, have, E.file_bytes - have, false);
+
+  zilo_free(MEM_FILE, buf);
+}
+
+/**
+ * @brief Make the runs of a line index the first rows of E, as pages left in
+ *        the attached file, and move `fd` to the end of the last one.
+ *
+ * @return Returns 0 on success, -1 on failure (E is left empty).
+ */
+static int editor_load_index(const line_index_t *idx, int fd) {
+  for (int64_t k = 0; k < idx->count; ++ k) {
+    const line_run_t *r = &idx->runs[k];
+    if (editor_rows_append_file(LINE_INDEX_STRIDE, r->pos, r->len, r->len - r->crlf, r->text, r->eol) == -1) {
+      editor_rows_clear();
+      return -1;
+    }
+  }
+
+  int64_t end = line_index_end(idx);
+  if (lseek(fd, end, SEEK_SET) == -1) {
+    LOG_ERROR("lseek", "Failed to seek past the indexed lines of <%s>.", E.filename);
+    editor_rows_clear();
+    lseek(fd, 0, SEEK_SET);
+    return -1;
+  }
+  E.file_bytes = end;
+
+  // The rows were not measured
+  editor_wrap_invalidate();
+  LOG_DEBUG("editor_load_index", "Left %lld indexed lines of <%s> in the file.",
+            (long long)idx->count * LINE_INDEX_STRIDE, E.filename);
+  return 0;
+}
+
+/**
+ * @brief Mix one more value into `h` (order matters).
+ */
+static uint64_t file_hash_fold(uint64_t h, uint64_t v, bool flag) {
+  h = (h ^ v ^ (flag ? 0xd6e8feb86659fd93ULL : 0)) * 0x9e3779b97f4a7c15ULL;
+  return h ^ (h >> 29);
+}
+
+// Hash of the lines of a file so far, in the form pages keep (see page.h)
+typedef struct {
+  lhash_t text;
+  uint64_t eol;
+} file_hash_t;
+
+static uint64_t file_hash_finish(const file_hash_t *fh, int64_t lines, bool eol) {
+  uint64_t h = file_hash_fold(FILE_HASH_SEED, fh->text.hash, false);
+  h = file_hash_fold(h, fh->eol, false);
+  return file_hash_fold(h, lines, eol);
+}
+
+/**
+ * @brief Hash of the file the rows are the lines of (right after a load or
+ *        a save, it is the file on disk). Pages that are out are not read
+ *        back: their hash is kept.
+ */
+static uint64_t file_hash_rows(void) {
+  file_hash_t fh;
+  editor_rows_hash(&fh.text, &fh.eol);
+  return file_hash_finish(&fh, E.numrows, E.file_eol);
+}
+
+// Called for every line by file_hash_lines()
+typedef void (*file_line_fn)(void *arg, uint64_t hash, bool crlf);
+
+static void file_hash_add(void *arg, uint64_t hash, bool crlf) {
+  file_hash_t *fh = arg;
+  page_hash_add(&fh->text, &fh->eol, hash, crlf);
+}
+
+// Line hashes of a file, in order
+typedef struct {
+  uint64_t *hash;
+  int64_t n;
+  int64_t cap;
+} file_lines_t;
+
+static void file_lines_add(void *arg, uint64_t hash, bool crlf) {
+  (void)crlf;
+  file_lines_t *lines = arg;
+  if (lines->n == lines->cap) {
+    int64_t cap = lines->cap ? lines->cap * 2 : 1024;
+    uint64_t *new = zilo_realloc(MEM_FILE, lines->hash, sizeof(uint64_t) * cap);
+    if (!new) return;   // Short: the caller compares the count
+    lines->hash = new;
+    lines->cap = cap;
+  }
+  lines->hash[lines->n ++] = hash;
+}
+
+/**
+ * @brief Hash every line of `fd`, cut as editor_load_rows() cuts them.
+ *
+ * @param fn  Called with the hash of every line (see editor_hash_line()).
+ * @param eol Set to true if the last line ends with a newline.
+ *
+ * @return Returns the number of lines, -1 on failure.
+ */
+static int64_t file_hash_lines(int fd, file_line_fn fn, void *arg, bool *eol) {
+  size_t cap = FILE_READ_CHUNK;
+  char *buf = zilo_malloc(MEM_FILE, cap);
+  if (!buf) {
+    LOG_ERROR("malloc", "Failed to allocate memory.");
+    return -1;
+  }
+
+  int64_t lines = 0;
+  size_t have = 0;
+  ssize_t n;
+  while ((n = read(fd, buf + have, cap - have)) > 0) {
+    have += n;
+
+    char *p = buf;
+    char *end = buf + have;
+    char *nl;
+    while ((nl = memchr(p, '\n', end - p))) {
+      int len = nl - p;
+      bool crlf = len > 0 && p[len - 1] == '\r';
+      fn(arg, editor_hash_line(p, len - crlf), crlf);
+      lines ++;
+      p = nl + 1;
+    }
+
+    have = end - p;
+    memmove(buf, p, have);
+
+    if (have == cap) {
+      char *new = zilo_realloc(MEM_FILE, buf, cap * 2);
+      if (!new) {
+        n = -1;
+        break;
+      }
+      buf = new;
+      cap *= 2;
+    }
+  }
+
+  if (n == 0) {
+    *eol = have == 0;
+    if (have > 0) {
+      fn(arg, editor_hash_line(buf, have), false);
+      lines ++;
+    }
+  }
+  zilo_free(MEM_FILE, buf);
+  return n == 0 ? lines : -1;
+}
+
+static int64_t file_mtime_ns(const struct stat *st) {
+  return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+}
+
+static file_stamp_t file_stamp_of(const struct stat *st) {
+  return (file_stamp_t){
+    .dev = st->st_dev,
+    .ino = st->st_ino,
+    .size = st->st_size,
+    .mtime_ns = file_mtime_ns(st),
+  };
+}
+
+/**
+ * @brief Remember which file, of which size and mtime, the rows describe.
+ */
+static void file_stamp_set(const struct stat *st) {
+  E.file_stamp = file_stamp_of(st);
+}
+
+static bool file_stamp_is(const file_stamp_t *stamp, const struct stat *st) {
+  return stamp->dev == (uint64_t)st->st_dev && stamp->ino == (uint64_t)st->st_ino &&
+         stamp->size == st->st_size && stamp->mtime_ns == file_mtime_ns(st);
+}
 
-  *s = buf;
-  *len = p;
+static bool file_stamp_equal(const struct stat *st) {
+  return file_stamp_is(&E.file_stamp, st);
+}
+
+/**
+ * @brief True once the rows were loaded from (or saved to) the file named E.filename.
+ */
+static bool file_stamp_known(void) {
+  return E.file_stamp.dev != 0 || E.file_stamp.ino != 0;
 }
 
 /**
- * @brief Open the file, read its contents, and fill E.row.
+ * @brief Open the file, read its contents, and fill E.
  *
  * @param filename File name/path.
  */
 void editor_open(char *filename) {
   // Regardless of wether the file exists, 
   // first save the filename to the global configuration.
-  free(E.filename);  // In C, free(NULL) is safe
-  E.filename = strdup(filename);
+  zilo_free(MEM_FILE, E.filename);  // In C, free(NULL) is safe
+  E.filename = zilo_strdup(MEM_FILE, filename);
+  editor_select_syntax();
+
+  E.file_bytes = 0;
+  E.file_eol = true;
+  E.file_rows = E.numrows;
+  E.file_hash = 0;
+  E.file_stamp = (file_stamp_t){ 0 };
+  E.file_refused = (file_stamp_t){ 0 };
 
   // Try to open the file.
-  FILE *fp = fopen(filename, "r");
+  int fd = open(filename, O_RDONLY);
   
-  if (!fp) {
+  if (fd == -1) {
     // The file does not exist, which means we need to create a new file
     if (errno == ENOENT) {
       return;
@@ -67,56 +363,352 @@ void editor_open(char *filename) {
     // Other error represent failure
     else {
       LOG_ERROR("open", "Failed to open the file <%s>.", E.filename);
+      return;
     }
   }
 
+  // A large file has a line index (see lineidx.c): when it still applies,
+  // its runs become pages left in the file and only what follows is read
+  struct stat st;
+  bool known = fstat(fd, &st) == 0;
+  bool indexed = known && S_ISREG(st.st_mode) && st.st_size >= LINE_INDEX_MIN_BYTES && E.numrows == 0;
+  line_index_t idx;
+  line_index_init(&idx);
+  line_index_state_e state = indexed ? line_index_load(&idx, filename, &st) : LINE_INDEX_MISS;
+
+  // Clean pages of the buffer are read back from this file
+  if ((editor_page_enabled() || state != LINE_INDEX_MISS) && editor_page_attach(fd) == -1) {
+    LOG_WARN("editor_page_attach", "Rows of <%s> will be paged to the temp file only.", E.filename);
+    state = LINE_INDEX_MISS;
+  }
+  if (state != LINE_INDEX_MISS && editor_load_index(&idx, fd) == -1) state = LINE_INDEX_MISS;
+  if (state == LINE_INDEX_MISS) line_index_free(&idx);
 
   // If the file exists, read the lines normally
   // Newline characters are not stored; 
   // line breaks are handled by 'draw_rows()'
-  char *line = NULL;
-  size_t size = 0;
-  while (getline(&line, &size, fp) != -1) {
-    int len = strlen(line);
-    if (len > 0 && line[len - 1] == '\n') {
-      len --;
-      if (len > 0 && line[len - 1] == '\r') len --;
-      line[len] = '\0';
-    }
+  editor_load_rows(fd, indexed ? &idx : NULL);
 
-    editor_append_row(line, len);
+  // The index now reaches the last run of the file as read
+  if (indexed && state != LINE_INDEX_EXACT) line_index_save(&idx, filename, &st, E.file_bytes);
+  line_index_free(&idx);
+
+  // What the rows are, for telling later whether they or the file changed
+  // (a file that grew meanwhile has a stamp that tells it)
+  E.file_rows = E.numrows;
+  E.file_hash = file_hash_rows();
+  if (known && fstat(fd, &st) == 0) {
+    file_stamp_set(&st);
+    E.file_stamp.size = E.file_bytes;
   }
 
   // Clean resources
-  free(line);
-  fclose(fp);
+  close(fd);
 }
 
 
+/**
+ * @brief True if the row is already in the file at offset `at`, followed by
+ *        '\n' (an incremental save leaves those bytes alone).
+ *
+ * @param size Size of the file before the save.
+ */
+static bool editor_row_in_place(const erow_t *row, int64_t at, int64_t size) {
+  return editor_row_in_file(row) && row->origin == at && !row->origin_crlf &&
+         at + row->size + 1 <= size;
+}
+
+/**
+ * @brief Write the rows to `fd`, through a FILE_READ_CHUNK buffer.
+ *
+ * Compressed and paged-out rows are read back one block or page at a time,
+ * so the buffer never has to fit in memory at once. With `size` >= 0 the
+ * file is the one the rows were loaded from, unchanged: rows whose hash
+ * says they are still the line at their offset are skipped, and so are the
+ * pages left in the file (see editor_rows_keep()), without reading them.
+ *
+ * @param size Size of the file before the save, -1 to write every row.
+ *
+ * @return Returns the number of bytes written, -1 on failure.
+ */
+static int64_t editor_write_rows(int fd, int64_t size) {
+  char *buf = zilo_malloc(MEM_FILE, FILE_READ_CHUNK);
+  if (!buf) {
+    LOG_ERROR("malloc", "Failed to allocate memory.");
+    return -1;
+  }
+
+  int ret = 0;
+  size_t used = 0;
+  int64_t buf_at = 0;   // File offset of `buf`
+  int64_t at = 0;       // File offset of the row
+  int64_t written = 0;
+  for (int i = 0; i < E.numrows && ret == 0; ++ i) {
+    int kept;
+    int64_t kept_len = size >= 0 ? editor_rows_kept(i, &kept) : 0;
+    if (kept_len > 0) {
+      if (used > 0 && pwrite(fd, buf, used, buf_at) != (ssize_t)used) ret = -1;
+      written += used;
+      used = 0;
+      at += kept_len;
+      buf_at = at;
+      i += kept - 1;
+      continue;
+    }
+
+    erow_t *row = editor_row_scan(i);
+    if (!row) {
+      ret = -1;
+      break;
+    }
+    if (size >= 0 && editor_row_in_place(row, at, size)) {
+      if (used > 0 && pwrite(fd, buf, used, buf_at) != (ssize_t)used) ret = -1;
+      written += used;
+      used = 0;
+      at += row->size + 1;
+      buf_at = at;
+      continue;
+    }
+
+    // A long row goes through the buffer in pieces; the '\n' is one more byte
+    for (int off = 0; off <= row->size && ret == 0; ) {
+      if (used == FILE_READ_CHUNK) {
+        if (pwrite(fd, buf, used, buf_at) != (ssize_t)used) ret = -1;
+        written += used;
+        buf_at += used;
+        used = 0;
+      }
+      if (off == row->size) {
+        buf[used ++] = '\n';
+        break;
+      }
+      int n = MIN(row->size - off, (int)(FILE_READ_CHUNK - used));
+      if (editor_row_read(row, off, n, buf + used) == -1) ret = -1;
+      used += n;
+      off += n;
+    }
+    at += row->size + 1;
+  }
+  if (ret == 0 && used > 0 && pwrite(fd, buf, used, buf_at) != (ssize_t)used) ret = -1;
+  written += used;
+
+  zilo_free(MEM_FILE, buf);
+  return ret == 0 ? written : -1;
+}
+
 /**
  * @brief Save the edited content.
+ *
+ * A file that changed on disk since it was read (by content: a file only
+ * touched is fine) is not overwritten unless the buffer is saved again
+ * while the file stays as it was when refused. When the file is still what
+ * was read, only the rows that moved or changed are written.
+ *
+ * @return Returns 0 on success, -1 if the file was not saved.
  */
-void editor_save(void) {
-  char *buf;
-  size_t len;
+int editor_save(void) {
+  // Text read from stdin has no name until one is given
+  if (!E.filename) {
+    editor_set_status_message("No file name: use :w <file>");
+    return -1;
+  }
 
-  all_row_to_string(&buf, &len);
+  // Saving again over the file a save was refused for overwrites the
+  // changes made on disk (a file that changed once more is checked again)
+  struct stat disk;
+  bool exists = stat(E.filename, &disk) == 0;
+  bool overwrite = exists && file_stamp_is(&E.file_refused, &disk);
+  if (exists && !overwrite && editor_file_changed()) {
+    E.file_refused = file_stamp_of(&disk);
+    editor_set_status_message("<%s> changed on disk since it was read: save again to overwrite", E.filename);
+    return -1;
+  }
+  E.file_refused = (file_stamp_t){ 0 };
+  bool incremental = !overwrite && exists && file_stamp_known();
+
+  // Rows still paged from the file (by any buffer) must be moved out before
+  // it is rewritten, except the pages of this buffer the save leaves alone
+  editor_rows_keep(incremental ? E.file_stamp.size : -1);
+  if (editor_page_detach_path(E.filename) == -1) {
+    editor_rows_saved(false);
+    editor_set_status_message("Cannot move paged rows out of <%s>; not saved.", E.filename);
+    return -1;
+  }
+
+  // An additional 1 byte per row is required to store '\n'
+  off_t len = editor_rows_bytes();
 
   // Do not truncate when opening; preserve the original content
   int fd = open(E.filename,
-                O_WRONLY | O_CREAT, 
+                O_RDWR | O_CREAT, 
                 0644);
-  if (fd == -1) LOG_ERROR("open", "Failed to open the file <%s>.", E.filename);
+  if (fd == -1) {
+    LOG_ERROR("open", "Failed to open the file <%s>.", E.filename);
+    editor_rows_saved(false);
+    editor_set_status_message("Cannot open <%s> for writing.", E.filename);
+    return -1;
+  }
+
+  // Use 'ftruncate()' to truncate, then write to disk
+  int64_t written = -1;
+  if (ftruncate(fd, len) == 0) written = editor_write_rows(fd, incremental ? E.file_stamp.size : -1);
+  if (written == -1) {
+    LOG_ERROR("write", "Failed to write data to file <%s>.", E.filename);
+    editor_rows_saved(false);
+    editor_set_status_message("Failed to write <%s>.", E.filename);
+    close(fd);
+    return -1;
+  }
 
-  // Use 'ftruncate()' to truncate
-  ftruncate(fd, len);
+  // An edit can leave the file looking appended to: its index is rebuilt
+  line_index_drop(E.filename);
 
-  // Write to disk
-  if (write(fd, buf, len) == -1) LOG_ERROR("write", "Failed to write data to file <%s>.", E.filename);
+  // Every row is now a line of the file as written: page from it again
+  // (pages that are out too, so it is attached while any page reads from
+  // the previous file)
+  if (editor_page_enabled() || editor_page_file()) editor_page_attach(fd);
+  editor_rows_saved(true);
+  E.file_bytes = len;
+  E.file_eol = true;
+  E.file_rows = E.numrows;
+  E.file_hash = file_hash_rows();
+  struct stat st;
+  if (fstat(fd, &st) == 0) file_stamp_set(&st);
 
   // Set a message 
-  editor_set_status_message("The file <%s> has been saved to disk.", E.filename);
+  if (written < len) {
+    editor_set_status_message("The file <%s> has been saved to disk (%lld of %lld bytes written).",
+                              E.filename, (long long)written, (long long)len);
+  } else {
+    editor_set_status_message("The file <%s> has been saved to disk.", E.filename);
+  }
 
-  free(buf);
   close(fd);
+  return 0;
+}
+
+/**
+ * @brief Describe the file as it is now that the rows were extended with
+ *        what it gained (follow mode, see editor_append_text()).
+ *
+ * The hash of the file is only known while the rows are its lines; after
+ * an edit a touch of the file reads as a change.
+ *
+ * @param fd The file.
+ */
+void editor_file_grown(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) == -1) return;
+
+  file_stamp_set(&st);
+  E.file_stamp.size = E.file_bytes;
+  E.file_hash = editor_file_modified() ? 0 : file_hash_rows();
+}
+
+/**
+ * @brief Read E.filename again in place of the rows (edits not saved are
+ *        lost). The cursor stays on its line when there still is one.
+ *
+ * @return Returns 0 on success, -1 on failure (the rows are unchanged).
+ */
+int editor_file_reload(void) {
+  if (!E.filename) return -1;
+
+  // editor_open() replaces E.filename
+  char *filename = zilo_strdup(MEM_FILE, E.filename);
+  if (!filename) return -1;
+
+  editor_rows_clear();
+  E.generation ++;
+
+  editor_open(filename);
+  zilo_free(MEM_FILE, filename);
+
+  if (E.cy >= E.numrows) E.cy = E.numrows > 0 ? E.numrows - 1 : 0;
+  if (E.rowoff > E.cy) E.rowoff = E.cy;
+  E.cx = 0;
+  E.lineoff = 0;
+  editor_wrap_invalidate();
+  return 0;
+}
+
+/**
+ * @brief True if the rows differ from the file as last loaded or saved.
+ *
+ * Rows count as modified by hash (see editor_row_in_file()), so a row
+ * edited back to its line is not; no bytes are compared.
+ */
+bool editor_file_modified(void) {
+  return E.modified_rows > 0 || E.numrows != E.file_rows;
+}
+
+/**
+ * @brief True if the file on disk is no longer what was last loaded or
+ *        saved (gone, or another content).
+ *
+ * A file whose size and mtime did not move is taken as unchanged. One that
+ * did is read again and hashed line by line; if the hash is that of the
+ * lines loaded, it was only touched and the new mtime is recorded.
+ */
+bool editor_file_changed(void) {
+  if (!E.filename || !file_stamp_known()) return false;
+
+  int fd = open(E.filename, O_RDONLY);
+  if (fd == -1) return true;
+
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    close(fd);
+    return true;
+  }
+  if (file_stamp_equal(&st)) {
+    close(fd);
+    return false;
+  }
+
+  file_hash_t fh = { { 0, 1 }, 0 };
+  bool eol;
+  int64_t lines = file_hash_lines(fd, file_hash_add, &fh, &eol);
+  close(fd);
+
+  bool same = lines >= 0 && file_hash_finish(&fh, lines, eol) == E.file_hash;
+  if (same) file_stamp_set(&st);
+  return !same;
+}
+
+/**
+ * @brief Compare the rows with the lines of the file on disk, by hash.
+ *
+ * The lines both have in common at the start and at the end are skipped:
+ * what is left is rows [*from, *to) against lines [*from, *disk_to).
+ *
+ * @return Returns 1 if they differ, 0 if not, -1 if the file cannot be read.
+ */
+int editor_file_diff(int *from, int *to, int *disk_to) {
+  if (!E.filename) return -1;
+  int fd = open(E.filename, O_RDONLY);
+  if (fd == -1) return -1;
+
+  file_lines_t lines = { 0 };
+  bool eol;
+  int64_t n = file_hash_lines(fd, file_lines_add, &lines, &eol);
+  close(fd);
+  if (n < 0 || lines.n != n) {
+    zilo_free(MEM_FILE, lines.hash);
+    return -1;
+  }
+
+  // Pages are read back as the walks go (a page that cannot be ends them)
+  int p = 0;
+  erow_t *row;
+  while (p < E.numrows && p < n && (row = editor_row_scan(p)) && row->hash == lines.hash[p]) p ++;
+  int s = 0;
+  while (s < E.numrows - p && s < n - p && (row = editor_row_scan(E.numrows - 1 - s)) &&
+         row->hash == lines.hash[n - 1 - s]) s ++;
+  zilo_free(MEM_FILE, lines.hash);
+
+  *from = p;
+  *to = E.numrows - s;
+  *disk_to = n - s;
+  return p == E.numrows && p == n ? 0 : 1;
 }
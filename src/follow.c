@@ -0,0 +1,229 @@
+#define _POSIX_C_SOURCE 200809L
+#define ZILO_LOG_MODULE LOG_MODULE_FILE
+
+#include "follow.h"
+#include "file.h"
+#include "logger.h"
+#include "mem.h"
+#include "output.h"
+#include "row.h"
+#include "zilo.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Follow mode (`tail -f`). The file is watched with inotify and every byte
+ * past E.file_bytes is read and appended as rows. The parent directory is
+ * watched too, so a log rotated by rename or delete + create is picked up
+ * when the new file appears.
+ *
+ * A file whose inode changed or that got shorter than what was read is
+ * reloaded from scratch, unless the buffer has edits that are not saved:
+ * following then holds until they are saved (or the buffer is reloaded).
+ */
+
+#define FOLLOW_READ_SIZE 65536
+
+typedef struct {
+  bool active;
+  int inotify_fd;
+  int file_wd;        // Watch on the file (-1 while it is missing)
+  int dir_wd;         // Watch on its directory
+  char name[NAME_MAX + 1];   // Base name, to filter directory events
+  dev_t dev;          // Identity of the file being read
+  ino_t ino;
+  bool held;          // Replaced under unsaved edits: nothing is read until they are saved
+} follow_t;
+
+static follow_t F = { .inotify_fd = -1, .file_wd = -1, .dir_wd = -1 };
+
+/**
+ * @brief Watch the file itself and remember which file that is.
+ *
+ * @return Returns 0 on success, -1 if the file cannot be watched (yet).
+ */
+static int follow_watch_file(void) {
+  struct stat st;
+  if (stat(E.filename, &st) == -1) return -1;
+
+  if (F.file_wd != -1) inotify_rm_watch(F.inotify_fd, F.file_wd);
+  F.file_wd = inotify_add_watch(F.inotify_fd, E.filename,
+                                IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+  if (F.file_wd == -1) return -1;
+
+  F.dev = st.st_dev;
+  F.ino = st.st_ino;
+  return 0;
+}
+
+/**
+ * @brief Reload the whole file (rotated or truncated).
+ */
+static void follow_reload(void) {
+  if (editor_file_modified()) {
+    F.held = true;
+    LOG_WARN("follow_reload", "<%s> was replaced under unsaved edits: not reloaded.", E.filename);
+    editor_set_status_message("<%s> was truncated or replaced: not reloaded over unsaved edits", E.filename);
+    return;
+  }
+
+  bool at_end = E.cy >= E.numrows - 1;
+
+  if (editor_file_reload() == -1) return;
+
+  if (at_end) E.cy = E.numrows > 0 ? E.numrows - 1 : 0;
+  if (follow_watch_file() == -1) F.file_wd = -1;
+
+  LOG_INFO("follow_reload", "Reloaded <%s> (%d lines).", E.filename, E.numrows);
+  editor_set_status_message("<%s> was truncated or replaced: reloaded", E.filename);
+}
+
+/**
+ * @brief Read everything past E.file_bytes.
+ *
+ * @return Returns the number of bytes read.
+ */
+static int64_t follow_read_new(void) {
+  int fd = open(E.filename, O_RDONLY);
+  if (fd == -1) return 0;
+
+  bool at_end = E.numrows == 0 || E.cy >= E.numrows - 1;
+
+  char buf[FOLLOW_READ_SIZE];
+  int64_t total = 0;
+  ssize_t n;
+  while ((n = pread(fd, buf, sizeof(buf), E.file_bytes)) > 0) {
+    editor_append_text(buf, n, E.file_bytes);
+    E.file_bytes += n;
+    total += n;
+  }
+  if (total > 0) editor_file_grown(fd);
+  close(fd);
+
+  // Keep the newest line in view if the cursor was on the last one
+  if (total > 0 && at_end && E.numrows > 0) {
+    E.cy = E.numrows - 1;
+    E.cx = 0;
+  }
+  return total;
+}
+
+/*------------------------------------------
+              PUBLIC INTERFACE
+ ------------------------------------------*/
+/**
+ * @brief Start following E.filename.
+ *
+ * @return Returns 0 on success, -1 on failure.
+ */
+int editor_follow_start(void) {
+  if (F.active) return 0;
+  if (!E.filename) return -1;
+
+  F.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (F.inotify_fd == -1) {
+    LOG_ERROR("inotify_init1", "Failed to start inotify: %s.", strerror(errno));
+    return -1;
+  }
+
+  // Directory watch: catches the file being created again after a rotation
+  char dir[PATH_MAX];
+  const char *slash = strrchr(E.filename, '/');
+  if (slash) {
+    int dir_len = slash == E.filename ? 1 : slash - E.filename;
+    snprintf(dir, sizeof(dir), "%.*s", dir_len, E.filename);
+  } else {
+    strcpy(dir, ".");
+  }
+  snprintf(F.name, sizeof(F.name), "%s", slash ? slash + 1 : E.filename);
+
+  F.dir_wd = inotify_add_watch(F.inotify_fd, dir, IN_CREATE | IN_MOVED_TO);
+  if (F.dir_wd == -1) {
+    LOG_ERROR("inotify_add_watch", "Failed to watch <%s>: %s.", dir, strerror(errno));
+    close(F.inotify_fd);
+    F.inotify_fd = -1;
+    return -1;
+  }
+  follow_watch_file();   // The file may not exist yet
+
+  F.active = true;
+  LOG_INFO("editor_follow_start", "Following <%s>.", E.filename);
+
+  // Bytes written since the file was loaded
+  editor_follow_poll();
+  return 0;
+}
+
+/**
+ * @brief Stop following.
+ */
+void editor_follow_stop(void) {
+  if (!F.active) return;
+
+  close(F.inotify_fd);
+  F = (follow_t){ .inotify_fd = -1, .file_wd = -1, .dir_wd = -1 };
+}
+
+/**
+ * @brief True while follow mode is on.
+ */
+bool editor_follow_active(void) {
+  return F.active;
+}
+
+/**
+ * @brief The inotify descriptor to poll (-1 when not following).
+ */
+int editor_follow_fd(void) {
+  return F.inotify_fd;
+}
+
+/**
+ * @brief Consume inotify events and bring the rows up to date.
+ *
+ * @return Returns true if the rows changed.
+ */
+bool editor_follow_poll(void) {
+  if (!F.active) return false;
+
+  // The events only say "look again": drain them and check the file
+  char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  bool replaced = false;
+  ssize_t n;
+  while ((n = read(F.inotify_fd, events, sizeof(events))) > 0) {
+    for (char *p = events; p < events + n; ) {
+      struct inotify_event *ev = (struct inotify_event *)p;
+      if (ev->wd == F.file_wd && (ev->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED))) {
+        F.file_wd = -1;   // Wait for the new file in the directory
+      }
+      if (ev->wd == F.dir_wd && ev->len && !strcmp(ev->name, F.name)) replaced = true;
+      p += sizeof(struct inotify_event) + ev->len;
+    }
+  }
+
+  // Saved since (the file is the rows again): follow the file as written
+  if (F.held) {
+    if (editor_file_modified()) return false;
+    F.held = false;
+    if (follow_watch_file() == -1) F.file_wd = -1;
+    replaced = false;
+  }
+
+  struct stat st;
+  if (stat(E.filename, &st) == -1) return false;   // Rotated away, not back yet
+
+  if (replaced || st.st_dev != F.dev || st.st_ino != F.ino || st.st_size < E.file_bytes) {
+    follow_reload();
+    return true;
+  }
+
+  if (F.file_wd == -1) follow_watch_file();
+  return st.st_size > E.file_bytes && follow_read_new() > 0;
+}
@@ -0,0 +1,331 @@
+#define _POSIX_C_SOURCE 200809L
+#define ZILO_LOG_MODULE LOG_MODULE_FILE
+
+#include "hex.h"
+#include "cold.h"
+#include "command.h"
+#include "input.h"
+#include "logger.h"
+#include "mem.h"
+#include "ops.h"
+#include "output.h"
+#include "zilo.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Hex view (`zilo --hex`, `:hex`). The file is mapped privately and drawn
+ * sixteen bytes a line straight from the mapping: nothing is read or split
+ * into rows, so a line is found from its offset in O(1) and a file of any
+ * size opens at once.
+ *
+ * r/R overwrite bytes in the mapping (a hex digit at a time, or a character
+ * in the ASCII pane). The pages written to are remembered and only those
+ * are written back by Ctrl-S; until then the file is untouched.
+ */
+
+static hex_view_t H = { .fd = -1 };
+static bool g_active = false;
+static bool g_standalone = false;    // Opened from the command line: no rows behind it
+static bool g_quit_warned = false;   // 'q' was pressed once with unsaved bytes
+
+/**
+ * @brief Value of a hex digit, -1 if `c` is not one.
+ */
+static int hex_digit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+/**
+ * @brief Position of `page` in the sorted set of dirty pages (where it is,
+ *        or where it would go).
+ */
+static int hex_dirty_find(uint64_t page) {
+  int lo = 0, hi = H.ndirty;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (H.dirty[mid] < page) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+/**
+ * @brief Overwrite the byte at `off` and remember its page.
+ */
+static void hex_put(int64_t off, unsigned char byte) {
+  if (H.data[off] == byte) return;
+
+  uint64_t page = off / sysconf(_SC_PAGESIZE);
+  int at = hex_dirty_find(page);
+  if (at == H.ndirty || H.dirty[at] != page) {
+    if (H.ndirty == H.dirtycap) {
+      int cap = H.dirtycap ? H.dirtycap * 2 : 16;
+      uint64_t *dirty = zilo_realloc(MEM_FILE, H.dirty, sizeof(uint64_t) * cap);
+      if (!dirty) {
+        editor_set_status_message("Out of memory: byte not changed");
+        return;
+      }
+      H.dirty = dirty;
+      H.dirtycap = cap;
+    }
+    memmove(H.dirty + at + 1, H.dirty + at, sizeof(uint64_t) * (H.ndirty - at));
+    H.dirty[at] = page;
+    H.ndirty ++;
+  }
+
+  H.data[off] = byte;
+  g_quit_warned = false;
+}
+
+/**
+ * @brief Move the cursor by `delta` bytes, staying inside the file.
+ */
+static void hex_move(int64_t delta) {
+  editor_hex_goto(H.off + delta);
+}
+
+/**
+ * @brief q: leave the view, or the editor if it was started with --hex.
+ */
+static void hex_quit(void) {
+  if (H.ndirty > 0 && !g_quit_warned) {
+    g_quit_warned = true;
+    editor_set_status_message("Unsaved bytes: Ctrl-S writes them, q again drops them");
+    return;
+  }
+
+  if (g_standalone) {
+    editor_op_exit();
+    return;
+  }
+  editor_hex_close();
+}
+
+static void hex_key_normal(char c) {
+  if      (c == 'q')            { hex_quit(); }
+  else if (c == ':')            { editor_command_start(); }
+  else if (c == 'h')            { hex_move(-1); }
+  else if (c == 'l')            { hex_move(1); }
+  else if (c == 'k')            { hex_move(-HEX_LINE_BYTES); }
+  else if (c == 'j')            { hex_move(HEX_LINE_BYTES); }
+  else if (c == '0')            { hex_move(-(H.off % HEX_LINE_BYTES)); }
+  else if (c == '$')            { hex_move(HEX_LINE_BYTES - 1 - H.off % HEX_LINE_BYTES); }
+  else if (c == 'g')            { editor_hex_goto(0); }
+  else if (c == 'G')            { editor_hex_goto(H.size - 1); }
+  else if (c == '\t')           { H.pane = H.pane == HEX_PANE_HEX ? HEX_PANE_ASCII : HEX_PANE_HEX; }
+  else if (c == CTRL_KEY('s'))  { editor_hex_save(); }
+  else if (c == 'r' || c == 'R') {
+    if (H.readonly || H.size == 0) {
+      editor_set_status_message(H.size == 0 ? "The file is empty" : "<%s> is read-only", H.filename);
+      return;
+    }
+    E.mode = c == 'r' ? MODE_REPLACE_ONCE : MODE_REPLACE;
+    H.nibble = 0;
+  }
+}
+
+static void hex_key_replace(char c) {
+  // Esc drops a half-typed byte
+  if (c == 27) {
+    E.mode = MODE_NORMAL;
+    H.nibble = 0;
+    return;
+  }
+
+  bool done;   // A whole byte was written
+  if (H.pane == HEX_PANE_ASCII) {
+    hex_put(H.off, (unsigned char)c);
+    done = true;
+  } else {
+    int d = hex_digit(c);
+    if (d == -1) return;
+
+    unsigned char old = H.data[H.off];
+    hex_put(H.off, H.nibble == 0 ? (d << 4) | (old & 0x0f) : (old & 0xf0) | d);
+    done = H.nibble == 1;
+    H.nibble = !H.nibble;
+  }
+  if (!done) return;
+
+  // r writes one byte; R goes on until Esc or the end of the file
+  if (E.mode == MODE_REPLACE_ONCE || H.off == H.size - 1) E.mode = MODE_NORMAL;
+  else hex_move(1);
+}
+
+/*------------------------------------------
+              PUBLIC INTERFACE
+ ------------------------------------------*/
+/**
+ * @brief Show `filename` as bytes.
+ *
+ * @return Returns 0 on success, -1 on failure.
+ */
+int editor_hex_open(const char *filename) {
+  bool readonly = false;
+  int fd = open(filename, O_RDWR);
+  if (fd == -1 && (errno == EACCES || errno == EROFS)) {
+    fd = open(filename, O_RDONLY);
+    readonly = true;
+  }
+  if (fd == -1) {
+    LOG_ERROR("open", "Failed to open the file <%s>: %s.", filename, strerror(errno));
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return -1;
+  }
+
+  // Private: bytes typed stay in memory until editor_hex_save()
+  unsigned char *data = NULL;
+  if (st.st_size > 0) {
+    data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      LOG_ERROR("mmap", "Failed to map the file <%s>: %s.", filename, strerror(errno));
+      close(fd);
+      return -1;
+    }
+  }
+
+  char *name = zilo_strdup(MEM_FILE, filename);
+  if (!name) {
+    if (data) munmap(data, st.st_size);
+    close(fd);
+    return -1;
+  }
+
+  editor_hex_close();
+  H = (hex_view_t){ .filename = name, .fd = fd, .data = data, .size = st.st_size, .readonly = readonly };
+  g_active = true;
+  g_standalone = E.numrows == 0 && !E.filename;
+  g_quit_warned = false;
+  E.mode = MODE_NORMAL;
+
+  LOG_INFO("editor_hex_open", "Hex view of <%s> (%lld bytes).", filename, (long long)st.st_size);
+  return 0;
+}
+
+/**
+ * @brief Leave the hex view (unsaved bytes are dropped).
+ */
+void editor_hex_close(void) {
+  if (!g_active) return;
+
+  if (H.data) munmap(H.data, H.size);
+  close(H.fd);
+  zilo_free(MEM_FILE, H.filename);
+  zilo_free(MEM_FILE, H.dirty);
+  H = (hex_view_t){ .fd = -1 };
+  g_active = false;
+  E.mode = MODE_NORMAL;
+}
+
+/**
+ * @brief The hex view, NULL when the rows are shown.
+ */
+hex_view_t *editor_hex(void) {
+  return g_active ? &H : NULL;
+}
+
+/**
+ * @brief Apply a key while the hex view is shown (the command line is
+ *        handled as usual).
+ *
+ * @param c The key.
+ */
+void editor_hex_key(char c) {
+  if (E.mode == MODE_REPLACE || E.mode == MODE_REPLACE_ONCE) hex_key_replace(c);
+  else hex_key_normal(c);
+}
+
+/**
+ * @brief Move the cursor to byte `off`, clamped to the file.
+ */
+void editor_hex_goto(int64_t off) {
+  if (off >= H.size) off = H.size - 1;
+  if (off < 0) off = 0;
+  H.off = off;
+  H.nibble = 0;
+}
+
+/**
+ * @brief Scroll so that the cursor is on one of `rows` screen lines.
+ */
+void editor_hex_scroll(int rows) {
+  int64_t line = H.off / HEX_LINE_BYTES;
+  if (line < H.top) H.top = line;
+  if (rows > 0 && line >= H.top + rows) H.top = line - rows + 1;
+}
+
+/**
+ * @brief Write the changed pages back to the file.
+ *
+ * @return Returns 0 on success, -1 on failure.
+ */
+int editor_hex_save(void) {
+  if (H.ndirty == 0) {
+    editor_set_status_message("No bytes changed");
+    return 0;
+  }
+
+  // Rows of the same file may be paged from it (see cold.h)
+  if (editor_page_detach_path(H.filename) == -1) {
+    editor_set_status_message("Cannot move paged rows out of <%s>; not saved.", H.filename);
+    return -1;
+  }
+
+  long page_size = sysconf(_SC_PAGESIZE);
+  int pages = 0;
+  for (int i = 0; i < H.ndirty; ++ i) {
+    int64_t at = H.dirty[i] * page_size;
+    size_t len = MIN(page_size, H.size - at);
+    if (pwrite(H.fd, H.data + at, len, at) != (ssize_t)len) {
+      LOG_ERROR("pwrite", "Failed to write <%s>: %s.", H.filename, strerror(errno));
+      editor_set_status_message("Failed to write <%s>.", H.filename);
+      return -1;
+    }
+    pages ++;
+  }
+  H.ndirty = 0;
+  g_quit_warned = false;
+
+  editor_set_status_message("<%s>: %d page(s) written", H.filename, pages);
+  return 0;
+}
+
+/**
+ * @brief Move the hex view out to `out`, so that another daemon session can
+ *        be served with its own (or none).
+ */
+void editor_hex_park(hex_park_t *out) {
+  *out = (hex_park_t){
+    .view = H,
+    .active = g_active,
+    .standalone = g_standalone,
+    .quit_warned = g_quit_warned,
+  };
+  H = (hex_view_t){ .fd = -1 };
+  g_active = false;
+  g_standalone = false;
+  g_quit_warned = false;
+}
+
+/**
+ * @brief Show the hex view parked in `in` (the one shown must be parked first).
+ */
+void editor_hex_load(const hex_park_t *in) {
+  H = in->view;
+  g_active = in->active;
+  g_standalone = in->standalone;
+  g_quit_warned = in->quit_warned;
+}
@@ -1,26 +1,78 @@
+#define ZILO_LOG_MODULE LOG_MODULE_INPUT
 #include "input.h"
+#include "buffer.h"
+#include "command.h"
 #include "edit.h"
+#include "hex.h"
 #include "ops.h"
+#include "page.h"
+#include "replay.h"
+#include "row.h"
+#include "stats.h"
 #include "terminal.h"
+#include "trace.h"
+#include "wrap.h"
 #include "zilo.h"
 #include <stdlib.h>
 
+/**
+ * @brief Move the cursor one visual line up or down (soft-wrap mode).
+ *
+ * The cursor keeps its column inside the visual line. Rows and visual lines
+ * are mapped through the wrap index in O(log n).
+ *
+ * @param dir -1 (up) or 1 (down).
+ */
+static void cursor_move_visual_line(int dir) {
+  if (E.cy >= E.numrows) return;
+
+  erow_t *row = editor_row_at(E.cy);
+  if (!row) return;
+  int seg;
+  int sub = editor_wrap_segment_of(row, E.cx, &seg);
+  int col = editor_row_cx_to_rx(row, E.cx) - editor_wrap_segment_col(row, sub, seg);
+
+  int line = editor_wrap_row_to_line(E.cy) + sub + dir;
+  if (line < 0 || line >= editor_wrap_row_to_line(E.numrows)) return;
+
+  E.cy = editor_wrap_line_to_row(line, &sub);
+  row = editor_row_at(E.cy);
+  if (!row) return;
+  seg = editor_wrap_segment_start(row, sub);
+  int end = editor_wrap_segment_end(row, seg);
+
+  // Stay inside the target visual line
+  E.cx = editor_row_rx_to_cx(row, editor_wrap_segment_col(row, sub, seg) + col);
+  if (E.cx < seg) E.cx = seg;
+  if (E.cx >= end) E.cx = MAX(seg, editor_row_prev_char(row, end));
+}
+
 static void cursor_move(char c) {
+  if (E.wrap && (c == 'j' || c == 'k')) {
+    cursor_move_visual_line(c == 'j' ? 1 : -1);
+    return;
+  }
+
   // Get the current row object (to prevent crashes when file is empty)
   // If file is empty:
   //  - E.cy is 0
   //  - E.numrows is 0
-  //  - E.row is NULL
-  erow_t *row = (E.cy >= E.numrows) ? NULL : &E.row[E.cy];
+  //  - editor_row_at() is NULL
+  erow_t *row = editor_row_at(E.cy);
+
+  // Vertical moves keep the display column, not the byte offset
+  int rx = row ? editor_row_cx_to_rx(row, E.cx) : 0;
 
   switch (c) {
     case 'h':  // Left
-      if (E.cx > 0) E.cx --;
+      if (row && E.cx > 0) E.cx = editor_row_prev_char(row, E.cx);
       break;
     case 'l':  // Right
       // The cursor only moves if row exists 
       // and cursor is not at the end of the line
-      if (row && E.cx < row->size - 1) E.cx ++;
+      if (row && editor_row_next_char(row, E.cx) < row->size) {
+        E.cx = editor_row_next_char(row, E.cx);
+      }
       break;
     case 'k':  // Up
       if (E.cy > 0) E.cy --;
@@ -39,26 +91,28 @@ static void cursor_move(char c) {
   //  - `E.cy` becomes 1
   //  - `E.cx` remains 10
   // The cursor position is now (1, 10). However, line 1 has only 2 characters!
-  // Attempting to render or access `E.row[1].chars[10]` will cause an out-of bounds
+  // Attempting to render or access `chars[10]` of line 1 will cause an out-of bounds
   // memory access. Moreover, the cursor would also be rendered at a position where 
   // no text exists.
 
   // After moving, `cy` may have changed, requiring a new row to be retrieved
-  row = (E.cy >= E.numrows) ? NULL : &E.row[E.cy];
+  row = editor_row_at(E.cy);
   // int rowlen = row ? row->size - E.coloff - 1 : 0;
   int rowlen = row ? row->size : 0;
 
+  if (row && (c == 'j' || c == 'k')) E.cx = editor_row_rx_to_cx(row, rx);
+
   // NOTE: For blank rows, rowlen is 0, and E.cx is -1, 
   // so we need to ensure that blank rows remain in column 0.
-  if (E.cx > rowlen) {
-    E.cx = rowlen - 1;
-    if (E.cx < 0) E.cx = 0;
+  if (E.cx > rowlen || (row && (c == 'j' || c == 'k') && E.cx == rowlen)) {
+    E.cx = row ? editor_row_prev_char(row, rowlen) : 0;
   }
 }
 
 static void process_keypress_normal(char c) {
   if      (c == 'q')            { editor_op_exit(); }
   else if (c == 'i')            { E.mode = MODE_INSERT; }
+  else if (c == ':')            { editor_command_start(); }
   else if (c == 'r')            { E.mode = MODE_REPLACE_ONCE; }
   else if (c == 'R')            { E.mode = MODE_REPLACE; }
   else if (c == 'v')            { E.mode = MODE_VISUAL; E.select_cy = E.cy; E.select_cx = E.cx; }
@@ -75,6 +129,7 @@ static void process_keypress_normal(char c) {
   else if (c == 'A')            { editor_op_append_eol(); }
   else if (c == 'I')            { editor_op_insert_bol(); }
   else if (c == CTRL_KEY('s'))  { editor_op_save_file(); }
+  else if (c == CTRL_KEY('w'))  { editor_window_next(); }
   else if (c == 'h' ||
            c == 'j' ||
            c == 'k' ||
@@ -100,17 +155,18 @@ static void process_keypress_replace(char c) {
   // Get the current row
   if (E.cy >= E.numrows) {
     E.mode = MODE_NORMAL;
+    return;
   }
 
-  erow_t *row = &E.row[E.cy];
+  erow_t *row = editor_row_at(E.cy);
  
   // If the cursor position exceeds the line length, it cannot be replaced
-  if (E.cx >= row->size) {
+  if (!row || E.cx >= row->size) {
     E.mode = MODE_NORMAL;
     return;
   }
 
-  row->chars[E.cx] = c;
+  editor_row_set_char(row, E.cx, c);
 
   E.cx ++;
 }
@@ -125,17 +181,18 @@ static void process_keypress_replace_only(char c) {
   // Get the current row
   if (E.cy >= E.numrows) {
     E.mode = MODE_NORMAL;
+    return;
   }
 
-  erow_t *row = &E.row[E.cy];
+  erow_t *row = editor_row_at(E.cy);
 
   // If the cursor position exceeds the line length, it cannot be replaced
-  if (E.cx >= row->size) {
+  if (!row || E.cx >= row->size) {
     E.mode = MODE_NORMAL;
     return;
   }
 
-  row->chars[E.cx] = c;
+  editor_row_set_char(row, E.cx, c);
 
   E.mode = MODE_NORMAL;
 }
@@ -173,9 +230,19 @@ static void process_keypress_visual_block(char c) {
   else if (c == 'd' || c == 'x')   { editor_op_delete_visual_block(); }
 }
 
-// Handling key input.
-void editor_process_keypress(void) {
-  char c = editor_readkey();
+/**
+ * @brief Apply one key in the current mode.
+ *
+ * @param c The key.
+ */
+void editor_process_key(char c) {
+  TRACE_SPAN("process_keypress");
+
+  // The hex view has keys of its own, but the same command line
+  if (editor_hex() && E.mode != MODE_COMMAND) {
+    editor_hex_key(c);
+    return;
+  }
 
   switch (E.mode) {
     case MODE_NORMAL:        process_keypress_normal(c);       break;
@@ -185,6 +252,18 @@ void editor_process_keypress(void) {
     case MODE_VISUAL:        process_keypress_visual(c);       break;
     case MODE_VISUAL_LINE:   process_keypress_visual_line(c);  break;
     case MODE_VISUAL_BLOCK:  process_keypress_visual_block(c); break;
+    case MODE_COMMAND:       editor_command_keypress(c);       break;
     default: break;
   }
 }
+
+/**
+ * @brief Read one key from the terminal and apply it.
+ */
+void editor_process_keypress(void) {
+  char c = editor_readkey();
+  editor_stats_key_read();
+  editor_record_key(c);
+
+  editor_process_key(c);
+}
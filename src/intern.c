@@ -0,0 +1,171 @@
+#define ZILO_LOG_MODULE LOG_MODULE_EDIT
+#include "intern.h"
+#include "logger.h"
+#include "mem.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Identical rows (blank lines, separators, repeated stack traces) can share
+ * one payload. A payload is immutable and reference counted; the row that
+ * edits it first takes a private copy (see editor_row_grow()).
+ *
+ * The table is a chained hash table owned by the main thread, like the rows of E.
+ */
+
+#define INTERN_MIN_BUCKETS 1024
+
+typedef struct intern_str {
+  struct intern_str *next;  // Next payload of the bucket
+  uint64_t hash;
+  int refs;
+  int len;
+  char data[];              // `len` bytes and '\0'
+} intern_str_t;
+
+static intern_str_t **g_buckets = NULL;
+static size_t g_nbuckets = 0;   // Power of two
+static intern_stats_t g_stats;
+
+/**
+ * @brief Fast 64-bit hash of `len` bytes (8 bytes per step).
+ */
+uint64_t intern_hash(const char *s, size_t len) {
+  uint64_t h = 0x9e3779b97f4a7c15ULL ^ len;
+
+  while (len >= 8) {
+    uint64_t w;
+    memcpy(&w, s, 8);
+    h = (h ^ w) * 0xff51afd7ed558ccdULL;
+    h ^= h >> 32;
+    s += 8;
+    len -= 8;
+  }
+
+  uint64_t w = 0;
+  memcpy(&w, s, len);
+  h = (h ^ w) * 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 29;
+  return h;
+}
+
+/**
+ * @brief Double the number of buckets (chains are relinked, not copied).
+ *
+ * @return Returns 0 on success, -1 on failure (the table is unchanged).
+ */
+static int intern_grow(void) {
+  size_t n = g_nbuckets ? g_nbuckets * 2 : INTERN_MIN_BUCKETS;
+  intern_str_t **buckets = zilo_calloc(MEM_INTERN, n, sizeof(intern_str_t *));
+  if (!buckets) return -1;
+
+  for (size_t i = 0; i < g_nbuckets; ++ i) {
+    intern_str_t *e = g_buckets[i];
+    while (e) {
+      intern_str_t *next = e->next;
+      e->next = buckets[e->hash & (n - 1)];
+      buckets[e->hash & (n - 1)] = e;
+      e = next;
+    }
+  }
+
+  zilo_free(MEM_INTERN, g_buckets);
+  g_buckets = buckets;
+  g_nbuckets = n;
+  return 0;
+}
+
+/**
+ * @brief Return the shared copy of `len` bytes of `s`, creating it if needed.
+ *
+ * @return Returns the payload ('\0' terminated, must not be written), or NULL on failure.
+ */
+char *intern_get(const char *s, size_t len) {
+  // Keep about one payload per bucket
+  if ((size_t)g_stats.strings >= g_nbuckets && intern_grow() == -1) {
+    if (!g_buckets) return NULL;   // Longer chains are fine, no table is not
+  }
+
+  uint64_t hash = intern_hash(s, len);
+  intern_str_t **bucket = &g_buckets[hash & (g_nbuckets - 1)];
+
+  for (intern_str_t *e = *bucket; e; e = e->next) {
+    if (e->hash == hash && (size_t)e->len == len && !memcmp(e->data, s, len)) {
+      e->refs ++;
+      g_stats.refs ++;
+      g_stats.saved += len;
+      return e->data;
+    }
+  }
+
+  intern_str_t *e = zilo_malloc(MEM_INTERN, sizeof(intern_str_t) + len + 1);
+  if (!e) {
+    LOG_ERROR("malloc", "Failed to allocate an interned row.");
+    return NULL;
+  }
+  e->hash = hash;
+  e->refs = 1;
+  e->len = len;
+  memcpy(e->data, s, len);
+  e->data[len] = '\0';
+  e->next = *bucket;
+  *bucket = e;
+
+  g_stats.strings ++;
+  g_stats.refs ++;
+  g_stats.bytes += len;
+  return e->data;
+}
+
+/**
+ * @brief Take one more reference to a payload.
+ *
+ * @param s A string returned by intern_get().
+ *
+ * @return Returns `s`.
+ */
+char *intern_ref(char *s) {
+  intern_str_t *e = (intern_str_t *)(s - offsetof(intern_str_t, data));
+  e->refs ++;
+  g_stats.refs ++;
+  g_stats.saved += e->len;
+  return s;
+}
+
+/**
+ * @brief Drop a reference. The last one frees the payload (and the table
+ *        once it is empty).
+ *
+ * @param s A string returned by intern_get().
+ */
+void intern_release(char *s) {
+  if (!s) return;
+
+  intern_str_t *e = (intern_str_t *)(s - offsetof(intern_str_t, data));
+  g_stats.refs --;
+  if (-- e->refs > 0) {
+    g_stats.saved -= e->len;
+    return;
+  }
+
+  intern_str_t **p = &g_buckets[e->hash & (g_nbuckets - 1)];
+  while (*p != e) p = &(*p)->next;
+  *p = e->next;
+
+  g_stats.strings --;
+  g_stats.bytes -= e->len;
+  zilo_free(MEM_INTERN, e);
+
+  if (g_stats.strings == 0) {
+    zilo_free(MEM_INTERN, g_buckets);
+    g_buckets = NULL;
+    g_nbuckets = 0;
+  }
+}
+
+/**
+ * @brief Snapshot the counters.
+ */
+void intern_stats(intern_stats_t *out) {
+  *out = g_stats;
+}
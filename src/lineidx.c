@@ -0,0 +1,296 @@
+#define _POSIX_C_SOURCE 200809L
+#define ZILO_LOG_MODULE LOG_MODULE_FILE
+
+#include "lineidx.h"
+#include "logger.h"
+#include "mem.h"
+#include "page.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * The index of a file lives in $XDG_CACHE_HOME/zilo/lines (or
+ * ~/.cache/zilo/lines) under the name "<dev>-<inode>.idx". It holds one run
+ * per LINE_INDEX_STRIDE lines: where the run starts, its length and the
+ * hash of its lines, which is all a page of rows left in the file needs
+ * (see editor_rows_append_file()), so a file opened again is not read up to
+ * the end of the runs. The header repeats the identity of the file (device,
+ * inode, size, mtime):
+ *  - same size and mtime: the index is used as is;
+ *  - same inode, larger size and the same last LINE_INDEX_TAIL bytes: the
+ *    file was appended to and only the new bytes are read;
+ *  - anything else: the index is rebuilt.
+ * A run that no longer matches the file is caught when its page is read
+ * back, against the hash of its lines.
+ */
+
+#define LINE_INDEX_MAGIC "ZILOLIX2"
+
+typedef struct {
+  char magic[8];
+  uint64_t dev;
+  uint64_t ino;
+  uint64_t size;        // Bytes read when the index was saved
+  int64_t mtime_sec;
+  int64_t mtime_nsec;
+  uint32_t stride;
+  uint32_t reserved;
+  uint64_t tail_hash;   // FNV-1a of the last LINE_INDEX_TAIL bytes read
+  uint64_t count;       // Runs that follow
+} line_index_header_t;
+
+/**
+ * @brief Initialize an empty index.
+ */
+void line_index_init(line_index_t *idx) {
+  *idx = (line_index_t){ .cur.text = { 0, 1 } };
+}
+
+/**
+ * @brief Release the index.
+ */
+void line_index_free(line_index_t *idx) {
+  zilo_free(MEM_FILE, idx->runs);
+  line_index_init(idx);
+}
+
+/**
+ * @brief Account the next line of the file; every LINE_INDEX_STRIDE lines
+ *        make a run.
+ *
+ * @param origin Offset of the line.
+ * @param len    Its bytes, without the line break.
+ * @param crlf   It ends with "\r\n" rather than '\n'.
+ * @param hash   Hash of its bytes (see editor_hash_line()).
+ */
+void line_index_add(line_index_t *idx, int64_t origin, int len, bool crlf, uint64_t hash) {
+  line_run_t *cur = &idx->cur;
+  if (idx->cur_lines == 0) cur->pos = origin;
+  cur->len += len + 1 + crlf;
+  cur->crlf += crlf;
+  page_hash_add(&cur->text, &cur->eol, hash, crlf);
+  if (++ idx->cur_lines < LINE_INDEX_STRIDE) return;
+
+  if (idx->count == idx->cap) {
+    int64_t cap = idx->cap ? idx->cap * 2 : 64;
+    line_run_t *runs = zilo_realloc(MEM_FILE, idx->runs, sizeof(line_run_t) * cap);
+    if (!runs) {
+      // The index stops here: the lines after it are read every time
+      LOG_ERROR("realloc", "Failed to expand the line index.");
+      return;
+    }
+    idx->runs = runs;
+    idx->cap = cap;
+  }
+  idx->runs[idx->count ++] = *cur;
+  *cur = (line_run_t){ .text = { 0, 1 } };
+  idx->cur_lines = 0;
+}
+
+/**
+ * @brief Offset of the end of the last run (0 if there is none).
+ */
+int64_t line_index_end(const line_index_t *idx) {
+  if (idx->count == 0) return 0;
+  const line_run_t *last = &idx->runs[idx->count - 1];
+  return last->pos + last->len;
+}
+
+/*------------------------------------------
+                PERSISTENCE
+ ------------------------------------------*/
+/**
+ * @brief Path of the cache file for the file `st`.
+ *
+ * @param create Create the directories on the way.
+ *
+ * @return Returns 0 on success, -1 if there is no usable cache directory.
+ */
+static int line_index_path(const struct stat *st, char *out, size_t size, bool create) {
+  char dir[PATH_MAX];
+  const char *xdg = getenv("XDG_CACHE_HOME");
+  const char *home = getenv("HOME");
+
+  int n;
+  if (xdg && xdg[0] == '/') n = snprintf(dir, sizeof(dir), "%s", xdg);
+  else if (home) n = snprintf(dir, sizeof(dir), "%s/.cache", home);
+  else return -1;
+  if (n < 0 || (size_t)n >= sizeof(dir) - 16) return -1;
+
+  // Create <cache>, <cache>/zilo and <cache>/zilo/lines as needed
+  static const char *parts[] = { "", "/zilo", "/lines" };
+  for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); ++ i) {
+    strcat(dir, parts[i]);
+    if (create && mkdir(dir, 0700) == -1 && errno != EEXIST) return -1;
+  }
+
+  n = snprintf(out, size, "%s/%llx-%llx.idx", dir,
+               (unsigned long long)st->st_dev, (unsigned long long)st->st_ino);
+  return n < 0 || (size_t)n >= size ? -1 : 0;
+}
+
+/**
+ * @brief FNV-1a of the LINE_INDEX_TAIL bytes of `path` that end at `size`.
+ *
+ * @return Returns 0 on success, -1 if they cannot be read.
+ */
+static int file_tail_hash(const char *path, uint64_t size, uint64_t *hash) {
+  char buf[LINE_INDEX_TAIL];
+  uint64_t len = size < LINE_INDEX_TAIL ? size : LINE_INDEX_TAIL;
+
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) return -1;
+  ssize_t n = pread(fd, buf, len, size - len);
+  close(fd);
+  if (n != (ssize_t)len) return -1;
+
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (uint64_t i = 0; i < len; ++ i) {
+    h ^= (unsigned char)buf[i];
+    h *= 0x100000001b3ULL;
+  }
+  *hash = h;
+  return 0;
+}
+
+/**
+ * @brief Decide what a cached header is worth for the file as it is now.
+ */
+static line_index_state_e line_index_check(const line_index_header_t *h, const char *path, const struct stat *st) {
+  if (memcmp(h->magic, LINE_INDEX_MAGIC, sizeof(h->magic)) ||
+      h->stride != LINE_INDEX_STRIDE ||
+      h->dev != (uint64_t)st->st_dev || h->ino != (uint64_t)st->st_ino ||
+      h->count > h->size / LINE_INDEX_STRIDE) {
+    return LINE_INDEX_MISS;
+  }
+
+  if (h->size == (uint64_t)st->st_size &&
+      h->mtime_sec == st->st_mtim.tv_sec && h->mtime_nsec == st->st_mtim.tv_nsec) {
+    return LINE_INDEX_EXACT;
+  }
+
+  // Same file, longer, and the bytes the index was read up to are still there
+  uint64_t tail;
+  if (h->size < (uint64_t)st->st_size &&
+      file_tail_hash(path, h->size, &tail) == 0 && tail == h->tail_hash) {
+    return LINE_INDEX_APPENDED;
+  }
+
+  return LINE_INDEX_MISS;
+}
+
+/**
+ * @brief True if the runs follow each other from offset 0 to at most `size`.
+ */
+static bool line_index_runs_valid(const line_run_t *runs, uint64_t count, uint64_t size) {
+  int64_t at = 0;
+  for (uint64_t k = 0; k < count; ++ k) {
+    const line_run_t *r = &runs[k];
+    if (r->pos != at || r->len < LINE_INDEX_STRIDE || r->crlf < 0 || r->crlf > LINE_INDEX_STRIDE) return false;
+    at += r->len;
+  }
+  return (uint64_t)at <= size;
+}
+
+/**
+ * @brief Load the cached index of `path` and check it still applies.
+ *
+ * @param idx  Empty index, given the cached runs unless MISS is returned.
+ * @param path The indexed file.
+ * @param st   Its current stat.
+ */
+line_index_state_e line_index_load(line_index_t *idx, const char *path, const struct stat *st) {
+  char cache[PATH_MAX];
+  if (line_index_path(st, cache, sizeof(cache), false) == -1) return LINE_INDEX_MISS;
+
+  FILE *fp = fopen(cache, "rb");
+  if (!fp) return LINE_INDEX_MISS;
+
+  line_index_header_t h;
+  line_index_state_e state = LINE_INDEX_MISS;
+  if (fread(&h, sizeof(h), 1, fp) == 1) state = line_index_check(&h, path, st);
+
+  line_run_t *runs = NULL;
+  if (state != LINE_INDEX_MISS && h.count > 0) {
+    runs = zilo_malloc(MEM_FILE, sizeof(line_run_t) * h.count);
+    if (!runs || fread(runs, sizeof(line_run_t), h.count, fp) != h.count ||
+        !line_index_runs_valid(runs, h.count, h.size)) {
+      state = LINE_INDEX_MISS;
+    }
+  }
+  fclose(fp);
+
+  LOG_DEBUG("line_index_load", "Line index of <%s>: %s.", path,
+            state == LINE_INDEX_EXACT ? "exact" : state == LINE_INDEX_APPENDED ? "appended" : "miss");
+
+  if (state == LINE_INDEX_MISS) {
+    zilo_free(MEM_FILE, runs);
+    return state;
+  }
+
+  zilo_free(MEM_FILE, idx->runs);
+  idx->runs = runs;
+  idx->count = idx->cap = h.count;
+  return state;
+}
+
+/**
+ * @brief Store the index of `path` in the cache directory.
+ *
+ * The file is written under a temporary name and renamed, so a reader never
+ * sees half an index.
+ *
+ * @param st   The stat of the file when it was opened.
+ * @param size Bytes of the file that were read.
+ *
+ * @return Returns 0 on success, -1 on failure.
+ */
+int line_index_save(const line_index_t *idx, const char *path, const struct stat *st, int64_t size) {
+  char cache[PATH_MAX], tmp[PATH_MAX + 32];
+  if (line_index_path(st, cache, sizeof(cache), true) == -1) return -1;
+  snprintf(tmp, sizeof(tmp), "%s.%d", cache, (int)getpid());
+
+  line_index_header_t h = { 0 };
+  memcpy(h.magic, LINE_INDEX_MAGIC, sizeof(h.magic));
+  h.dev = st->st_dev;
+  h.ino = st->st_ino;
+  h.size = size;
+  h.mtime_sec = st->st_mtim.tv_sec;
+  h.mtime_nsec = st->st_mtim.tv_nsec;
+  h.stride = LINE_INDEX_STRIDE;
+  h.count = idx->count;
+  if (file_tail_hash(path, size, &h.tail_hash) == -1) return -1;
+
+  FILE *fp = fopen(tmp, "wb");
+  if (!fp) return -1;
+
+  int ok = fwrite(&h, sizeof(h), 1, fp) == 1 &&
+           (idx->count == 0 || fwrite(idx->runs, sizeof(line_run_t), idx->count, fp) == (size_t)idx->count);
+  if (fclose(fp) != 0) ok = 0;
+
+  if (!ok || rename(tmp, cache) == -1) {
+    LOG_WARN("line_index_save", "Failed to write the line index <%s>.", cache);
+    unlink(tmp);
+    return -1;
+  }
+
+  LOG_DEBUG("line_index_save", "Saved the line index of <%s> (%lld runs).", path, (long long)idx->count);
+  return 0;
+}
+
+/**
+ * @brief Forget the cached index of `path` (it was rewritten in place).
+ *
+ * An edit in the middle of the file can leave its size and tail looking
+ * like an append, so the index is not trusted after a save.
+ */
+void line_index_drop(const char *path) {
+  struct stat st;
+  char cache[PATH_MAX];
+  if (stat(path, &st) == 0 && line_index_path(&st, cache, sizeof(cache), false) == 0) unlink(cache);
+}
@@ -0,0 +1,560 @@
+#define ZILO_LOG_MODULE LOG_MODULE_EDIT
+#include "lline.h"
+#include "logger.h"
+#include "mem.h"
+#include "utf8.h"
+#include "zilo.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*------------------------------------------
+              CHARACTER WIDTHS
+ ------------------------------------------*/
+/**
+ * @brief Display width of the character starting at `s`.
+ *
+ * Unlike regular rows, a tab always counts as ZILO_TAB_STOP columns so that
+ * the width of a chunk does not depend on where the chunk starts.
+ *
+ * @param s   Bytes.
+ * @param len Number of bytes available (> 0).
+ * @param n   Set to the length of the character in bytes.
+ */
+int lline_char_width(const char *s, int len, int *n) {
+  unsigned char c = s[0];
+
+  *n = 1;
+  if (c == '\t') return ZILO_TAB_STOP;
+  if (c < 32 || c == 127) return 2;   // "^X"
+  if (c < 0x80) return 1;
+
+  uint32_t cp;
+  *n = utf8_decode(s, len, &cp);
+  if (*n == 1) return 1;              // Invalid byte, shown as U+FFFD
+  return utf8_width(cp);
+}
+
+/**
+ * @brief Display width of `len` bytes.
+ */
+static int bytes_width(const char *s, int len) {
+  int width = 0;
+  for (int j = 0; j < len; ) {
+    int n;
+    width += lline_char_width(s + j, len - j, &n);
+    j += n;
+  }
+  return width;
+}
+
+/*------------------------------------------
+                  HASHES
+ ------------------------------------------*/
+/*
+ * A long row is hashed as the polynomial sum of (byte + 1) * B^k modulo the
+ * prime 2^61 - 1, the last byte taking k = 0. The hash of two runs of bytes
+ * put together is then hash(a) * B^len(b) + hash(b), so every chunk keeps
+ * its own hash and a segment tree folds them: an edit re-hashes the chunk
+ * it touched and the O(log k) nodes above it, whatever the row length and
+ * however the bytes are cut into chunks.
+ */
+
+/**
+ * @brief Polynomial hash of `len` bytes (see above).
+ */
+uint64_t lline_hash_bytes(const char *s, int len) {
+  uint64_t h = 0;
+  for (int i = 0; i < len; ++ i) h = lhash_add(lhash_mul(h, LHASH_BASE), (unsigned char)s[i] + 1);
+  return h;
+}
+
+/**
+ * @brief Hash a chunk and the power of the base that shifts past it.
+ */
+static void chunk_hash(lchunk_t *c) {
+  c->hash = lline_hash_bytes(c->data, c->len);
+
+  uint64_t pow = 1, base = LHASH_BASE;
+  for (int e = c->len; e > 0; e >>= 1) {
+    if (e & 1) pow = lhash_mul(pow, base);
+    base = lhash_mul(base, base);
+  }
+  c->pow = pow;
+}
+
+/**
+ * @brief Put the hash of chunk `i` in the tree and fold it up to the root.
+ */
+static void ll_hash_update(lline_t *ll, int i) {
+  if (i >= ll->hash_leaves) return;
+
+  int p = ll->hash_leaves + i;
+  ll->hash_tree[p] = (lhash_t){ ll->chunks[i].hash, ll->chunks[i].pow };
+  for (p /= 2; p >= 1; p /= 2) ll->hash_tree[p] = lhash_join(ll->hash_tree[2 * p], ll->hash_tree[2 * p + 1]);
+}
+
+/**
+ * @brief Hash of the bytes of a long row.
+ *
+ * Without a tree (it could not be allocated) the chunk hashes are folded
+ * one after the other, so the hash is never wrong.
+ */
+uint64_t lline_hash(const lline_t *ll) {
+  if (ll->hash_leaves >= ll->nchunks && ll->hash_tree) return ll->hash_tree[1].hash;
+
+  lhash_t h = { 0, 1 };
+  for (int i = 0; i < ll->nchunks; ++ i) h = lhash_join(h, (lhash_t){ ll->chunks[i].hash, ll->chunks[i].pow });
+  return h.hash;
+}
+
+/**
+ * @brief Move `at` back to the start of a UTF-8 character.
+ */
+static int char_boundary(const char *s, int at) {
+  while (at > 0 && UTF8_IS_CONT(s[at])) at --;
+  return at;
+}
+
+/*------------------------------------------
+              FENWICK TREES
+ ------------------------------------------*/
+static void fenwick_add(int *tree, int n, int i, int delta) {
+  for (int k = i + 1; k <= n; k += k & -k) tree[k] += delta;
+}
+
+static int fenwick_prefix(const int *tree, int i) {
+  int sum = 0;
+  for (int k = i; k > 0; k -= k & -k) sum += tree[k];
+  return sum;
+}
+
+/**
+ * @brief Find the largest `pos` with prefix(pos) <= value (Fenwick descent).
+ *
+ * @param rem Set to `value - prefix(pos)`.
+ */
+static int fenwick_search(const int *tree, int n, int value, int *rem) {
+  int pos = 0;
+  int step = 1;
+  while (step * 2 <= n) step *= 2;
+
+  for (; step > 0; step /= 2) {
+    if (pos + step <= n && tree[pos + step] <= value) {
+      pos += step;
+      value -= tree[pos];
+    }
+  }
+
+  *rem = value;
+  return pos;
+}
+
+/**
+ * @brief Rebuild the trees in O(k) after chunks were added or removed.
+ */
+static void ll_rebuild(lline_t *ll) {
+  int n = ll->nchunks;
+  int leaves = 1;
+  while (leaves < n) leaves *= 2;
+
+  int *len_tree = zilo_realloc(MEM_ROWS, ll->len_tree, sizeof(int) * (n + 1));
+  int *width_tree = len_tree ? zilo_realloc(MEM_ROWS, ll->width_tree, sizeof(int) * (n + 1)) : NULL;
+  lhash_t *hash_tree = width_tree ? zilo_realloc(MEM_ROWS, ll->hash_tree, sizeof(lhash_t) * 2 * leaves) : NULL;
+  if (!len_tree || !width_tree || !hash_tree) {
+    LOG_ERROR("realloc", "Failed to expand the long-line index.");
+    if (len_tree) ll->len_tree = len_tree;
+    if (width_tree) ll->width_tree = width_tree;
+    ll->hash_leaves = 0;   // lline_hash() folds the chunks instead
+    return;
+  }
+  ll->len_tree = len_tree;
+  ll->width_tree = width_tree;
+  ll->hash_tree = hash_tree;
+  ll->hash_leaves = leaves;
+
+  // Leaves past the last chunk are empty runs: hash 0, shift 1
+  for (int i = 0; i < leaves; ++ i) {
+    hash_tree[leaves + i] = i < n ? (lhash_t){ ll->chunks[i].hash, ll->chunks[i].pow }
+                                  : (lhash_t){ 0, 1 };
+  }
+  for (int p = leaves - 1; p >= 1; -- p) hash_tree[p] = lhash_join(hash_tree[2 * p], hash_tree[2 * p + 1]);
+
+  ll->size = 0;
+  ll->width = 0;
+  len_tree[0] = width_tree[0] = 0;
+  for (int i = 0; i < n; ++ i) {
+    len_tree[i + 1] = ll->chunks[i].len;
+    width_tree[i + 1] = ll->chunks[i].width;
+    ll->size += ll->chunks[i].len;
+    ll->width += ll->chunks[i].width;
+  }
+  for (int k = 1; k <= n; ++ k) {
+    int parent = k + (k & -k);
+    if (parent <= n) {
+      len_tree[parent] += len_tree[k];
+      width_tree[parent] += width_tree[k];
+    }
+  }
+}
+
+/**
+ * @brief Find the chunk containing byte offset `cx` (O(log k)).
+ *
+ * @param off Set to the offset inside the chunk.
+ *
+ * @return Returns the chunk index (the last chunk if `cx` is the end of the row).
+ */
+static int ll_locate(const lline_t *ll, int cx, int *off) {
+  int i = fenwick_search(ll->len_tree, ll->nchunks, cx, off);
+  if (i >= ll->nchunks) {
+    i = ll->nchunks - 1;
+    *off = ll->chunks[i].len;
+  }
+  return i;
+}
+
+/*------------------------------------------
+              CHUNK MANAGEMENT
+ ------------------------------------------*/
+/**
+ * @brief Cut `len` bytes of `s` into chunks of about LLINE_CHUNK bytes.
+ *
+ * @param count Set to the number of chunks.
+ *
+ * @return Returns the chunk array (NULL on failure).
+ */
+static lchunk_t *make_chunks(const char *s, int len, int *count) {
+  int cap = len / LLINE_CHUNK + 2;
+  lchunk_t *chunks = zilo_malloc(MEM_ROWS, sizeof(lchunk_t) * cap);
+  if (!chunks) return NULL;
+
+  int n = 0;
+  int at = 0;
+  while (at < len) {
+    int end = len;
+    if (len - at > LLINE_CHUNK) {
+      end = char_boundary(s, at + LLINE_CHUNK);
+      if (end <= at) end = at + LLINE_CHUNK;
+    }
+
+    lchunk_t *c = &chunks[n ++];
+    c->len = end - at;
+    c->data = zilo_malloc(MEM_ROWS, c->len);
+    if (!c->data) {
+      LOG_ERROR("malloc", "Failed to allocate a long-line chunk.");
+      c->len = 0;
+      c->width = 0;
+      chunk_hash(c);
+      break;
+    }
+    memcpy(c->data, s + at, c->len);
+    c->width = bytes_width(c->data, c->len);
+    chunk_hash(c);
+    at = end;
+  }
+
+  *count = n;
+  return chunks;
+}
+
+/**
+ * @brief Replace chunks [i, i + nremove) with `nnew` chunks.
+ */
+static void ll_splice(lline_t *ll, int i, int nremove, lchunk_t *new_chunks, int nnew) {
+  int n = ll->nchunks - nremove + nnew;
+  if (n > ll->cap) {
+    int cap = MAX(n, ll->cap * 2);
+    lchunk_t *chunks = zilo_realloc(MEM_ROWS, ll->chunks, sizeof(lchunk_t) * cap);
+    if (!chunks) {
+      LOG_ERROR("realloc", "Failed to expand the long-line chunks.");
+      for (int k = 0; k < nnew; ++ k) zilo_free(MEM_ROWS, new_chunks[k].data);
+      return;
+    }
+    ll->chunks = chunks;
+    ll->cap = cap;
+  }
+
+  for (int k = i; k < i + nremove; ++ k) zilo_free(MEM_ROWS, ll->chunks[k].data);
+  memmove(&ll->chunks[i + nnew], &ll->chunks[i + nremove],
+          sizeof(lchunk_t) * (ll->nchunks - i - nremove));
+  memcpy(&ll->chunks[i], new_chunks, sizeof(lchunk_t) * nnew);
+  ll->nchunks = n;
+
+  ll_rebuild(ll);
+}
+
+/*------------------------------------------
+              PUBLIC INTERFACE
+ ------------------------------------------*/
+/**
+ * @brief Build a long row from `len` bytes of `s`.
+ *
+ * @return Returns the long row (NULL on failure).
+ */
+lline_t *lline_new(const char *s, int len) {
+  lline_t *ll = zilo_calloc(MEM_ROWS, 1, sizeof(lline_t));
+  if (!ll) return NULL;
+
+  int n;
+  ll->chunks = make_chunks(s, len, &n);
+  if (!ll->chunks) {
+    zilo_free(MEM_ROWS, ll);
+    return NULL;
+  }
+  ll->nchunks = n;
+  ll->cap = len / LLINE_CHUNK + 2;
+
+  ll_rebuild(ll);
+  return ll;
+}
+
+/**
+ * @brief Release a long row.
+ */
+void lline_free(lline_t *ll) {
+  if (!ll) return;
+
+  for (int i = 0; i < ll->nchunks; ++ i) zilo_free(MEM_ROWS, ll->chunks[i].data);
+  zilo_free(MEM_ROWS, ll->chunks);
+  zilo_free(MEM_ROWS, ll->len_tree);
+  zilo_free(MEM_ROWS, ll->width_tree);
+  zilo_free(MEM_ROWS, ll->hash_tree);
+  zilo_free(MEM_ROWS, ll);
+}
+
+/**
+ * @brief Insert `len` bytes of `s` at byte offset `at`.
+ *
+ * Only the chunk at `at` is touched (at most LLINE_CHUNK_MAX bytes moved).
+ * A chunk that grows past LLINE_CHUNK_MAX is cut again into regular chunks.
+ */
+void lline_insert(lline_t *ll, int at, const char *s, int len) {
+  if (len <= 0 || at < 0 || at > ll->size) return;
+
+  if (ll->nchunks == 0) {
+    int n;
+    lchunk_t *chunks = make_chunks(s, len, &n);
+    if (!chunks) return;
+    ll_splice(ll, 0, 0, chunks, n);
+    zilo_free(MEM_ROWS, chunks);
+    return;
+  }
+
+  int off;
+  int i = ll_locate(ll, at, &off);
+
+  // Keep a UTF-8 sequence typed byte by byte in the chunk of its lead byte
+  if (off == 0 && i > 0 && UTF8_IS_CONT(s[0])) {
+    i --;
+    off = ll->chunks[i].len;
+  }
+
+  lchunk_t *c = &ll->chunks[i];
+  int new_len = c->len + len;
+
+  if (new_len <= LLINE_CHUNK_MAX) {
+    char *data = zilo_realloc(MEM_ROWS, c->data, new_len);
+    if (!data) {
+      LOG_ERROR("realloc", "Failed to expand a long-line chunk.");
+      return;
+    }
+    memmove(data + off + len, data + off, c->len - off);
+    memcpy(data + off, s, len);
+    c->data = data;
+    c->len = new_len;
+
+    int width = bytes_width(c->data, c->len);
+    fenwick_add(ll->len_tree, ll->nchunks, i, len);
+    fenwick_add(ll->width_tree, ll->nchunks, i, width - c->width);
+    ll->size += len;
+    ll->width += width - c->width;
+    c->width = width;
+    chunk_hash(c);
+    ll_hash_update(ll, i);
+    return;
+  }
+
+  // Split the oversized chunk
+  char *buf = zilo_malloc(MEM_ROWS, new_len);
+  if (!buf) {
+    LOG_ERROR("malloc", "Failed to split a long-line chunk.");
+    return;
+  }
+  memcpy(buf, c->data, off);
+  memcpy(buf + off, s, len);
+  memcpy(buf + off + len, c->data + off, c->len - off);
+
+  int n;
+  lchunk_t *chunks = make_chunks(buf, new_len, &n);
+  zilo_free(MEM_ROWS, buf);
+  if (!chunks) return;
+
+  ll_splice(ll, i, 1, chunks, n);
+  zilo_free(MEM_ROWS, chunks);
+}
+
+/**
+ * @brief Delete `len` bytes starting at byte offset `at`.
+ */
+void lline_delete(lline_t *ll, int at, int len) {
+  if (at < 0 || len <= 0 || at >= ll->size) return;
+  if (len > ll->size - at) len = ll->size - at;
+
+  int emptied = 0;
+  while (len > 0) {
+    int off;
+    int i = ll_locate(ll, at, &off);
+    lchunk_t *c = &ll->chunks[i];
+
+    // Empty chunks are skipped by the search, so this only guards the end
+    if (off >= c->len) break;
+
+    int take = MIN(len, c->len - off);
+    memmove(c->data + off, c->data + off + take, c->len - off - take);
+    c->len -= take;
+
+    int width = bytes_width(c->data, c->len);
+    fenwick_add(ll->len_tree, ll->nchunks, i, -take);
+    fenwick_add(ll->width_tree, ll->nchunks, i, width - c->width);
+    ll->size -= take;
+    ll->width += width - c->width;
+    c->width = width;
+    chunk_hash(c);
+    ll_hash_update(ll, i);
+
+    if (c->len == 0) emptied ++;
+    len -= take;
+  }
+
+  if (emptied == 0) return;
+
+  // Drop empty chunks
+  int n = 0;
+  for (int i = 0; i < ll->nchunks; ++ i) {
+    if (ll->chunks[i].len == 0) {
+      zilo_free(MEM_ROWS, ll->chunks[i].data);
+      continue;
+    }
+    ll->chunks[n ++] = ll->chunks[i];
+  }
+  ll->nchunks = n;
+  ll_rebuild(ll);
+}
+
+/**
+ * @brief Copy `len` bytes starting at byte offset `at` into `dst`.
+ */
+void lline_read(const lline_t *ll, int at, int len, char *dst) {
+  if (at < 0 || len <= 0 || at >= ll->size) return;
+  if (len > ll->size - at) len = ll->size - at;
+
+  int off;
+  int i = ll_locate(ll, at, &off);
+  while (len > 0 && i < ll->nchunks) {
+    const lchunk_t *c = &ll->chunks[i];
+    int take = MIN(len, c->len - off);
+    memcpy(dst, c->data + off, take);
+    dst += take;
+    len -= take;
+    off = 0;
+    i ++;
+  }
+}
+
+/**
+ * @brief Overwrite the byte at offset `at`.
+ */
+void lline_set_byte(lline_t *ll, int at, char ch) {
+  if (at < 0 || at >= ll->size) return;
+
+  int off;
+  int i = ll_locate(ll, at, &off);
+  lchunk_t *c = &ll->chunks[i];
+  c->data[off] = ch;
+
+  int width = bytes_width(c->data, c->len);
+  fenwick_add(ll->width_tree, ll->nchunks, i, width - c->width);
+  ll->width += width - c->width;
+  c->width = width;
+  chunk_hash(c);
+  ll_hash_update(ll, i);
+}
+
+/**
+ * @brief Convert a byte offset into a display column (O(log k + chunk)).
+ */
+int lline_cx_to_rx(const lline_t *ll, int cx) {
+  if (cx <= 0 || ll->nchunks == 0) return 0;
+  if (cx >= ll->size) return ll->width;
+
+  int off;
+  int i = ll_locate(ll, cx, &off);
+  return fenwick_prefix(ll->width_tree, i) + bytes_width(ll->chunks[i].data, off);
+}
+
+/**
+ * @brief Convert a display column into the character covering it (O(log k + chunk)).
+ *
+ * @return Returns the byte offset (the row size if `rx` is past the end).
+ */
+int lline_rx_to_cx(const lline_t *ll, int rx) {
+  if (rx <= 0 || ll->nchunks == 0) return 0;
+  if (rx >= ll->width) return ll->size;
+
+  int rem;
+  int i = fenwick_search(ll->width_tree, ll->nchunks, rx, &rem);
+  if (i >= ll->nchunks) return ll->size;
+
+  const lchunk_t *c = &ll->chunks[i];
+  int base = fenwick_prefix(ll->len_tree, i);
+  for (int j = 0; j < c->len; ) {
+    int n;
+    int w = lline_char_width(c->data + j, c->len - j, &n);
+    if (rem < w) return base + j;
+    rem -= w;
+    j += n;
+  }
+  return base + c->len;
+}
+
+/**
+ * @brief Display width of the character at byte offset `cx`.
+ */
+static int ll_width_at(const lline_t *ll, int cx, int *n) {
+  int off;
+  int i = ll_locate(ll, cx, &off);
+  const lchunk_t *c = &ll->chunks[i];
+  return lline_char_width(c->data + off, c->len - off, n);
+}
+
+/**
+ * @brief Byte offset of the next character (combining marks are skipped).
+ */
+int lline_next_char(const lline_t *ll, int cx) {
+  if (cx >= ll->size) return ll->size;
+
+  int n;
+  ll_width_at(ll, cx, &n);
+  cx += n;
+
+  while (cx < ll->size && ll_width_at(ll, cx, &n) == 0) cx += n;
+  return cx;
+}
+
+/**
+ * @brief Byte offset of the previous character (combining marks are skipped).
+ */
+int lline_prev_char(const lline_t *ll, int cx) {
+  if (cx > ll->size) cx = ll->size;
+
+  while (cx > 0) {
+    int off;
+    int i = ll_locate(ll, cx - 1, &off);
+    cx = cx - 1 - off + char_boundary(ll->chunks[i].data, off);
+
+    int n;
+    if (cx == 0 || ll_width_at(ll, cx, &n) != 0) break;
+  }
+  return cx;
+}
@@ -1,108 +1,413 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include "logger.h"
+#include "mem.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
 #include <time.h>
-#include <sys/time.h>
+
+/*
+ * Log records are not written by the thread that produces them. Producers
+ * format the user message into a slot of a bounded lock-free MPSC ring
+ * (Vyukov's sequence-numbered queue) together with a monotonic timestamp;
+ * a background thread formats the headers, writes whole batches and
+ * flushes once per batch. No system call is made on the producer side
+ * unless the writer thread is asleep.
+ */
+
+// Number of slots in the ring (power of two)
+#define LOG_RING_SIZE     1024
+// Maximum length of a formatted user message (longer ones are truncated)
+#define LOG_MSG_MAX       256
+// The writer wakes up at least this often (ms)
+#define LOG_FLUSH_MS      100
+
+typedef struct {
+  atomic_size_t seq;      // Slot sequence number (see log_claim / log_pop)
+  log_level_e level;
+  const char *func;       // String literals, never copied
+  const char *file;
+  int line;
+  int64_t ts_ns;          // CLOCK_MONOTONIC
+  char msg[LOG_MSG_MAX];
+} log_slot_t;
 
 static FILE *g_log_fp = NULL;
-static log_level_e g_log_level = LOG_DEBUG;
+
+unsigned char zilo_log_levels[LOG_MODULE_COUNT] = {
+  LOG_OFF, LOG_OFF, LOG_OFF, LOG_OFF, LOG_OFF
+};
+
+// Level used by every module unless ZILO_LOG_LEVEL says otherwise
+#define LOG_DEFAULT_LEVEL LOG_DEBUG
+static log_overflow_e g_log_overflow = LOG_OVERFLOW_DROP;
+
+static log_slot_t g_ring[LOG_RING_SIZE];
+static atomic_size_t g_head;          // Next slot to claim (producers)
+static size_t g_tail;                 // Next slot to read (writer thread only)
+static atomic_size_t g_dropped;       // Records lost to a full ring
+
+static pthread_t g_writer;
+static bool g_writer_running = false;
+static atomic_bool g_stop;
+static atomic_bool g_writer_idle;     // The writer is (about to go) asleep
+static sem_t g_wakeup;
+
+// Wall clock at the monotonic origin, used to convert timestamps
+static int64_t g_mono_origin_ns;
+static time_t g_wall_origin_sec;
+static long g_wall_origin_ns;
 
 static const char *level_strings[] = {
-  "DEBUG", "INFO", "WARN", "ERROR"
+  "DEBUG", "INFO", "WARN", "ERROR", "OFF"
+};
+
+static const char *module_strings[] = {
+  "core", "render", "input", "file", "edit"
 };
 
+static int64_t monotonic_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*------------------------------------------
+                RING BUFFER
+ ------------------------------------------*/
+/**
+ * @brief Claim a free slot (any thread).
+ *
+ * A slot is free for position `pos` when its sequence number equals `pos`;
+ * it holds a record for the writer when the sequence number is `pos + 1`.
+ *
+ * @return Returns the claimed slot, or NULL if the ring is full.
+ */
+static log_slot_t *log_claim(size_t *pos_out) {
+  size_t pos = atomic_load_explicit(&g_head, memory_order_relaxed);
+
+  for (;;) {
+    log_slot_t *slot = &g_ring[pos & (LOG_RING_SIZE - 1)];
+    size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&g_head, &pos, pos + 1,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+        *pos_out = pos;
+        return slot;
+      }
+    } else if (diff < 0) {
+      return NULL;  // Full
+    } else {
+      pos = atomic_load_explicit(&g_head, memory_order_relaxed);
+    }
+  }
+}
+
+/**
+ * @brief Take the oldest record off the ring (writer thread only).
+ *
+ * @return Returns the slot, or NULL if the ring is empty. The slot must be
+ *         handed back with 'log_release()'.
+ */
+static log_slot_t *log_pop(void) {
+  log_slot_t *slot = &g_ring[g_tail & (LOG_RING_SIZE - 1)];
+  size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+  if (seq != g_tail + 1) return NULL;
+  return slot;
+}
+
+static void log_release(log_slot_t *slot) {
+  atomic_store_explicit(&slot->seq, g_tail + LOG_RING_SIZE, memory_order_release);
+  g_tail ++;
+}
+
+static void log_wake_writer(void) {
+  if (g_writer_running && atomic_exchange(&g_writer_idle, false)) sem_post(&g_wakeup);
+}
+
+/*------------------------------------------
+                WRITER THREAD
+ ------------------------------------------*/
+/**
+ * @brief Format one record's header and message into the log file.
+ *
+ * The local time string is cached for the current second.
+ */
+static void log_format(const log_slot_t *slot) {
+  static time_t cached_sec = -1;
+  static char time_buf[64];
+
+  int64_t ns = g_wall_origin_ns + (slot->ts_ns - g_mono_origin_ns);
+  time_t sec = g_wall_origin_sec + ns / 1000000000;
+  if (ns < 0) sec --;
+
+  if (sec != cached_sec) {
+    struct tm tm;
+    if (localtime_r(&sec, &tm) == NULL ||
+        strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", &tm) == 0) {
+      time_buf[0] = '\0';
+    }
+    cached_sec = sec;
+  }
+
+  // Format log header: [Time] [Level] File:Line -> <Func> -- Message
+  fprintf(g_log_fp, "[%s] [%-5s] %s:%d -> <%s> -- %s\n",
+          time_buf,
+          level_strings[slot->level],
+          slot->file,
+          slot->line,
+          slot->func,
+          slot->msg);
+}
+
+/**
+ * @brief Write every pending record, then flush once.
+ *
+ * @return Returns the number of records written.
+ */
+static int log_drain(void) {
+  int n = 0;
+  log_slot_t *slot;
+
+  while ((slot = log_pop())) {
+    if (g_log_fp) log_format(slot);
+    log_release(slot);
+    n ++;
+  }
+
+  size_t dropped = atomic_exchange(&g_dropped, 0);
+  if (dropped && g_log_fp) {
+    fprintf(g_log_fp, "[%-5s] %zu log records dropped (ring buffer full)\n",
+            level_strings[LOG_WARN], dropped);
+    n ++;
+  }
+
+  if (n > 0 && g_log_fp) fflush(g_log_fp);
+  return n;
+}
+
+static void *log_writer_main(void *arg) {
+  (void)arg;
+
+  while (!atomic_load(&g_stop)) {
+    if (log_drain() > 0) continue;
+
+    // Announce the nap, then re-check so a record pushed meanwhile is not missed
+    atomic_store(&g_writer_idle, true);
+    if (log_pop()) {
+      atomic_store(&g_writer_idle, false);
+      continue;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += LOG_FLUSH_MS * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec ++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+    while (sem_timedwait(&g_wakeup, &deadline) == -1 && errno == EINTR) {}
+    atomic_store(&g_writer_idle, false);
+  }
+
+  log_drain();
+  return NULL;
+}
+
+/*------------------------------------------
+                LEVELS
+ ------------------------------------------*/
+static int parse_level(const char *s, size_t len) {
+  for (int i = LOG_DEBUG; i <= LOG_OFF; ++ i) {
+    if (strlen(level_strings[i]) == len && !strncasecmp(s, level_strings[i], len)) return i;
+  }
+  return -1;
+}
+
+/**
+ * @brief Apply a level specification such as "info" or "warn,render=debug,file=off".
+ *
+ * A bare level applies to every module, `module=level` to one module.
+ * Unknown entries are ignored.
+ */
+static void log_parse_levels(const char *spec) {
+  while (*spec) {
+    size_t len = strcspn(spec, ",");
+    const char *eq = memchr(spec, '=', len);
+
+    if (!eq) {
+      int level = parse_level(spec, len);
+      if (level != -1) {
+        for (int m = 0; m < LOG_MODULE_COUNT; ++ m) zilo_log_levels[m] = level;
+      }
+    } else {
+      int level = parse_level(eq + 1, spec + len - eq - 1);
+      for (int m = 0; m < LOG_MODULE_COUNT && level != -1; ++ m) {
+        if (strlen(module_strings[m]) == (size_t)(eq - spec) &&
+            !strncmp(spec, module_strings[m], eq - spec)) {
+          zilo_log_levels[m] = level;
+        }
+      }
+    }
+
+    spec += len;
+    if (*spec == ',') spec ++;
+  }
+}
+
+/*------------------------------------------
+                PUBLIC API
+ ------------------------------------------*/
 /**
- * @brief Initialize the log system (open the log file).
+ * @brief Initialize the log system (open the log file and start the writer).
+ *
+ * Module levels are read from ZILO_LOG_LEVEL (e.g. "info,render=debug") and
+ * the overflow policy from ZILO_LOG_OVERFLOW=drop|block.
  *
  * @param filename File name/path.
  */
 void zilo_log_init(const char *filename) {
-  if (g_log_fp) fclose(g_log_fp);
+  if (g_log_fp) zilo_log_close();
 
   g_log_fp = fopen(filename, "a");
   if (!g_log_fp) {
     fprintf(stderr, "The log file <%s> failed to open.\n", filename);
     return;
   }
+
+  for (int m = 0; m < LOG_MODULE_COUNT; ++ m) zilo_log_levels[m] = LOG_DEFAULT_LEVEL;
+  const char *levels = getenv("ZILO_LOG_LEVEL");
+  if (levels) log_parse_levels(levels);
+
+  const char *overflow = getenv("ZILO_LOG_OVERFLOW");
+  if (overflow && !strcmp(overflow, "block")) g_log_overflow = LOG_OVERFLOW_BLOCK;
+
+  for (size_t i = 0; i < LOG_RING_SIZE; ++ i) atomic_init(&g_ring[i].seq, i);
+  zilo_mem_account(MEM_LOGGER, sizeof(g_ring));
+  atomic_init(&g_head, 0);
+  atomic_init(&g_dropped, 0);
+  atomic_init(&g_stop, false);
+  atomic_init(&g_writer_idle, false);
+  g_tail = 0;
+
+  struct timespec wall;
+  clock_gettime(CLOCK_REALTIME, &wall);
+  g_mono_origin_ns = monotonic_ns();
+  g_wall_origin_sec = wall.tv_sec;
+  g_wall_origin_ns = wall.tv_nsec;
+
+  if (sem_init(&g_wakeup, 0, 0) == -1) return;
+  if (pthread_create(&g_writer, NULL, log_writer_main, NULL) != 0) {
+    sem_destroy(&g_wakeup);
+    fprintf(stderr, "The log writer thread failed to start.\n");
+    return;
+  }
+  g_writer_running = true;
 }
 
 /**
- * @brief Close the log system.
+ * @brief Close the log system (flush pending records and stop the writer).
  */
 void zilo_log_close(void) {
+  for (int m = 0; m < LOG_MODULE_COUNT; ++ m) zilo_log_levels[m] = LOG_OFF;
+
+  if (g_writer_running) {
+    atomic_store(&g_stop, true);
+    sem_post(&g_wakeup);
+    pthread_join(g_writer, NULL);
+    sem_destroy(&g_wakeup);
+    g_writer_running = false;
+  } else {
+    log_drain();
+  }
+
   if (g_log_fp) {
     fclose(g_log_fp);
     g_log_fp = NULL;
+    zilo_mem_account(MEM_LOGGER, -(int64_t)sizeof(g_ring));
   }
 }
 
 /**
- * @brief Get the current time store to buffer.
- *
- * @param time_buf Buffer.
- * @param buf_size Buffer size.
+ * @brief Set the runtime level of one module.
  *
- * @return Returns 0 if success, otherwise returns -1.
+ * @param module Log module.
+ * @param level  Lowest level that is written (LOG_OFF disables the module).
  */
-static int get_current_time(char *time_buf, size_t buf_size) {
-  struct timeval tv;
-
-  // Get high-precision timestamp
-  if (gettimeofday(&tv, NULL) == -1) return -1;
-
-  // Time conversion
-  struct tm tm;
-  if (localtime_r(&tv.tv_sec, &tm) == NULL) return -1;
-
-  // Convert time structure to string
-  size_t len = strftime(time_buf, buf_size, 
-                "%Y-%m-%d %H:%M:%S", &tm);
-  if (len == 0) return -1;
+void zilo_log_set_level(log_module_e module, log_level_e level) {
+  if (module < 0 || module >= LOG_MODULE_COUNT) return;
+  zilo_log_levels[module] = level;
+}
 
-  return 0;
+/**
+ * @brief Choose what happens when the ring is full.
+ *
+ * @param policy LOG_OVERFLOW_DROP (count and discard) or LOG_OVERFLOW_BLOCK
+ *               (wait for the writer).
+ */
+void zilo_log_set_overflow(log_overflow_e policy) {
+  g_log_overflow = policy;
 }
 
 /**
  * @brief The core print function.
  *
+ * Only the user message is formatted here; the record is queued for the
+ * writer thread. The level filter is applied by the LOG_* macros.
+ *
  * @param level The log level.
  * @param func  The function that generated this log.
  * @param file  The file that generated this log.
  * @param line  The line that generated this log.
  * @param fmt   Additional output information.
  */
-void zilo_log_write(log_level_e level, 
+void zilo_log_write(log_level_e level,
                     const char *func,
-                    const char *file, 
-                    int line, 
+                    const char *file,
+                    int line,
                     const char *fmt, ...) {
   if (!g_log_fp) return;
-  if (level < g_log_level) return;
 
-  // Get the current time.
-  char time_buf[64];
-  if (get_current_time(time_buf, 64) == -1) return;
+  size_t pos;
+  log_slot_t *slot;
+  while (!(slot = log_claim(&pos))) {
+    // Blocking needs a writer to make room
+    if (g_log_overflow == LOG_OVERFLOW_DROP || !g_writer_running) {
+      atomic_fetch_add_explicit(&g_dropped, 1, memory_order_relaxed);
+      return;
+    }
+    log_wake_writer();
+    sched_yield();
+  }
 
-  // Format log header: [Time] [Level] File:Line -> <Func> --
-  fprintf(g_log_fp, "[%s] [%-5s] %s:%d -> <%s> -- ",
-          time_buf, 
-          level_strings[level],
-          file,
-          line,
-          func);
+  slot->level = level;
+  slot->func = func;
+  slot->file = file;
+  slot->line = line;
+  slot->ts_ns = monotonic_ns();
 
-  // Format user message
   va_list args;
   va_start(args, fmt);
-  vfprintf(g_log_fp, fmt, args);
+  vsnprintf(slot->msg, sizeof(slot->msg), fmt, args);
   va_end(args);
-  
-  // Newline and flush buffer
-  fprintf(g_log_fp, "\n");
-  fflush(g_log_fp);
-}
 
+  // Publish the record
+  atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
 
+  // Errors (often followed by an exit) and every half ring are written promptly
+  if (level >= LOG_ERROR || (pos & (LOG_RING_SIZE / 2 - 1)) == 0) log_wake_writer();
+}
@@ -0,0 +1,162 @@
+#include "lz.h"
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * A byte-oriented LZ77 codec in the spirit of LZ4: fast to decode, no
+ * entropy stage. The output is a list of sequences:
+ *
+ *   token   high nibble: literal count, low nibble: match length - 4
+ *           (15 in a nibble means "more bytes follow", each adding up to 255)
+ *   literals
+ *   offset  2 bytes, little endian (absent in the last sequence)
+ *
+ * The last sequence only carries literals. Matches are found through a
+ * single-entry hash table of 4-byte prefixes.
+ */
+
+#define LZ_MIN_MATCH   4
+#define LZ_HASH_BITS   12
+#define LZ_MAX_OFFSET  65535
+
+#define LZ_NIBBLE(n) ((n) < 15 ? (n) : 15)
+
+/**
+ * @brief Write a length that did not fit in its nibble (255, 255, ..., rest).
+ *
+ * @return Returns the new output position, -1 if `dst` is full.
+ */
+static int lz_put_length(char *dst, int cap, int o, int n) {
+  for (; n >= 255; n -= 255) {
+    if (o >= cap) return -1;
+    dst[o ++] = (char)255;
+  }
+  if (o >= cap) return -1;
+  dst[o ++] = (char)n;
+  return o;
+}
+
+/**
+ * @brief Emit one sequence: `lit` literals, then a match of `mlen` bytes at
+ *        distance `offset` (no match when `mlen` is 0).
+ *
+ * @return Returns the new output position, -1 if `dst` is full.
+ */
+static int lz_emit(char *dst, int cap, int o, const char *lits, int lit, int offset, int mlen) {
+  if (o >= cap) return -1;
+
+  int ml = mlen ? mlen - LZ_MIN_MATCH : 0;
+  dst[o ++] = (char)((LZ_NIBBLE(lit) << 4) | LZ_NIBBLE(ml));
+  if (lit >= 15 && (o = lz_put_length(dst, cap, o, lit - 15)) == -1) return -1;
+
+  if (o + lit > cap) return -1;
+  memcpy(dst + o, lits, lit);
+  o += lit;
+
+  if (mlen == 0) return o;
+
+  if (o + 2 > cap) return -1;
+  dst[o ++] = (char)(offset & 0xff);
+  dst[o ++] = (char)(offset >> 8);
+  if (ml >= 15 && (o = lz_put_length(dst, cap, o, ml - 15)) == -1) return -1;
+  return o;
+}
+
+/**
+ * @brief Compress `len` bytes of `src` into `dst`.
+ *
+ * @param cap Size of `dst` (LZ_BOUND(len) is always enough).
+ *
+ * @return Returns the compressed size, -1 if it does not fit in `cap`.
+ */
+int lz_compress(const char *src, int len, char *dst, int cap) {
+  const unsigned char *s = (const unsigned char *)src;
+  int table[1 << LZ_HASH_BITS];
+  memset(table, 0xff, sizeof(table));   // -1: no candidate
+
+  int anchor = 0;   // First byte not emitted yet
+  int o = 0;
+  int i = 0;
+  while (i + LZ_MIN_MATCH <= len) {
+    uint32_t seq, cand;
+    memcpy(&seq, s + i, 4);
+    uint32_t h = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+    int ref = table[h];
+    table[h] = i;
+
+    if (ref < 0 || i - ref > LZ_MAX_OFFSET || (memcpy(&cand, s + ref, 4), cand != seq)) {
+      i ++;
+      continue;
+    }
+
+    int mlen = LZ_MIN_MATCH;
+    while (i + mlen < len && s[ref + mlen] == s[i + mlen]) mlen ++;
+
+    o = lz_emit(dst, cap, o, src + anchor, i - anchor, i - ref, mlen);
+    if (o == -1) return -1;
+    i += mlen;
+    anchor = i;
+  }
+
+  return lz_emit(dst, cap, o, src + anchor, len - anchor, 0, 0);
+}
+
+/**
+ * @brief Read a length that did not fit in its nibble.
+ *
+ * @return Returns the new input position, -1 if the input ends early.
+ */
+static int lz_get_length(const unsigned char *s, int len, int i, int *n) {
+  int b;
+  do {
+    if (i >= len) return -1;
+    b = s[i ++];
+    *n += b;
+  } while (b == 255);
+  return i;
+}
+
+/**
+ * @brief Decompress `len` bytes of `src` into `dst`.
+ *
+ * Every length and offset is checked, so corrupt input cannot write or read
+ * out of bounds.
+ *
+ * @param cap Size of `dst`.
+ *
+ * @return Returns the decompressed size, -1 if the input is corrupt or too large.
+ */
+int lz_decompress(const char *src, int len, char *dst, int cap) {
+  const unsigned char *s = (const unsigned char *)src;
+  int i = 0;
+  int o = 0;
+
+  while (i < len) {
+    int token = s[i ++];
+
+    int lit = token >> 4;
+    if (lit == 15 && (i = lz_get_length(s, len, i, &lit)) == -1) return -1;
+    if (lit > len - i || lit > cap - o) return -1;
+    memcpy(dst + o, src + i, lit);
+    i += lit;
+    o += lit;
+
+    if (i == len) break;   // Last sequence: literals only
+
+    if (len - i < 2) return -1;
+    int offset = s[i] | (s[i + 1] << 8);
+    i += 2;
+    int mlen = token & 15;
+    if (mlen == 15 && (i = lz_get_length(s, len, i, &mlen)) == -1) return -1;
+    mlen += LZ_MIN_MATCH;
+    if (offset == 0 || offset > o || mlen > cap - o) return -1;
+
+    // Byte by byte: the match may overlap the bytes it produces
+    char *d = dst + o;
+    const char *m = d - offset;
+    for (int k = 0; k < mlen; ++ k) d[k] = m[k];
+    o += mlen;
+  }
+
+  return o;
+}
@@ -1,101 +1,155 @@
+#include "cold.h"
+#include "daemon.h"
 #include "input.h"
 #include "logger.h"
 #include "output.h"
+#include "pool.h"
 #include "zilo.h"
 #include "terminal.h"
 #include "file.h"
+#include "follow.h"
+#include "hex.h"
+#include "replay.h"
+#include "script.h"
+#include "stream.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
 #include <unistd.h>
 
-editor_config_t E;
-
-/**
- * @brief Initialize editor state.
- */
-void init_editor(void) {
-  E.cx = 0;
-  E.cy = 0;
-
-  if (get_window_size(&E.screenrows, &E.screencols) == -1) 
-    LOG_WARN("get_window_size", "Unable to obtain terminal size, default value used.");
-
-  E.rowoff = 0;
-  E.coloff = 0;
-
-  E.numrows = 0;
-  E.row = NULL;
-
-  E.filename = NULL;
-  E.mode = MODE_NORMAL;
-
-  E.pending_key = 0;
-
-  E.select_cx = -1;
-  E.select_cy = -1;
-
-  editor_set_status_message("Welcome to Zilo.");
-}
+// Main logic
+int main(int argc, char *argv[]) {
+  // Headless batch mode: zilo --script keys.txt file...
+  if (argc >= 4 && !strcmp(argv[1], "--script")) {
+    return editor_run_script(argv[2], argv + 3, argc - 3) ? 1 : 0;
+  }
 
-/**
- * @brief Free editor memory resources.
- */
-void free_editor(void) {
-  free(E.filename);
+  // Replay a recorded key trace: zilo --replay[-timed] trace.keys file
+  if (argc == 4 && (!strcmp(argv[1], "--replay") || !strcmp(argv[1], "--replay-timed"))) {
+    return editor_replay(argv[2], argv[3], !strcmp(argv[1], "--replay-timed"));
+  }
 
-  for (int i = 0; i < E.numrows; ++ i) {
-    erow_t *row = &E.row[i];
-    free(row->chars);
+  // Keep buffers loaded for clients: zilo --daemon
+  if (argc == 2 && !strcmp(argv[1], "--daemon")) {
+    return editor_daemon_run();
   }
 
-  free(E.row);
-}
+  // Record the keys of this session: zilo --record trace.keys file
+  const char *record = NULL;
+  if (argc == 4 && !strcmp(argv[1], "--record")) {
+    record = argv[2];
+    argv += 2;
+    argc -= 2;
+  }
 
-/**
- * @brief The cleanup function before program exit.
- *
- * This function is registered with 'atexit()' and does not need to be called manually.
- */
-void editor_cleanup(void) {
-  // Restore the cursor shape to a block
-  set_cursor_shape_block();
+  // Share the bytes of identical rows: zilo --intern file
+  bool intern = false;
+  if (argc >= 3 && !strcmp(argv[1], "--intern")) {
+    intern = true;
+    argv ++;
+    argc --;
+  }
 
-  // Restore terminal properties
-  disable_raw_mode();
+  // Compress rows far from the view beyond a memory budget: zilo --compress MiB file
+  long long compress = 0;
+  if (argc >= 4 && !strcmp(argv[1], "--compress")) {
+    compress = atoll(argv[2]);
+    argv += 2;
+    argc -= 2;
+  }
 
-  // Free heap memory
-  free_editor();
+  // Keep the text of a large file out of memory: zilo --page MiB file (as
+  // --compress, and whole pages of rows and blocks may be dropped to the
+  // file itself or to a temp file, see page.c and cold.c)
+  bool page = false;
+  if (compress == 0 && argc >= 4 && !strcmp(argv[1], "--page")) {
+    compress = atoll(argv[2]);
+    page = compress > 0;
+    argv += 2;
+    argc -= 2;
+  }
 
-  // Clean terminal
-  write(STDOUT_FILENO, ANSI_CLEAR_SCREEN, strlen(ANSI_CLEAR_SCREEN));
-  write(STDOUT_FILENO, ANSI_CURSOR_HOME, strlen(ANSI_CURSOR_HOME));
+  // Follow a growing file: zilo --follow file
+  bool follow = false;
+  if (argc == 3 && !strcmp(argv[1], "--follow")) {
+    follow = true;
+    argv ++;
+    argc --;
+  }
 
-  // Close the log system
-  LOG_INFO("", "Zilo editor exited safely.");
-  zilo_log_close();
-}
+  // Inspect a file as bytes: zilo --hex file (mapped, never read into rows)
+  bool hex = false;
+  if (argc == 3 && !strcmp(argv[1], "--hex")) {
+    hex = true;
+    argv ++;
+    argc --;
+  }
 
-// Main logic
-int main(int argc, char *argv[]) {
   if (argc != 2) {
-    fprintf(stderr, "usage: zilo <filenname>\n");
+    fprintf(stderr, "usage: zilo [--record <trace.keys>] [--intern] [--compress <MiB> | --page <MiB>] [--follow] <filenname | ->\n");
+    fprintf(stderr, "       zilo --hex <file>\n");
+    fprintf(stderr, "       zilo --script <keys.txt> <file>...\n");
+    fprintf(stderr, "       zilo --replay|--replay-timed <trace.keys> <file>\n");
+    fprintf(stderr, "       zilo --daemon\n");
     fprintf(stderr, "If the file does not exist, a new file will be created.\n");
+    fprintf(stderr, "With -, the text is read from stdin as it arrives (save it with :w <file>).\n");
     return 1;
   }
 
   zilo_log_init("zilo.log");
   LOG_INFO("main", "Zilo editor started.");
+  zilo_trace_init();
 
   char *filenmae = argv[1];
 
+  // Text from a pipe: zilo - (keys come from the terminal instead)
+  int input = -1;
+  if (!strcmp(filenmae, "-")) {
+    int tty = open("/dev/tty", O_RDWR);
+    input = dup(STDIN_FILENO);
+    if (tty == -1 || input == -1 || dup2(tty, STDIN_FILENO) == -1) {
+      fprintf(stderr, "zilo: reading stdin needs a terminal (/dev/tty) for the keys.\n");
+      return 1;
+    }
+    close(tty);
+  }
+
+  if (hex && access(filenmae, R_OK) == -1) {
+    fprintf(stderr, "zilo: cannot read <%s>\n", filenmae);
+    return 1;
+  }
+
+  // With a daemon running (zilo --daemon), it edits the file and this
+  // process is only the terminal
+  if (input == -1 && !hex && !record && !intern && compress == 0 && !follow && editor_client_run(filenmae) == 0) {
+    return 0;
+  }
+
   enable_raw_mode();
   init_editor();
-  editor_open(filenmae);
+  if (record) editor_record_start(record);
+  E.intern = intern;
+  if (compress > 0) editor_cold_set_budget(compress * 1024 * 1024);
+  editor_page_enable(page);
+  if (hex) {
+    if (editor_hex_open(filenmae) == -1) editor_set_status_message("Cannot map <%s>", filenmae);
+  }
+  else if (input == -1) editor_open(filenmae);
+  else if (editor_stream_start(input) == -1) editor_set_status_message("Cannot read stdin");
+  if (follow && editor_follow_start() == 0) E.cy = E.numrows > 0 ? E.numrows - 1 : 0;
 
   while (1) {
     editor_refresh_screen();
-    editor_process_keypress();
+
+    // Keys, background job results, a followed file and stdin all wake the loop
+    int fds[] = { pool_wake_fd(), editor_follow_fd(), editor_stream_fd() };
+    if (editor_wait_input(fds, 3)) editor_process_keypress();
+    pool_dispatch();
+    editor_follow_poll();
+    editor_stream_poll();
+    editor_cold_sweep();
   }
   
   return 0;
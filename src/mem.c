@@ -0,0 +1,239 @@
+#include "mem.h"
+#include "logger.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Every block starts with a small header holding its size and tag, so the
+ * live byte count can be updated on free and realloc. The header is 16
+ * bytes to keep the user pointer aligned like malloc's. Counters are
+ * relaxed atomics since workers and the log writer may allocate too.
+ */
+
+#define MEM_MAGIC 0x5a696c6fu   // "Zilo"
+
+typedef struct {
+  size_t size;
+  uint32_t tag;
+  uint32_t magic;
+} mem_header_t;
+
+_Static_assert(sizeof(mem_header_t) == 16, "The header must keep 16-byte alignment");
+
+typedef struct {
+  atomic_llong live;
+  atomic_llong peak;
+  atomic_llong allocs;
+  atomic_llong reallocs;
+  atomic_llong frees;
+  atomic_llong failures;
+} mem_counters_t;
+
+static mem_counters_t g_mem[MEM_TAG_COUNT];
+
+static const char *tag_strings[] = {
+  "rows", "row array", "render", "frame", "syntax", "wrap", "file",
+  "logger", "pool", "snapshot", "undo", "search", "intern", "cold"
+};
+
+static void mem_add_live(mem_tag_e tag, int64_t delta) {
+  long long live = atomic_fetch_add_explicit(&g_mem[tag].live, delta, memory_order_relaxed) + delta;
+
+  long long peak = atomic_load_explicit(&g_mem[tag].peak, memory_order_relaxed);
+  while (live > peak &&
+         !atomic_compare_exchange_weak_explicit(&g_mem[tag].peak, &peak, live,
+                                                memory_order_relaxed, memory_order_relaxed)) {}
+}
+
+static void mem_count(atomic_llong *counter) {
+  atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+}
+
+static mem_header_t *mem_header(void *ptr) {
+  mem_header_t *h = (mem_header_t *)ptr - 1;
+  if (h->magic != MEM_MAGIC) {
+    LOG_ERROR("zilo_free", "Pointer %p was not allocated by zilo_malloc.", ptr);
+    abort();
+  }
+  return h;
+}
+
+/**
+ * @brief Tagged malloc.
+ *
+ * @param tag  Subsystem.
+ * @param size Bytes.
+ */
+void *zilo_malloc(mem_tag_e tag, size_t size) {
+  mem_count(&g_mem[tag].allocs);
+
+  mem_header_t *h = malloc(sizeof(mem_header_t) + size);
+  if (!h) {
+    mem_count(&g_mem[tag].failures);
+    return NULL;
+  }
+
+  h->size = size;
+  h->tag = tag;
+  h->magic = MEM_MAGIC;
+  mem_add_live(tag, size);
+  return h + 1;
+}
+
+/**
+ * @brief Tagged calloc.
+ */
+void *zilo_calloc(mem_tag_e tag, size_t n, size_t size) {
+  if (size && n > (SIZE_MAX - sizeof(mem_header_t)) / size) {
+    mem_count(&g_mem[tag].failures);
+    return NULL;
+  }
+
+  void *ptr = zilo_malloc(tag, n * size);
+  if (ptr) memset(ptr, 0, n * size);
+  return ptr;
+}
+
+/**
+ * @brief Tagged realloc.
+ *
+ * Unlike a bare `p = realloc(p, n)`, a failure leaves the old block valid
+ * and owned by the caller: NULL is returned and `ptr` must be kept.
+ *
+ * @param tag  Subsystem (must match the one used to allocate `ptr`).
+ * @param ptr  Block (NULL allocates a new one).
+ * @param size New size in bytes.
+ */
+void *zilo_realloc(mem_tag_e tag, void *ptr, size_t size) {
+  if (!ptr) return zilo_malloc(tag, size);
+
+  mem_count(&g_mem[tag].reallocs);
+
+  mem_header_t *old = mem_header(ptr);
+  size_t old_size = old->size;
+
+  mem_header_t *h = realloc(old, sizeof(mem_header_t) + size);
+  if (!h) {
+    mem_count(&g_mem[tag].failures);
+    return NULL;
+  }
+
+  h->size = size;
+  mem_add_live(tag, (int64_t)size - (int64_t)old_size);
+  return h + 1;
+}
+
+/**
+ * @brief Tagged strdup.
+ */
+char *zilo_strdup(mem_tag_e tag, const char *s) {
+  size_t len = strlen(s) + 1;
+  char *copy = zilo_malloc(tag, len);
+  if (copy) memcpy(copy, s, len);
+  return copy;
+}
+
+/**
+ * @brief Free memory from the zilo_* allocators (NULL is allowed).
+ */
+void zilo_free(mem_tag_e tag, void *ptr) {
+  if (!ptr) return;
+
+  mem_header_t *h = mem_header(ptr);
+  mem_count(&g_mem[tag].frees);
+  mem_add_live(h->tag, -(int64_t)h->size);
+
+  h->magic = 0;
+  free(h);
+}
+
+/**
+ * @brief Account memory that is not allocated through the wrappers.
+ *
+ * @param tag   Subsystem.
+ * @param delta Bytes added (or removed if negative).
+ */
+void zilo_mem_account(mem_tag_e tag, int64_t delta) {
+  mem_add_live(tag, delta);
+}
+
+/**
+ * @brief Snapshot the counters of one tag.
+ */
+void zilo_mem_stats(mem_tag_e tag, mem_stats_t *out) {
+  mem_counters_t *c = &g_mem[tag];
+  out->live = atomic_load_explicit(&c->live, memory_order_relaxed);
+  out->peak = atomic_load_explicit(&c->peak, memory_order_relaxed);
+  out->allocs = atomic_load_explicit(&c->allocs, memory_order_relaxed);
+  out->reallocs = atomic_load_explicit(&c->reallocs, memory_order_relaxed);
+  out->frees = atomic_load_explicit(&c->frees, memory_order_relaxed);
+  out->failures = atomic_load_explicit(&c->failures, memory_order_relaxed);
+}
+
+/**
+ * @brief Print a byte count with a unit ("512B", "3.2K", "1.5M", "2.0G").
+ */
+static void format_bytes(char *buf, int size, int64_t bytes) {
+  const char *units = "BKMG";
+  double v = bytes;
+  int u = 0;
+  while (v >= 1024 && u < 3) {
+    v /= 1024;
+    u ++;
+  }
+  if (u == 0) snprintf(buf, size, "%lldB", (long long)bytes);
+  else snprintf(buf, size, "%.1f%c", v, units[u]);
+}
+
+/**
+ * @brief Format the total live and peak memory for the status bar.
+ *
+ * The total peak is the sum of per-tag peaks (an upper bound).
+ */
+int zilo_mem_status(char *buf, int size) {
+  int64_t live = 0, peak = 0;
+  for (int t = 0; t < MEM_TAG_COUNT; ++ t) {
+    mem_stats_t s;
+    zilo_mem_stats(t, &s);
+    live += s.live;
+    peak += s.peak;
+  }
+
+  char live_buf[16], peak_buf[16];
+  format_bytes(live_buf, sizeof(live_buf), live);
+  format_bytes(peak_buf, sizeof(peak_buf), peak);
+  return snprintf(buf, size, "mem %s peak %s", live_buf, peak_buf);
+}
+
+/**
+ * @brief Allocations of every tag so far (reallocs included: they may move
+ *        the block). The difference of two calls counts what happened in
+ *        between, on workers as well.
+ */
+int64_t zilo_mem_allocs(void) {
+  int64_t n = 0;
+  for (int t = 0; t < MEM_TAG_COUNT; ++ t) {
+    n += atomic_load_explicit(&g_mem[t].allocs, memory_order_relaxed);
+    n += atomic_load_explicit(&g_mem[t].reallocs, memory_order_relaxed);
+  }
+  return n;
+}
+
+/**
+ * @brief Write the per-subsystem memory report to the log.
+ */
+void zilo_mem_report(void) {
+  for (int t = 0; t < MEM_TAG_COUNT; ++ t) {
+    mem_stats_t s;
+    zilo_mem_stats(t, &s);
+    if (!s.allocs && !s.live) continue;
+
+    LOG_INFO("zilo_mem_report",
+             "%-9s live=%lld peak=%lld allocs=%lld reallocs=%lld frees=%lld failures=%lld",
+             tag_strings[t],
+             (long long)s.live, (long long)s.peak, (long long)s.allocs,
+             (long long)s.reallocs, (long long)s.frees, (long long)s.failures);
+  }
+}
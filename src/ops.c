@@ -1,5 +1,7 @@
+#define ZILO_LOG_MODULE LOG_MODULE_EDIT
 #include "ops.h"
 #include "file.h"
+#include "page.h"
 #include "row.h"
 #include "zilo.h"
 #include "edit.h"
@@ -7,6 +9,11 @@
 
 // q
 void editor_op_exit(void) {
+  // A script stops here instead of killing the process
+  if (E.headless) {
+    E.quit = true;
+    return;
+  }
   exit(1);
 }
 
@@ -25,10 +32,11 @@ void editor_op_return_bol(void) {
 // $
 void editor_op_return_eol(void) {
   // Get the current row object
-  if (E.cy < 0 || E.cy >= E.numrows) return;
-  erow_t *row = &E.row[E.cy];
+  erow_t *row = editor_row_at(E.cy);
+  if (!row) return;
 
-  E.cx = row->size - 1;
+  // Land on the first byte of the last character (UTF-8 aware)
+  E.cx = editor_row_prev_char(row, row->size);
 }
 
 // dd
@@ -55,9 +63,9 @@ void editor_op_goto_top(void) {
   if (E.pending_key == 'g') {
     E.cy = 0;
 
-    erow_t *row = &E.row[0];
+    erow_t *row = editor_row_at(0);
 
-    if (E.cx > row->size) E.cx = row->size;
+    if (row && E.cx > row->size) E.cx = row->size;
 
     E.pending_key = 0;
   }
@@ -67,9 +75,9 @@ void editor_op_goto_top(void) {
 void editor_op_goto_bottom(void) {
   E.cy = E.numrows - 1;
 
-  erow_t *row = &E.row[E.numrows - 1];
+  erow_t *row = editor_row_at(E.numrows - 1);
 
-  if (E.cx > row->size) E.cx = row->size;
+  if (row && E.cx > row->size) E.cx = row->size;
 }
 
 // x
@@ -94,9 +102,8 @@ void editor_op_open_above(void) {
 
 // A
 void editor_op_append_eol(void) {
-  if (E.cy >= E.numrows) return;
-  
-  erow_t *row = &E.row[E.cy];
+  erow_t *row = editor_row_at(E.cy);
+  if (!row) return;
 
   E.cx = row->size;
   E.mode = MODE_INSERT;
@@ -144,7 +151,7 @@ void editor_op_delete_visual_line(void) {
   if (E.cy >= E.numrows) E.cy = E.numrows - 1;
   if (E.cy < 0) E.cy = 0;
 
-  erow_t *row = (E.cy < E.numrows) ? &E.row[E.cy] : NULL;
+  erow_t *row = editor_row_at(E.cy);
   int sz = row ? row->size : 0;
   if (E.cx > sz) E.cx = sz;
 }
@@ -157,7 +164,7 @@ void editor_op_delete_visual_block(void) {
   int end_x = MAX(E.select_cx, E.cx);
 
   for (int i = end_y; i >= start_y; -- i) {
-    erow_t *row = &E.row[i];
+    erow_t *row = editor_row_at(i);
     int len_to_delete = end_x - start_x + 1;
     editor_row_remove_range(row, start_x, len_to_delete);
   }
@@ -169,7 +176,7 @@ void editor_op_delete_visual_block(void) {
   if (E.cy >= E.numrows) E.cy = E.numrows - 1;
   if (E.cy < 0) E.cy = 0;
 
-  erow_t *row = (E.cy < E.numrows) ? &E.row[E.cy] : NULL;
+  erow_t *row = editor_row_at(E.cy);
   int sz = row ? row->size : 0;
   if (E.cx > sz) E.cx = sz;
 }
@@ -194,9 +201,9 @@ void editor_op_delete_visual(void) {
   // Case A: Single row deletion
   // Delete [start_x, end_x]
   if (start_y == end_y) {
-    erow_t *row = &E.row[start_y];
+    erow_t *row = editor_row_at(start_y);
     int len_to_delete = end_x - start_x + 1;
-    if (len_to_delete == row->size) {
+    if (row && len_to_delete == row->size) {
       editor_del_row(start_y);
     } else {
       editor_row_remove_range(row, start_x, len_to_delete);
@@ -204,23 +211,20 @@ void editor_op_delete_visual(void) {
   } 
   // Case B: Deleting multiple lines
   else {
-    erow_t *start_row = &E.row[start_y];
-    erow_t *end_row = &E.row[end_y];
+    erow_t *start_row = editor_row_at(start_y);
+    erow_t *end_row = editor_row_at(end_y);
 
     // 1. Calculate the "tail" (the content after end_x) that needs 
     // to be retained in the last line.
     // Note that `end_x` must be checked to ensure it is the end of the line. 
     // If it is, the tail length is 0.
-    char *tail = end_row->chars + end_x + 1;
-    int tail_len = end_x == end_row->size - 1 
-                   ? 0 
-                   : end_row->size - end_x - 1;
+    int tail_from = end_x + 1;
 
     // 2. Truncate the first line to `start_x`
-    start_row->size = start_x;
+    if (start_row) editor_row_remove_range(start_row, start_x, start_row->size - start_x);
 
     // 3. Add "tail" to the end of the first line
-    editor_row_append_string(start_row, tail, tail_len);
+    editor_row_append_row(start_row, end_row, tail_from);
 
     // 4. Starting from `start_y + 1`, delete all subsequent lines involving this value
     for (int i = end_y; i >= start_y + 1; -- i) {
@@ -235,7 +239,7 @@ void editor_op_delete_visual(void) {
   if (E.cy >= E.numrows) E.cy = E.numrows - 1;
   if (E.cy < 0) E.cy = 0;
 
-  erow_t *row = (E.cy < E.numrows) ? &E.row[E.cy] : NULL;
+  erow_t *row = editor_row_at(E.cy);
   int sz = row ? row->size : 0;
   if (E.cx > sz) E.cx = sz;
 }
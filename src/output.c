@@ -1,8 +1,23 @@
 #define _POSIX_C_SOURCE 200809L
+#define ZILO_LOG_MODULE LOG_MODULE_RENDER
 
 #include "output.h"
+#include "buffer.h"
+#include "file.h"
+#include "follow.h"
+#include "hex.h"
+#include "lline.h"
 #include "logger.h"
+#include "mem.h"
+#include "page.h"
+#include "row.h"
+#include "stats.h"
+#include "stream.h"
+#include "syntax.h"
 #include "terminal.h"
+#include "trace.h"
+#include "utf8.h"
+#include "wrap.h"
 #include "zilo.h"
 #include <stddef.h>
 #include <stdio.h>
@@ -21,8 +36,20 @@ static const char *editor_mode_strings[] = {
   "VISUAL",
   "L-VISUAL",
   "B-VISUAL",
+  "COMMAND",
 };
 
+// Cursor position on the screen (0-based), computed by 'editor_scroll()'
+static int g_screen_cy = 0;
+static int g_screen_cx = 0;
+
+// Window being drawn (see buffer.h)
+static int g_drawing_window = 0;
+
+// Where frames go instead of standard output (a client of the daemon)
+static editor_frame_sink_t g_out_sink = NULL;
+static void *g_out_arg = NULL;
+
 typedef struct abuf {
   char *buf;
   int len;
@@ -37,7 +64,7 @@ typedef struct abuf {
  */
 static void ab_append(abuf_t *ab, const char *s, int len) {
   // Request a larger memory block
-  char *new = realloc(ab->buf, ab->len + len);
+  char *new = zilo_realloc(MEM_FRAME, ab->buf, ab->len + len);
   if (!new) return;
 
   // Copy the new string `s` to the end of the old data
@@ -56,13 +83,41 @@ static void ab_append(abuf_t *ab, const char *s, int len) {
 static void ab_free(abuf_t *ab) {
   if (!ab) return;
 
-  free(ab->buf);
+  zilo_free(MEM_FRAME, ab->buf);
 }
 
 /**
  * @brief Implement screen scrolling.
  */
 static void editor_scroll(void) {
+  // Horizontal math works on render columns (tabs and control bytes are wider)
+  E.rx = 0;
+  erow_t *cur = editor_row_at(E.cy);
+  if (cur) E.rx = editor_row_cx_to_rx(cur, E.cx);
+
+  if (E.wrap) {
+    // Soft-wrap: scroll by visual lines, mapped through the wrap index
+    int seg = 0;
+    int sub = 0;
+    if (cur) sub = editor_wrap_segment_of(cur, E.cx, &seg);
+    int line = editor_wrap_row_to_line(E.cy) + sub;
+
+    if (line < E.lineoff) {
+      E.lineoff = line;
+    }
+    if (line >= E.lineoff + E.screenrows) {
+      E.lineoff = line - E.screenrows + 1;
+    }
+
+    E.coloff = 0;
+    E.rowoff = editor_wrap_line_to_row(E.lineoff, NULL);
+
+    g_screen_cy = line - E.lineoff;
+    g_screen_cx = E.rx;
+    if (cur) g_screen_cx -= editor_wrap_segment_col(cur, sub, seg);
+    return;
+  }
+
   // Scroll up: If the cursor is above the viewport
   if (E.cy < E.rowoff) {
     E.rowoff = E.cy;
@@ -74,14 +129,17 @@ static void editor_scroll(void) {
   }
 
   // Scroll left: If the cursor is left the viewport
-  if (E.cx < E.coloff) {
-    E.coloff = E.cx;
+  if (E.rx < E.coloff) {
+    E.coloff = E.rx;
   }
 
   // Scroll right: If the cursor is right the viewport
-  if (E.cx >= E.coloff + E.screencols) {
-    E.coloff = E.cx - E.screencols + 1;
+  if (E.rx >= E.coloff + E.screencols) {
+    E.coloff = E.rx - E.screencols + 1;
   }
+
+  g_screen_cy = E.cy - E.rowoff;
+  g_screen_cx = E.rx - E.coloff;
 }
 
 /**
@@ -110,7 +168,7 @@ static void editor_draw_message_bar(abuf_t *ab) {
   if (E.statusmsg[0] == '\0') return;
 
   // Calculation display position: last line
-  int msg_row = E.screenrows;
+  int msg_row = editor_window_screen_rows();
 
   // Move the cursor to the specified row, column 1
   char buf[32];
@@ -139,6 +197,25 @@ static void editor_draw_message_bar(abuf_t *ab) {
   ab_append(ab, ANSI_RESET, strlen(ANSI_RESET));
 }
 
+/**
+ * @brief Draw the command line being typed (MODE_COMMAND) over the last row.
+ */
+static void editor_draw_command_line(abuf_t *ab) {
+  int rows = editor_window_screen_rows();
+  char buf[32];
+  snprintf(buf, sizeof(buf), "\x1b[%d;%dH", rows, 1);
+  ab_append(ab, buf, strlen(buf));
+
+  // Keep the end of a long command visible
+  int len = MIN(E.cmdlen, E.screencols - 2);
+  ab_append(ab, ":", 1);
+  ab_append(ab, E.cmdbuf + E.cmdlen - len, len);
+  ab_append(ab, ANSI_CLEAR_LINE, strlen(ANSI_CLEAR_LINE));
+
+  g_screen_cy = rows - 1;
+  g_screen_cx = len + 1;
+}
+
 /**
  * @brief Draw a status bar at the bottom.
  */
@@ -147,8 +224,10 @@ static void editor_draw_status_bar(abuf_t *ab) {
 
   // Construct the string on the left (filename, line number)
   char lstatus_buf[80];
-  int lstatus_len = snprintf(lstatus_buf, sizeof(lstatus_buf), "%.20s - %d lines",
-    E.filename ? E.filename : "[No Name]", E.numrows);
+  int lstatus_len = snprintf(lstatus_buf, sizeof(lstatus_buf), "%.20s - %d lines%s%s",
+    E.filename ? E.filename : "[No Name]", E.numrows,
+    editor_file_modified() ? " [+]" : "",
+    editor_follow_active() ? " [follow]" : editor_stream_active() ? " [reading]" : "");
 
   if ((unsigned int)lstatus_len > sizeof(lstatus_buf) - 1) {
     lstatus_len = sizeof(lstatus_buf) - 1;
@@ -165,10 +244,30 @@ static void editor_draw_status_bar(abuf_t *ab) {
   struct tm tm_now;               
   localtime_r(&now, &tm_now); // Convert `time_t` into a human time structure `struct tm`
 
-  int rstatus_len = snprintf(rstatus_buf, sizeof(rstatus_buf), "%s | %d/%d | %02d:%02d",
-    editor_mode_strings[E.mode], 
-    E.cy + 1, E.numrows,
-    tm_now.tm_hour, tm_now.tm_min);
+  int rstatus_len;
+  if (E.show_stats) {
+    // Keystroke-to-frame latency instead of the clock
+    char stats_buf[64];
+    editor_stats_status(stats_buf, sizeof(stats_buf));
+    rstatus_len = snprintf(rstatus_buf, sizeof(rstatus_buf), "%s | %d/%d | %s",
+      editor_mode_strings[E.mode],
+      E.cy + 1, E.numrows,
+      stats_buf);
+  } else if (E.show_mem) {
+    // Live and peak heap usage instead of the clock
+    char mem_buf[48];
+    zilo_mem_status(mem_buf, sizeof(mem_buf));
+    rstatus_len = snprintf(rstatus_buf, sizeof(rstatus_buf), "%s | %d/%d | %s",
+      editor_mode_strings[E.mode],
+      E.cy + 1, E.numrows,
+      mem_buf);
+  } else {
+    rstatus_len = snprintf(rstatus_buf, sizeof(rstatus_buf), "%s | %s | %d/%d | %02d:%02d",
+      E.syntax ? E.syntax->filetype : "no ft",
+      editor_mode_strings[E.mode], 
+      E.cy + 1, E.numrows,
+      tm_now.tm_hour, tm_now.tm_min);
+  }
 
   if ((unsigned int)rstatus_len > sizeof(rstatus_buf) - 1) {
     rstatus_len = sizeof(rstatus_buf) - 1;
@@ -201,141 +300,434 @@ static bool is_in_visual_mode(void) {
 }
 
 /**
- * @brief Draw the logic for each row (tilde ~).
+ * @brief Switch the foreground color if it differs from the current one.
+ *
+ * @param ab        Buffer.
+ * @param cur_color The color currently in effect (updated).
+ * @param color     The wanted color.
+ */
+static void ab_set_color(abuf_t *ab, int *cur_color, int color) {
+  if (*cur_color == color) return;
+
+  char buf[16];
+  int len = snprintf(buf, sizeof(buf), ANSI_COLOR_FMT, color);
+  ab_append(ab, buf, len);
+  *cur_color = color;
+}
+
+/**
+ * @brief Append `n` blanks to the buffer.
  *
  * @param ab Buffer.
+ * @param n  Number of blanks.
  */
-static void editor_draw_rows(abuf_t *ab) {
+static void ab_append_spaces(abuf_t *ab, int n) {
+  static const char spaces[] = "                ";
+  while (n > 0) {
+    int len = MIN(n, (int)sizeof(spaces) - 1);
+    ab_append(ab, spaces, len);
+    n -= len;
+  }
+}
+
+/**
+ * @brief Draw the bytes [cx, to) of a long row.
+ *
+ * Long rows have no render cache and no highlighting: only the visible bytes
+ * are read from the chunks and rendered on the fly (a tab is ZILO_TAB_STOP
+ * blanks, see lline.h).
+ *
+ * @param ab        Buffer.
+ * @param row       Row object (chunked).
+ * @param cx        First byte to draw.
+ * @param to        End byte (exclusive).
+ * @param sel_start Start of the selected range in bytes (-1 if nothing is selected).
+ * @param sel_end   End of the selected range in bytes (exclusive).
+ */
+static void editor_draw_long_row_bytes(abuf_t *ab, erow_t *row, int cx, int to, int sel_start, int sel_end) {
+  int len = to - cx;
+  if (len <= 0) return;
+
+  char *buf = zilo_malloc(MEM_FRAME, len);
+  if (!buf) {
+    LOG_ERROR("malloc", "Failed to allocate memory.");
+    return;
+  }
+  editor_row_read(row, cx, len, buf);
+
+  bool cur_sel = false;
+  for (int j = 0; j < len; ) {
+    bool sel = sel_start != -1 && cx + j >= sel_start && cx + j < sel_end;
+    if (sel != cur_sel) {
+      if (sel) ab_append(ab, ANSI_REVERSE_DISPLAY, strlen(ANSI_REVERSE_DISPLAY));
+      else ab_append(ab, ANSI_RESET, strlen(ANSI_RESET));
+      cur_sel = sel;
+    }
+
+    unsigned char c = buf[j];
+    int n;
+    int width = lline_char_width(buf + j, len - j, &n);
+    if (c == '\t') {
+      ab_append_spaces(ab, width);
+    } else if (c < 32 || c == 127) {
+      char ctrl[2] = { '^', c == 127 ? '?' : c + '@' };
+      ab_append(ab, ctrl, 2);
+    } else if (c >= 0x80 && n == 1) {
+      ab_append(ab, UTF8_REPLACEMENT_BYTES, sizeof(UTF8_REPLACEMENT_BYTES) - 1);
+    } else {
+      ab_append(ab, buf + j, n);
+    }
+    j += n;
+  }
+
+  if (cur_sel) ab_append(ab, ANSI_RESET, strlen(ANSI_RESET));
+  zilo_free(MEM_FRAME, buf);
+}
+
+/**
+ * @brief Draw the bytes [cx, to) of a row with their highlighting.
+ *
+ * Highlight spans and the visual selection are merged into runs, and an
+ * escape sequence is only emitted where the attributes change.
+ *
+ * @param ab        Buffer.
+ * @param row       Row object.
+ * @param cx        First byte (start of a character).
+ * @param to        End byte (start of a character, exclusive).
+ * @param sel_start Start of the selected range in bytes (-1 if nothing is selected).
+ * @param sel_end   End of the selected range in bytes (exclusive).
+ */
+static void editor_draw_row_bytes(abuf_t *ab, erow_t *row, int cx, int to, int sel_start, int sel_end) {
+  if (row->ll) {
+    editor_draw_long_row_bytes(ab, row, cx, to, sel_start, sel_end);
+    return;
+  }
+
+  const char *render = editor_row_render(row);
+
+  // Binary search the first span that ends after `cx`
+  int si = 0, hi = row->hl_count;
+  while (si < hi) {
+    int mid = (si + hi) / 2;
+    if (row->hl[mid].start + row->hl[mid].len <= cx) si = mid + 1;
+    else hi = mid;
+  }
+
+  int cur_color = HL_DEFAULT_COLOR;
+  bool cur_sel = false;
+
+  for (int x = cx; x < to; ) {
+    // Highlight class at `x` and where it ends
+    int hl = HL_NORMAL;
+    int run_end = to;
+    if (si < row->hl_count) {
+      hl_span_t *sp = &row->hl[si];
+      if (x >= sp->start) {
+        hl = sp->hl;
+        run_end = MIN(run_end, sp->start + sp->len);
+      } else {
+        run_end = MIN(run_end, sp->start);
+      }
+    }
+
+    // Selection state at `x` and where it changes
+    bool sel = false;
+    if (sel_start != -1) {
+      if (x < sel_start) {
+        run_end = MIN(run_end, sel_start);
+      } else if (x < sel_end) {
+        sel = true;
+        run_end = MIN(run_end, sel_end);
+      }
+    }
+
+    if (sel != cur_sel) {
+      if (sel) {
+        ab_append(ab, ANSI_REVERSE_DISPLAY, strlen(ANSI_REVERSE_DISPLAY));
+      } else {
+        ab_append(ab, ANSI_RESET, strlen(ANSI_RESET));
+        cur_color = HL_DEFAULT_COLOR;
+      }
+      cur_sel = sel;
+    }
+    ab_set_color(ab, &cur_color, editor_syntax_to_color(hl));
+
+    int rb = editor_row_cx_to_rb(row, x);
+    ab_append(ab, render + rb, editor_row_cx_to_rb(row, run_end) - rb);
+    x = run_end;
+
+    if (si < row->hl_count && x >= row->hl[si].start + row->hl[si].len) si ++;
+  }
+
+  if (cur_sel || cur_color != HL_DEFAULT_COLOR) {
+    ab_append(ab, ANSI_RESET, strlen(ANSI_RESET));
+  }
+}
+
+/**
+ * @brief Draw the visible slice of a row.
+ *
+ * The viewport [from, from + screencols) is in display columns and is
+ * converted to a byte range with the row's width index. A tab or wide
+ * character cut by a viewport edge is drawn as blanks.
+ *
+ * @param ab        Buffer.
+ * @param row       Row object.
+ * @param from      First display column (E.coloff, or the grid column of a
+ *                  wrapped long row).
+ * @param sel_start Start of the selected range in bytes (-1 if nothing is selected).
+ * @param sel_end   End of the selected range in bytes (exclusive).
+ */
+static void editor_draw_row_slice(abuf_t *ab, erow_t *row, int from, int sel_start, int sel_end) {
+  // NOTE: Considering horizontal offset
+  // If coloff exceeds the line length, 
+  // it means that this line is invisible 
+  // in the current viewport and nothing should be drawn.
+  int limit = from + E.screencols;
+  if (editor_row_cx_to_rx(row, row->size) <= from) return;
+
+  // First character starting inside the viewport
+  int cx = editor_row_rx_to_cx(row, from);
+  int lead = 0;
+  if (editor_row_cx_to_rx(row, cx) < from) {
+    int next = editor_row_next_char(row, cx);
+    lead = MIN(editor_row_cx_to_rx(row, next), limit) - from;
+    cx = next;
+  }
+
+  // First character that does not fit entirely
+  int to = editor_row_rx_to_cx(row, limit);
+  int tail = 0;
+  if (to < cx) {
+    to = cx;
+  } else if (to < row->size) {
+    tail = limit - editor_row_cx_to_rx(row, to);
+  }
+
+  ab_append_spaces(ab, lead);
+  editor_draw_row_bytes(ab, row, cx, to, sel_start, sel_end);
+  ab_append_spaces(ab, tail);
+}
+
+/**
+ * @brief Compute the part of a row covered by the visual selection.
+ *
+ * @param filerow  Row index.
+ * @param row      Row object.
+ * @param hl_start Set to the start of the selected range (-1 if none).
+ * @param hl_end   Set to the end of the selected range (exclusive).
+ */
+static void editor_row_selection(int filerow, const erow_t *row, int *hl_start, int *hl_end) {
+  *hl_start = -1;
+  *hl_end = -1;
+  if (!is_in_visual_mode() || g_drawing_window != editor_window_current()) return;
+
   // Marking highlight row range
-  int start_y = -1;
-  int end_y = -1;
+  int start_y = MIN(E.cy, E.select_cy);
+  int end_y = MAX(E.cy, E.select_cy);
   int start_x = -1;
   int end_x = -1;
 
-  if (is_in_visual_mode()) {
-    if (E.mode == MODE_VISUAL_LINE) {
-      start_y = MIN(E.cy, E.select_cy);
-      end_y = MAX(E.cy, E.select_cy);
-    } 
-    else if (E.mode == MODE_VISUAL_BLOCK) {
-      start_y = MIN(E.cy, E.select_cy);
-      end_y = MAX(E.cy, E.select_cy);
+  if (filerow < start_y || filerow > end_y) return;
+
+  if (E.mode == MODE_VISUAL_BLOCK) {
+    start_x = MIN(E.cx, E.select_cx);
+    end_x = MAX(E.cx, E.select_cx) + 1;
+  }
+  else if (E.mode == MODE_VISUAL) {
+    if (E.cy < E.select_cy) {
+      start_x = E.cx;
+      end_x = E.select_cx;
+    } else if (E.cy == E.select_cy) {
       start_x = MIN(E.cx, E.select_cx);
-      end_x = MAX(E.cx, E.select_cx) + 1;
+      end_x = MAX(E.cx, E.select_cx);
+    } else {
+      start_x = E.select_cx;
+      end_x = E.cx;
     }
-    else if (E.mode == MODE_VISUAL) {
-      start_y = MIN(E.cy, E.select_cy);
-      end_y = MAX(E.cy, E.select_cy);
-
-      if (E.cy < E.select_cy) {
-        start_x = E.cx;
-        end_x = E.select_cx;
-      } else if (E.cy == E.select_cy) {
-        start_x = MIN(E.cx, E.select_cx);
-        end_x = MAX(E.cx, E.select_cx);
-      } else {
-        start_x = E.select_cx;
-        end_x = E.cx;
-      }
+  }
+
+  if (E.mode == MODE_VISUAL_LINE) {
+    *hl_start = 0;
+    *hl_end = row->size;
+  }
+  else if (E.mode == MODE_VISUAL_BLOCK) {
+    *hl_start = start_x;
+    *hl_end = end_x;
+  }
+  else if (E.mode == MODE_VISUAL) {
+    // Case A: The middle line
+    if (filerow > start_y && filerow < end_y) {
+      *hl_start = 0;
+      *hl_end = row->size;
+    } 
+    // Case B: Same line
+    else if (start_y == end_y) {
+      *hl_start = start_x;
+      *hl_end = end_x;
+    } 
+    // Case C: First line
+    else if (filerow == start_y) {
+      *hl_start = start_x;
+      *hl_end = row->size;
     }
+    // Case D: Tail row
+    else if (filerow == end_y) {
+      *hl_start = 0;
+      *hl_end = end_x;
+    }
+  }
+}
+
+/**
+ * @brief Draw the logic for each row (tilde ~).
+ *
+ * In soft-wrap mode every screen line shows one visual line; the first one
+ * is found from E.lineoff through the wrap index.
+ *
+ * @param ab Buffer.
+ */
+static void editor_draw_rows(abuf_t *ab) {
+  TRACE_SPAN("draw_rows");
+
+  int filerow = E.rowoff;
+  int seg = 0;   // Byte offset of the visual line being drawn (soft-wrap mode)
+  int sub = 0;   // Index of that visual line inside the row
+
+  if (E.wrap) {
+    filerow = editor_wrap_line_to_row(E.lineoff, &sub);
+    erow_t *row = editor_row_at(filerow);
+    if (row) seg = editor_wrap_segment_start(row, sub);
   }
 
   // Loop
   for (int y = 0; y < E.screenrows; ++ y) {
-    int filerow = y + E.rowoff;
-    if (filerow >= E.numrows) {
+    erow_t *row = filerow < E.numrows ? editor_row(filerow) : NULL;
+    if (!row) {
       ab_append(ab, "~", 1);
     } else {
-      char *line = E.row[filerow].chars;
-      int size = E.row[filerow].size;
 
       // --- Core: Calculate highlight area ---
       // The parts that need to be highlighted in this line
-      // [hl_start, hl_end]
-      int hl_start = -1, hl_end = -1;
+      // [hl_start, hl_end)
+      int hl_start, hl_end;
+      editor_row_selection(filerow, row, &hl_start, &hl_end);
 
-      erow_t *row = &E.row[filerow];
-
-      // If in visual mode, and the current row is within the scope
-      if (is_in_visual_mode() && 
-          (filerow >= start_y && filerow <= end_y)) {
-        if (E.mode == MODE_VISUAL_LINE) {
-          hl_start = 0;
-          hl_end = row->size;
-        }
-        else if (E.mode == MODE_VISUAL_BLOCK) {
-          hl_start = start_x;
-          hl_end = end_x;
+      // --- Core: Rendering ---
+      if (E.wrap) {
+        int end = editor_wrap_segment_end(row, seg);
+        if (row->ll) {
+          editor_draw_row_slice(ab, row, editor_wrap_segment_col(row, sub, seg), hl_start, hl_end);
+        } else {
+          editor_draw_row_bytes(ab, row, seg, end, hl_start, hl_end);
         }
-        else if (E.mode == MODE_VISUAL) {
-          // Case A: The middle line
-          if (filerow > start_y && filerow < end_y) {
-            hl_start = 0;
-            hl_end = row->size;
-          } 
-          // Case B: Same line
-          else if (start_y == end_y) {
-            hl_start = start_x;
-            hl_end = end_x;
-          } 
-          // Case C: First line
-          else if (filerow == start_y) {
-            hl_start = start_x;
-            hl_end = row->size;
-          }
-          // Case D: Tail row
-          else if (filerow == end_y) {
-            hl_start = 0;
-            hl_end = end_x;
-          }
+
+        seg = end;
+        sub ++;
+        if (row->ll ? sub >= editor_wrap_row_lines(filerow) : seg >= row->size) {
+          filerow ++;
+          seg = 0;
+          sub = 0;
         }
+      } else {
+        editor_draw_row_slice(ab, row, E.coloff, hl_start, hl_end);
+        filerow ++;
       }
+    }
+    
+    // NOTE: Clear residual characters to the right of the cursor at the end of each line.
+    ab_append(ab, ANSI_CLEAR_LINE, strlen(ANSI_CLEAR_LINE));
+    ab_append(ab, "\r\n", 2);
+  }
+}
 
-      // --- Core: Rendering ---
-      // If there is no highlight, or the highlighted area is all to the left of `coloff`
-      if (hl_start == -1 || hl_end <= E.coloff) {
-        // NOTE: Considering horizontal offset
-        // If coloff exceeds the line length, 
-        // it means that this line is invisible 
-        // in the current viewport and nothing should be drawn.
-        int len = 0;
-        if (size > E.coloff) len = size - E.coloff;
-        if (len > E.screencols) len = E.screencols;
-
-        if (len > 0)
-          ab_append(ab, line + E.coloff, len);
-      }
-      else {
-        // --- First paragraph: Ordinary ---
-        if (hl_start > E.coloff) {
-          int len = hl_start - E.coloff;
-          ab_append(ab, row->chars + E.coloff, len);
-        }
+/**
+ * @brief Draw the hex view over the text rows of the screen, then its status
+ *        bar (windows are not drawn meanwhile).
+ *
+ * Every line is HEX_LINE_BYTES bytes read straight from the mapping:
+ * "offset  xx xx .. xx  xx .. xx |ascii|". The byte under the cursor is
+ * shown reversed in the pane the cursor is not in.
+ *
+ * @param ab Buffer.
+ * @param h  Hex view.
+ */
+static void editor_draw_hex(abuf_t *ab, hex_view_t *h) {
+  TRACE_SPAN("draw_hex");
 
-        // --- Second paragraph: Highlight ---
-        int actual_start = MAX(E.coloff, hl_start);
-        int max_screen_idx = E.coloff + E.screencols;
-        int actual_end = MIN(hl_end, max_screen_idx);
+  int rows = editor_window_screen_rows();
+  editor_hex_scroll(rows);
 
-        int len = actual_end - actual_start;
-        if (len > 0) {
-          ab_append(ab, ANSI_REVERSE_DISPLAY, strlen(ANSI_REVERSE_DISPLAY));
-          ab_append(ab, row->chars + E.coloff + actual_start, len);
-          ab_append(ab, ANSI_RESET, strlen(ANSI_RESET));
-        }
+  // Offsets get wider than 8 digits only for files past 4 GiB
+  int digits = 8;
+  while (digits < 16 && (h->size >> (4 * digits)) > 0) digits ++;
+  int ascii_col = digits + 2 + HEX_LINE_BYTES * 3 + 1;   // The first '|'
+  bool fits = ascii_col + HEX_LINE_BYTES + 2 <= E.screencols;
 
-        // --- Third paragraph: Ordinary ---
-        if (hl_end < row->size) {
-          int len = row->size - hl_end;
-          ab_append(ab, row->chars + hl_end, len);
-        }
+  for (int y = 0; y < rows; ++ y) {
+    int64_t at = (h->top + y) * HEX_LINE_BYTES;
+    if (at >= h->size) {
+      ab_append(ab, "~", 1);
+    } else {
+      int n = (int)MIN(HEX_LINE_BYTES, h->size - at);
+      int cur = h->off >= at && h->off < at + n ? (int)(h->off - at) : -1;
+      char line[256];
+      int len = snprintf(line, sizeof(line), "%0*llx  ", digits, (unsigned long long)at);
+
+      for (int i = 0; i < HEX_LINE_BYTES; ++ i) {
+        bool mark = fits && i == cur && h->pane == HEX_PANE_ASCII;
+        if (mark) len += snprintf(line + len, sizeof(line) - len, ANSI_REVERSE_DISPLAY);
+        if (i < n) len += snprintf(line + len, sizeof(line) - len, "%02x", h->data[at + i]);
+        else len += snprintf(line + len, sizeof(line) - len, "  ");
+        if (mark) len += snprintf(line + len, sizeof(line) - len, ANSI_RESET);
+        len += snprintf(line + len, sizeof(line) - len, i == HEX_LINE_BYTES / 2 - 1 ? "  " : " ");
       }
+
+      line[len ++] = '|';
+      for (int i = 0; i < n; ++ i) {
+        unsigned char c = h->data[at + i];
+        bool mark = fits && i == cur && h->pane == HEX_PANE_HEX;
+        if (mark) len += snprintf(line + len, sizeof(line) - len, ANSI_REVERSE_DISPLAY);
+        line[len ++] = c >= 32 && c < 127 ? c : '.';
+        if (mark) len += snprintf(line + len, sizeof(line) - len, ANSI_RESET);
+      }
+      line[len ++] = '|';
+
+      // A narrow screen gets the line cut (no escapes were added then)
+      ab_append(ab, line, fits ? len : MIN(len, E.screencols));
     }
-    
-    // NOTE: Clear residual characters to the right of the cursor at the end of each line.
     ab_append(ab, ANSI_CLEAR_LINE, strlen(ANSI_CLEAR_LINE));
     ab_append(ab, "\r\n", 2);
   }
+
+  // Status bar
+  char lstatus[80];
+  int llen = snprintf(lstatus, sizeof(lstatus), "%.20s - %lld bytes [hex]%s%s",
+    h->filename, (long long)h->size, h->readonly ? " [RO]" : "", h->ndirty > 0 ? " [+]" : "");
+  char rstatus[80];
+  int rlen = snprintf(rstatus, sizeof(rstatus), "%s | %s | 0x%llx/0x%llx",
+    h->pane == HEX_PANE_HEX ? "hex" : "ascii", editor_mode_strings[E.mode],
+    (unsigned long long)h->off, (unsigned long long)h->size);
+  llen = MIN(llen, MIN((int)sizeof(lstatus) - 1, E.screencols));
+  rlen = MIN(rlen, (int)sizeof(rstatus) - 1);
+
+  ab_append(ab, ANSI_REVERSE_DISPLAY, strlen(ANSI_REVERSE_DISPLAY));
+  ab_append(ab, lstatus, llen);
+  if (llen + rlen <= E.screencols) {
+    ab_append_spaces(ab, E.screencols - llen - rlen);
+    ab_append(ab, rstatus, rlen);
+  } else {
+    ab_append_spaces(ab, E.screencols - llen);
+  }
+  ab_append(ab, ANSI_RESET, strlen(ANSI_RESET));
+
+  // Cursor: on the digit being typed, or on the character
+  int i = (int)(h->off % HEX_LINE_BYTES);
+  g_screen_cy = (int)(h->off / HEX_LINE_BYTES - h->top);
+  g_screen_cx = h->pane == HEX_PANE_HEX
+              ? digits + 2 + i * 3 + (i >= HEX_LINE_BYTES / 2) + h->nibble
+              : ascii_col + 1 + i;
+  g_screen_cx = MIN(g_screen_cx, E.screencols - 1);
 }
 
 /**
@@ -343,7 +735,8 @@ static void editor_draw_rows(abuf_t *ab) {
  *        and finally refreshes the screen.
  */
 void editor_refresh_screen(void) {
-  editor_scroll();
+  int64_t start_ns = editor_stats_now();
+  int64_t start_allocs = zilo_mem_allocs();
 
   abuf_t ab = {NULL, 0};
 
@@ -352,14 +745,42 @@ void editor_refresh_screen(void) {
   // from the previous cursor position, leaving residual characters on the left side.
   ab_append(&ab, ANSI_CURSOR_HOME, strlen(ANSI_CURSOR_HOME));
 
-  // 1. Draw text content
-  editor_draw_rows(&ab);
-
-  // 2. Draw the status bar at the bottom
-  editor_draw_status_bar(&ab);
+  // 1. Draw every window: its text content, then its status bar (or the
+  //    hex view instead of all of them)
+  int cur = editor_window_current();
+  int nwin = editor_hex() ? 0 : editor_window_count();
+  int screen_cy = 0;
+  int screen_cx = 0;
+  if (editor_hex()) {
+    editor_draw_hex(&ab, editor_hex());
+    screen_cy = g_screen_cy;
+    screen_cx = g_screen_cx;
+  }
+  for (int i = 0; i < nwin; ++ i) {
+    editor_window_enter(i);
+    g_drawing_window = i;
+
+    editor_scroll();
+    if (i == cur) {
+      screen_cy = editor_window_top(i) + g_screen_cy;
+      screen_cx = g_screen_cx;
+    }
 
-  // 3. Floating Messages
-  editor_draw_message_bar(&ab);
+    editor_draw_rows(&ab);
+    editor_draw_status_bar(&ab);
+    if (i + 1 < nwin) ab_append(&ab, "\r\n", 2);
+  }
+  editor_window_enter(cur);
+  g_drawing_window = cur;
+  g_screen_cy = screen_cy;
+  g_screen_cx = screen_cx;
+
+  // 3. Floating Messages (or the command line being typed)
+  if (E.mode == MODE_COMMAND) {
+    editor_draw_command_line(&ab);
+  } else {
+    editor_draw_message_bar(&ab);
+  }
 
   if (E.mode == MODE_INSERT) {
     ab_append(&ab, ANSI_CURSOR_SHAPE_BAR, strlen(ANSI_CURSOR_SHAPE_BAR));
@@ -370,10 +791,24 @@ void editor_refresh_screen(void) {
 
   char buf[32];
   // NOTE: Considering vertical and horizontal offsets
-  snprintf(buf, sizeof(buf), "\x1b[%d;%dH", E.cy - E.rowoff + 1, E.cx - E.coloff + 1);
+  snprintf(buf, sizeof(buf), "\x1b[%d;%dH", g_screen_cy + 1, g_screen_cx + 1);
   ab_append(&ab, buf, strlen(buf));
 
-  write(STDOUT_FILENO, ab.buf, ab.len);
+  {
+    TRACE_SPAN("write");
+    if (g_out_sink) g_out_sink(ab.buf, ab.len, g_out_arg);
+    else write(STDOUT_FILENO, ab.buf, ab.len);
+  }
+  editor_stats_frame(start_ns, editor_stats_now(), ab.len, zilo_mem_allocs() - start_allocs);
 
   ab_free(&ab);
 }
+
+/**
+ * @brief Hand the next frames to `sink` instead of writing them to
+ *        standard output (NULL: standard output again).
+ */
+void editor_set_output_sink(editor_frame_sink_t sink, void *arg) {
+  g_out_sink = sink;
+  g_out_arg = arg;
+}
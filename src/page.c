@@ -0,0 +1,1010 @@
+#define ZILO_LOG_MODULE LOG_MODULE_EDIT
+#include "page.h"
+#include "cold.h"
+#include "lline.h"
+#include "logger.h"
+#include "mem.h"
+#include "output.h"
+#include "row.h"
+#include "syntax.h"
+#include "zilo.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Row pages. The rows of a buffer live in pages of ROW_PAGE_ROWS to
+ * 2 * ROW_PAGE_ROWS consecutive rows; a Fenwick tree over the row counts of
+ * the pages finds the page of any row in O(log n), and the page of the last
+ * lookup is tried first, so a walk over the rows costs O(1) per row.
+ *
+ * With paging on (see cold.h), a sweep drops whole pages far from the view
+ * and the cursor: every row of the page, descriptor, bytes, render cache
+ * and spans, whatever its storage (inline, shared, long, compressed). What
+ * is left of a page is its row count, byte count and hash, its lexer state
+ * at the end, and where its rows went:
+ *
+ *  - PAGE_IN_FILE: the rows are still the consecutive lines of the file
+ *    attached to the buffer; nothing is written.
+ *  - PAGE_IN_TEMP: every row is written to the temp file as a record (its
+ *    size, line break, origin and file hash, then its bytes).
+ *
+ * A page is read back by the first editor_row_at() or editor_row_scan() of
+ * one of its rows, checked against its hash, lexed from the state of the
+ * page before it, and stays in memory at least until the next sweep (rows
+ * handed out by editor_row_at() stay valid until then). A page that cannot
+ * be read back turns into empty new rows and the error is shown.
+ *
+ * Pages are never dropped by anything else than a sweep or a long walk over
+ * the rows (editor_row_scan()), and never while paging is off. The pages a
+ * file opened with its line index starts with (see lineidx.c) are out from
+ * the start, paging on or not.
+ */
+
+// Bytes of a row record in the temp file, before the bytes of the row
+#define PAGE_RECORD (4 + 1 + 8 + 8)
+
+static unsigned g_epoch = 1;            // Current sweep epoch (pins, see editor_row_at())
+static row_page_t *g_file_pages = NULL; // Every page PAGE_IN_FILE, of every buffer
+static page_stats_t g_stats;
+
+/*------------------------------------------
+        PAGE LOOKUP (FENWICK TREE)
+ ------------------------------------------*/
+/**
+ * @brief Add `delta` to the rows of page `k`.
+ */
+static void store_tree_add(row_store_t *s, int k, int delta) {
+  for (int i = k + 1; i <= s->npages; i += i & -i) s->tree[i] += delta;
+}
+
+/**
+ * @brief Rows of the pages [0, k).
+ */
+static int store_tree_prefix(const row_store_t *s, int k) {
+  int sum = 0;
+  for (int i = k; i > 0; i -= i & -i) sum += s->tree[i];
+  return sum;
+}
+
+/**
+ * @brief Rebuild the tree from the row counts of the pages in O(n / page).
+ */
+static void store_tree_rebuild(row_store_t *s) {
+  if (!s->tree) return;
+  s->tree[0] = 0;
+  for (int k = 0; k < s->npages; ++ k) s->tree[k + 1] = s->pages[k]->n;
+  for (int i = 1; i <= s->npages; ++ i) {
+    int parent = i + (i & -i);
+    if (parent <= s->npages) s->tree[parent] += s->tree[i];
+  }
+  s->hint_first = -1;
+}
+
+/**
+ * @brief Find the page holding row `at` (0 <= at < E.numrows).
+ *
+ * @param first Set to the first row of the page.
+ */
+static int store_find(row_store_t *s, int at, int *first) {
+  if (s->hint_first >= 0 && s->hint < s->npages &&
+      at >= s->hint_first && at < s->hint_first + s->pages[s->hint]->n) {
+    *first = s->hint_first;
+    return s->hint;
+  }
+
+  int k = 0;
+  int rem = at;
+  int step = 1;
+  while (step * 2 <= s->npages) step *= 2;
+  for (; step > 0; step /= 2) {
+    if (k + step <= s->npages && s->tree[k + step] <= rem) {
+      k += step;
+      rem -= s->tree[k];
+    }
+  }
+
+  s->hint = k;
+  s->hint_first = at - rem;
+  *first = at - rem;
+  return k;
+}
+
+/**
+ * @brief Make room for `n` pages.
+ *
+ * @return Returns 0 on success, -1 on failure.
+ */
+static int store_reserve(row_store_t *s, int n) {
+  if (n <= s->cap) return 0;
+
+  int cap = MAX(n, MAX(s->cap * 2, 16));
+  row_page_t **pages = zilo_realloc(MEM_ROW_ARRAY, s->pages, sizeof(row_page_t *) * cap);
+  if (pages) s->pages = pages;
+  int *tree = zilo_realloc(MEM_ROW_ARRAY, s->tree, sizeof(int) * (cap + 1));
+  if (tree) s->tree = tree;
+  if (!pages || !tree) {
+    LOG_ERROR("realloc", "Failed to expand the row pages.");
+    return -1;
+  }
+  s->cap = cap;
+  return 0;
+}
+
+/**
+ * @brief Put `page` at position `k` of the store (room was reserved). A
+ *        page appended (as a load does) sets its tree node in O(log n);
+ *        any other insertion rebuilds the tree.
+ */
+static void store_insert_page(row_store_t *s, int k, row_page_t *page) {
+  memmove(s->pages + k + 1, s->pages + k, sizeof(row_page_t *) * (s->npages - k));
+  s->pages[k] = page;
+  s->npages ++;
+  if (s->hand > k) s->hand ++;
+
+  if (k < s->npages - 1) {
+    store_tree_rebuild(s);
+    return;
+  }
+  int i = s->npages;
+  s->tree[i] = page->n + store_tree_prefix(s, i - 1) - store_tree_prefix(s, i - (i & -i));
+}
+
+/**
+ * @brief Take the (empty) page `k` out of the store and free it.
+ */
+static void store_remove_page(row_store_t *s, int k) {
+  zilo_free(MEM_ROW_ARRAY, s->pages[k]->rows);
+  zilo_free(MEM_ROW_ARRAY, s->pages[k]);
+  g_stats.pages --;
+
+  memmove(s->pages + k, s->pages + k + 1, sizeof(row_page_t *) * (s->npages - k - 1));
+  s->npages --;
+  if (s->hand > k) s->hand --;
+  store_tree_rebuild(s);
+}
+
+/**
+ * @brief A new resident page with room for `cap` rows (none: `rows` is
+ *        NULL, for a page that starts out).
+ *
+ * @return Returns the page, NULL on failure.
+ */
+static row_page_t *page_new(int cap) {
+  row_page_t *p = zilo_calloc(MEM_ROW_ARRAY, 1, sizeof(row_page_t));
+  erow_t *rows = cap > 0 ? zilo_malloc(MEM_ROW_ARRAY, sizeof(erow_t) * cap) : NULL;
+  if (!p || (cap > 0 && !rows)) {
+    LOG_ERROR("malloc", "Failed to allocate a page of rows.");
+    zilo_free(MEM_ROW_ARRAY, p);
+    zilo_free(MEM_ROW_ARRAY, rows);
+    return NULL;
+  }
+  p->rows = rows;
+  p->cap = cap;
+  p->state = PAGE_RESIDENT;
+  p->hl_end = HL_STATE_UNKNOWN;
+  p->file_pos = -1;
+  g_stats.pages ++;
+  return p;
+}
+
+/*------------------------------------------
+              PAGED-OUT STORAGE
+ ------------------------------------------*/
+static void page_link_file(row_page_t *p) {
+  p->file_prev = NULL;
+  p->file_next = g_file_pages;
+  if (g_file_pages) g_file_pages->file_prev = p;
+  g_file_pages = p;
+}
+
+static void page_unlink_file(row_page_t *p) {
+  if (p->file_prev) p->file_prev->file_next = p->file_next;
+  else g_file_pages = p->file_next;
+  if (p->file_next) p->file_next->file_prev = p->file_prev;
+  p->file_prev = p->file_next = NULL;
+}
+
+/**
+ * @brief Let go of where the rows of a paged-out page are (the file
+ *        reference or the bytes of the temp file).
+ */
+static void page_drop_storage(row_page_t *p) {
+  if (p->state == PAGE_IN_FILE) {
+    page_unlink_file(p);
+    editor_page_release(p->file);
+    p->file = NULL;
+    g_stats.in_file --;
+  } else if (p->state == PAGE_IN_TEMP) {
+    editor_spill_free(p->len);
+    g_stats.in_temp --;
+    g_stats.temp_bytes -= p->len;
+  }
+  p->state = PAGE_RESIDENT;
+}
+
+/**
+ * @brief Check `len` bytes read from the file against a PAGE_IN_FILE page:
+ *        cut as the loader cuts them, they must be its lines.
+ *
+ * @return Returns 0 if they are, -1 otherwise.
+ */
+static int page_check_lines(const row_page_t *p, const char *buf, int64_t len) {
+  lhash_t text = { 0, 1 };
+  uint64_t eol = 0;
+  int n = 0;
+  const char *s = buf;
+  const char *end = buf + len;
+  const char *nl;
+  while (n <= p->n && (nl = memchr(s, '\n', end - s))) {
+    int size = nl - s;
+    bool crlf = size > 0 && s[size - 1] == '\r';
+    page_hash_add(&text, &eol, editor_hash_line(s, size - crlf), crlf);
+    n ++;
+    s = nl + 1;
+  }
+  if (n != p->n || s != end || text.hash != p->text.hash || eol != p->eol) {
+    LOG_ERROR("page_check_lines", "The file changed under paged rows.");
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Turn the lines of a PAGE_IN_FILE page (checked) into temp records.
+ *
+ * @return Returns the records (MEM_COLD, `*out_len` bytes), NULL on failure.
+ */
+static char *page_records_of_lines(const row_page_t *p, const char *buf, int64_t len, int64_t *out_len) {
+  int64_t total = (int64_t)p->n * PAGE_RECORD + p->bytes - p->n;
+  char *rec = zilo_malloc(MEM_COLD, total);
+  if (!rec) return NULL;
+
+  char *w = rec;
+  const char *s = buf;
+  const char *end = buf + len;
+  const char *nl;
+  while ((nl = memchr(s, '\n', end - s))) {
+    int32_t size = nl - s;
+    uint8_t crlf = size > 0 && s[size - 1] == '\r';
+    size -= crlf;
+    int64_t origin = p->pos + (s - buf);
+    uint64_t hash = editor_hash_line(s, size);
+    memcpy(w, &size, 4);
+    memcpy(w + 4, &crlf, 1);
+    memcpy(w + 5, &origin, 8);
+    memcpy(w + 13, &hash, 8);
+    memcpy(w + PAGE_RECORD, s, size);
+    w += PAGE_RECORD + size;
+    s = nl + 1;
+  }
+  *out_len = total;
+  return rec;
+}
+
+/**
+ * @brief Move a PAGE_IN_FILE page to the temp file (its file is about to
+ *        change): its lines are read once more and written as records.
+ *
+ * @return Returns 0 on success, -1 on failure (the page is unchanged).
+ */
+static int page_move_to_temp(row_page_t *p) {
+  char *buf = zilo_malloc(MEM_COLD, p->len);
+  if (!buf || editor_page_read(p->file, p->pos, buf, p->len) == -1 ||
+      page_check_lines(p, buf, p->len) == -1) {
+    zilo_free(MEM_COLD, buf);
+    return -1;
+  }
+
+  int64_t len;
+  char *rec = page_records_of_lines(p, buf, p->len, &len);
+  zilo_free(MEM_COLD, buf);
+  int64_t pos = rec ? editor_spill_write(rec, len) : -1;
+  zilo_free(MEM_COLD, rec);
+  if (pos == -1) return -1;
+
+  page_drop_storage(p);
+  p->state = PAGE_IN_TEMP;
+  p->pos = pos;
+  p->len = len;
+  g_stats.in_temp ++;
+  g_stats.temp_bytes += len;
+  return 0;
+}
+
+/*------------------------------------------
+              PAGING OUT AND IN
+ ------------------------------------------*/
+/**
+ * @brief True if rows [first, first + n) are on screen, next to it or next
+ *        to the cursor.
+ */
+static bool page_near_view(int first, int n) {
+  int margin = MAX(E.screenrows, 1);
+  int last = first + n - 1;
+  return (last >= E.rowoff - margin && first < E.rowoff + 2 * margin) ||
+         (last >= E.cy - margin && first <= E.cy + margin);
+}
+
+/**
+ * @brief Drop the rows of a resident page, to the attached file if they are
+ *        still its consecutive lines, to the temp file otherwise.
+ *
+ * @return Returns 0 on success, -1 on failure (the page is unchanged).
+ */
+static int page_out(row_page_t *p) {
+  lhash_t text = { 0, 1 };
+  uint64_t eol = 0;
+  int64_t bytes = 0;
+  int64_t rec_len = 0;
+  int modified = 0;
+  bool clean = true;
+  int64_t next = p->rows[0].origin;
+  for (int i = 0; i < p->n; ++ i) {
+    const erow_t *row = &p->rows[i];
+    page_hash_add(&text, &eol, row->hash, row->origin_crlf);
+    bytes += row->size + 1;
+    rec_len += PAGE_RECORD + row->size;
+    if (!editor_row_in_file(row)) {
+      modified ++;
+      clean = false;
+    }
+    if (row->origin != next) clean = false;
+    next = row->origin + row->size + 1 + row->origin_crlf;
+  }
+
+  struct cold_file *file = editor_page_file();
+  bool in_file = clean && editor_page_file_fits(file, next);
+  int64_t pos = 0;
+
+  if (!in_file) {
+    char *rec = zilo_malloc(MEM_COLD, rec_len);
+    if (!rec) {
+      LOG_ERROR("malloc", "Failed to allocate a page of rows to spill.");
+      return -1;
+    }
+    char *w = rec;
+    int ret = 0;
+    for (int i = 0; i < p->n && ret == 0; ++ i) {
+      const erow_t *row = &p->rows[i];
+      int32_t size = row->size;
+      uint8_t crlf = row->origin_crlf;
+      memcpy(w, &size, 4);
+      memcpy(w + 4, &crlf, 1);
+      memcpy(w + 5, &row->origin, 8);
+      memcpy(w + 13, &row->file_hash, 8);
+      ret = editor_row_read(row, 0, size, w + PAGE_RECORD);
+      w += PAGE_RECORD + size;
+    }
+    pos = ret == 0 ? editor_spill_write(rec, rec_len) : -1;
+    zilo_free(MEM_COLD, rec);
+    if (pos == -1) return -1;
+  }
+
+  p->hl_end = p->rows[p->n - 1].hl_state;
+  p->modified = modified;
+  p->bytes = bytes;
+  p->clean = clean;
+  p->file_pos = clean ? p->rows[0].origin : -1;
+  p->text = text;
+  p->eol = eol;
+
+  // The rows stay counted in E.modified_rows while they are out
+  for (int i = 0; i < p->n; ++ i) editor_row_release(&p->rows[i]);
+  zilo_free(MEM_ROW_ARRAY, p->rows);
+  p->rows = NULL;
+  p->cap = 0;
+
+  if (in_file) {
+    p->state = PAGE_IN_FILE;
+    p->pos = p->file_pos;
+    p->len = next - p->file_pos;
+    p->file = file;
+    editor_page_hold(file);
+    page_link_file(p);
+    g_stats.in_file ++;
+  } else {
+    p->state = PAGE_IN_TEMP;
+    p->pos = pos;
+    p->len = rec_len;
+    g_stats.in_temp ++;
+    g_stats.temp_bytes += rec_len;
+  }
+  return 0;
+}
+
+/**
+ * @brief Make the rows of a page read back from `buf`.
+ *
+ * @return Returns 0 on success, -1 if they do not match the page (the rows
+ *         made so far are released).
+ */
+static int page_build_rows(row_page_t *p, const char *buf, int64_t len) {
+  lhash_t text = { 0, 1 };
+  uint64_t eol = 0;
+  int64_t at = p->file_pos;   // Offset of the row in the file (clean pages)
+  const char *s = buf;
+  const char *end = buf + len;
+  int n = 0;
+
+  for (; n < p->n; ++ n) {
+    erow_t *row = &p->rows[n];
+    int32_t size;
+    uint8_t crlf;
+    int64_t origin = -1;
+    uint64_t file_hash = 0;
+    const char *bytes;
+
+    if (p->state == PAGE_IN_FILE) {
+      const char *nl = memchr(s, '\n', end - s);
+      if (!nl) break;
+      size = nl - s;
+      crlf = size > 0 && s[size - 1] == '\r';
+      size -= crlf;
+      bytes = s;
+      s = nl + 1;
+    } else {
+      if (end - s < PAGE_RECORD) break;
+      memcpy(&size, s, 4);
+      memcpy(&crlf, s + 4, 1);
+      memcpy(&origin, s + 5, 8);
+      memcpy(&file_hash, s + 13, 8);
+      if (size < 0 || end - s - PAGE_RECORD < size) break;
+      bytes = s + PAGE_RECORD;
+      s += PAGE_RECORD + size;
+    }
+
+    if (editor_row_init(row, (char *)bytes, size) == -1) break;
+    editor_row_restore(row);
+
+    // A clean page is the lines at `file_pos` on of the last load or save
+    if (p->clean) {
+      crlf = p->eol ? crlf : 0;
+      origin = at;
+      file_hash = row->hash;
+      at += size + 1 + crlf;
+    }
+    row->origin = origin;
+    row->origin_crlf = crlf;
+    row->file_hash = origin >= 0 ? file_hash : 0;
+    page_hash_add(&text, &eol, row->hash, crlf);
+  }
+
+  if (n == p->n && s == end && text.hash == p->text.hash && eol == p->eol) return 0;
+
+  for (int i = 0; i < n; ++ i) editor_row_release(&p->rows[i]);
+  return -1;
+}
+
+/**
+ * @brief Read the rows of page `k` back (it is not resident).
+ *
+ * @return Returns 0 on success (the rows may be empty stand-ins if the page
+ *         could not be read), -1 if there is no memory for the rows.
+ */
+static int page_in(row_store_t *s, int k, int first) {
+  row_page_t *p = s->pages[k];
+  erow_t *rows = zilo_malloc(MEM_ROW_ARRAY, sizeof(erow_t) * p->n);
+  char *buf = rows ? zilo_malloc(MEM_COLD, p->len) : NULL;
+  if (!rows || !buf) {
+    LOG_ERROR("malloc", "Failed to read a page of rows back.");
+    zilo_free(MEM_ROW_ARRAY, rows);
+    return -1;
+  }
+  p->rows = rows;
+  p->cap = p->n;
+
+  int ret = p->state == PAGE_IN_FILE
+            ? editor_page_read(p->file, p->pos, buf, p->len)
+            : editor_spill_read(p->pos, buf, p->len);
+  if (ret == 0) ret = page_build_rows(p, buf, p->len);
+  zilo_free(MEM_COLD, buf);
+
+  if (ret == -1) {
+    // The text is lost: the page holds as many empty new rows
+    LOG_ERROR("page_in", "Rows %d to %d could not be read back: they are left empty.", first + 1, first + p->n);
+    editor_set_status_message("Rows %d-%d could not be read back (see the log)", first + 1, first + p->n);
+    for (int i = 0; i < p->n; ++ i) {
+      editor_row_init(&p->rows[i], (char *)"", 0);
+      editor_row_restore(&p->rows[i]);
+    }
+    E.modified_rows += p->n - p->modified;
+    E.generation ++;
+  }
+
+  page_drop_storage(p);
+  p->modified = 0;
+  p->used = true;
+
+  // Lexed from the state the page before ends in, on into the rows below
+  // while their start state changes
+  editor_update_syntax(first);
+  return 0;
+}
+
+/**
+ * @brief Split page `k`, which just grew to 2 * ROW_PAGE_ROWS rows. The
+ *        page stays whole if there is no memory for a second one.
+ */
+static void page_split(row_store_t *s, int k) {
+  row_page_t *p = s->pages[k];
+  int half = p->n / 2;
+  if (store_reserve(s, s->npages + 1) == -1) return;
+  row_page_t *q = page_new(2 * ROW_PAGE_ROWS);
+  if (!q) return;
+
+  memcpy(q->rows, p->rows + half, sizeof(erow_t) * (p->n - half));
+  q->n = p->n - half;
+  q->pinned = p->pinned;
+  q->used = true;
+  p->n = half;
+  store_insert_page(s, k + 1, q);
+}
+
+/*------------------------------------------
+              PUBLIC INTERFACE
+ ------------------------------------------*/
+/**
+ * @brief Row `at` of E, its page read back first if it is out.
+ *
+ * The page is pinned: it is not dropped before the next sweep, so the row
+ * stays valid until then (or until rows are inserted or removed).
+ *
+ * @return Returns the row, NULL if `at` is out of range or there is no
+ *         memory to read the page back.
+ */
+erow_t *editor_row_at(int at) {
+  if (at < 0 || at >= E.numrows) return NULL;
+
+  int first;
+  int k = store_find(&E.rows, at, &first);
+  row_page_t *p = E.rows.pages[k];
+  if (p->state != PAGE_RESIDENT && page_in(&E.rows, k, first) == -1) return NULL;
+
+  p->pinned = g_epoch;
+  p->used = true;
+  return &p->rows[at - first];
+}
+
+/**
+ * @brief Row `at` of E, for a walk over many rows (save, search, diff).
+ *
+ * The page is not pinned. Reading a page back while row memory is over the
+ * budget first drops pages the walk is done with, so a walk over a buffer
+ * larger than memory stays within it; a row returned earlier may be gone.
+ *
+ * @return Returns the row, NULL on failure.
+ */
+erow_t *editor_row_scan(int at) {
+  if (at < 0 || at >= E.numrows) return NULL;
+
+  int first;
+  int k = store_find(&E.rows, at, &first);
+  row_page_t *p = E.rows.pages[k];
+  if (p->state != PAGE_RESIDENT) {
+    int64_t budget = editor_cold_budget();
+    if (editor_page_enabled() && budget > 0 && editor_cold_resident() > budget) {
+      editor_pages_trim(budget - budget / 4);
+      k = store_find(&E.rows, at, &first);
+    }
+    if (page_in(&E.rows, k, first) == -1) return NULL;
+  }
+  p->used = true;
+  return &p->rows[at - first];
+}
+
+/**
+ * @brief Row `at` of E if its page is in memory.
+ *
+ * @return Returns the row, NULL if its page is out (or `at` is out of range).
+ */
+erow_t *editor_row_peek(int at) {
+  if (at < 0 || at >= E.numrows) return NULL;
+
+  int first;
+  int k = store_find(&E.rows, at, &first);
+  row_page_t *p = E.rows.pages[k];
+  return p->state == PAGE_RESIDENT ? &p->rows[at - first] : NULL;
+}
+
+/**
+ * @brief First row after the page holding row `at`.
+ */
+int editor_row_page_end(int at) {
+  if (at < 0 || at >= E.numrows) return E.numrows;
+
+  int first;
+  int k = store_find(&E.rows, at, &first);
+  return first + E.rows.pages[k]->n;
+}
+
+/**
+ * @brief Lexer state at the end of row `at`. For a page that is out, that of
+ *        its last row is known; the others are HL_STATE_UNKNOWN.
+ */
+unsigned char editor_row_end_state(int at) {
+  if (at < 0 || at >= E.numrows) return HL_STATE_NORMAL;
+
+  int first;
+  int k = store_find(&E.rows, at, &first);
+  row_page_t *p = E.rows.pages[k];
+  if (p->state == PAGE_RESIDENT) return p->rows[at - first].hl_state;
+  return at == first + p->n - 1 ? p->hl_end : HL_STATE_UNKNOWN;
+}
+
+/**
+ * @brief Index in E of a row handed out by editor_row_at(), editor_row_scan()
+ *        or editor_row_peek().
+ *
+ * @return Returns the index, -1 if the row is not one of E.
+ */
+int editor_row_index(const erow_t *row) {
+  row_store_t *s = &E.rows;
+  if (s->hint_first >= 0 && s->hint < s->npages) {
+    row_page_t *p = s->pages[s->hint];
+    if (p->rows && row >= p->rows && row < p->rows + p->n) return s->hint_first + (row - p->rows);
+  }
+
+  for (int k = 0; k < s->npages; ++ k) {
+    row_page_t *p = s->pages[k];
+    if (p->rows && row >= p->rows && row < p->rows + p->n) {
+      s->hint = k;
+      s->hint_first = store_tree_prefix(s, k);
+      return s->hint_first + (row - p->rows);
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief Insert `row` at `at` in E (0 <= at <= E.numrows), reading its page
+ *        back first if needed. A page that grows to 2 * ROW_PAGE_ROWS rows
+ *        is split; past the last row a full page starts a new one.
+ *
+ * @return Returns 0 on success, -1 on failure (the row is not taken and E
+ *         is unchanged).
+ */
+int editor_rows_insert(int at, const erow_t *row) {
+  row_store_t *s = &E.rows;
+  if (at < 0 || at > E.numrows) return -1;
+
+  int k, first;
+  if (at == E.numrows && (s->npages == 0 || s->pages[s->npages - 1]->n >= ROW_PAGE_ROWS)) {
+    if (store_reserve(s, s->npages + 1) == -1) return -1;
+    row_page_t *p = page_new(16);
+    if (!p) return -1;
+    k = s->npages;
+    first = E.numrows;
+    store_insert_page(s, k, p);
+  } else if (at == E.numrows) {
+    k = s->npages - 1;
+    first = E.numrows - s->pages[k]->n;
+  } else {
+    k = store_find(s, at, &first);
+  }
+
+  row_page_t *p = s->pages[k];
+  if (p->state != PAGE_RESIDENT && page_in(s, k, first) == -1) return -1;
+
+  if (p->n == p->cap) {
+    int cap = MIN(p->cap * 2, 2 * ROW_PAGE_ROWS);
+    erow_t *rows = zilo_realloc(MEM_ROW_ARRAY, p->rows, sizeof(erow_t) * MAX(cap, p->n + 1));
+    if (!rows) {
+      LOG_ERROR("realloc", "Failed to expand a page of rows.");
+      return -1;
+    }
+    p->rows = rows;
+    p->cap = MAX(cap, p->n + 1);
+  }
+
+  int i = at - first;
+  memmove(p->rows + i + 1, p->rows + i, sizeof(erow_t) * (p->n - i));
+  p->rows[i] = *row;
+  p->n ++;
+  p->pinned = g_epoch;
+  p->used = true;
+  store_tree_add(s, k, 1);
+  if (s->hint_first >= 0 && k < s->hint) s->hint_first ++;
+  E.numrows ++;
+
+  if (p->n >= 2 * ROW_PAGE_ROWS) page_split(s, k);
+  return 0;
+}
+
+/**
+ * @brief Append `n` rows to E that are the lines at `pos` of the attached
+ *        file (`len` bytes, `bytes` of rows with one '\n' each, hashed as
+ *        `text` and `eol`), as a page left in the file: nothing is read
+ *        before one of its rows is asked for, and the read is checked
+ *        against the hash (see line_index_load()).
+ *
+ * @return Returns 0 on success, -1 on failure (E is unchanged).
+ */
+int editor_rows_append_file(int n, int64_t pos, int64_t len, int64_t bytes, lhash_t text, uint64_t eol) {
+  row_store_t *s = &E.rows;
+  struct cold_file *file = editor_page_file();
+  if (!file || n <= 0 || store_reserve(s, s->npages + 1) == -1) return -1;
+  row_page_t *p = page_new(0);
+  if (!p) return -1;
+
+  p->n = n;
+  p->state = PAGE_IN_FILE;
+  p->bytes = bytes;
+  p->clean = true;
+  p->file_pos = pos;
+  p->text = text;
+  p->eol = eol;
+  p->pos = pos;
+  p->len = len;
+  p->file = file;
+  editor_page_hold(file);
+  page_link_file(p);
+  g_stats.in_file ++;
+
+  store_insert_page(s, s->npages, p);
+  E.numrows += n;
+  return 0;
+}
+
+/**
+ * @brief Remove row `at` from E; the caller released its memory. A page
+ *        left empty goes away.
+ */
+void editor_rows_remove(int at) {
+  row_store_t *s = &E.rows;
+  if (at < 0 || at >= E.numrows) return;
+
+  int first;
+  int k = store_find(s, at, &first);
+  row_page_t *p = s->pages[k];
+  if (p->state != PAGE_RESIDENT) return;   // Its row was read back to be freed
+
+  int i = at - first;
+  memmove(p->rows + i, p->rows + i + 1, sizeof(erow_t) * (p->n - i - 1));
+  p->n --;
+  store_tree_add(s, k, -1);
+  if (s->hint_first >= 0 && k < s->hint) s->hint_first --;
+  E.numrows --;
+
+  if (p->n == 0) store_remove_page(s, k);
+}
+
+/**
+ * @brief Free every page of a store: the rows of resident pages are
+ *        released, and pages that are out let go of their storage.
+ */
+static void store_free(row_store_t *s, bool count) {
+  for (int k = 0; k < s->npages; ++ k) {
+    row_page_t *p = s->pages[k];
+    if (p->state == PAGE_RESIDENT) {
+      for (int i = 0; i < p->n; ++ i) {
+        if (count) editor_free_row(&p->rows[i]);
+        else editor_row_release(&p->rows[i]);
+      }
+    } else {
+      if (count) E.modified_rows -= p->modified;
+      page_drop_storage(p);
+    }
+    zilo_free(MEM_ROW_ARRAY, p->rows);
+    zilo_free(MEM_ROW_ARRAY, p);
+    g_stats.pages --;
+  }
+  zilo_free(MEM_ROW_ARRAY, s->pages);
+  zilo_free(MEM_ROW_ARRAY, s->tree);
+  *s = (row_store_t){ .hint_first = -1 };
+}
+
+/**
+ * @brief Free every row of E, paged out or not (E.modified_rows follows).
+ */
+void editor_rows_clear(void) {
+  store_free(&E.rows, true);
+  E.numrows = 0;
+}
+
+/**
+ * @brief Free the rows of a parked buffer (nothing is counted in E).
+ */
+void editor_rows_free(row_store_t *rows) {
+  store_free(rows, false);
+}
+
+/**
+ * @brief Bytes of the rows of E, one '\n' each, without reading pages back.
+ */
+int64_t editor_rows_bytes(void) {
+  int64_t bytes = 0;
+  for (int k = 0; k < E.rows.npages; ++ k) {
+    row_page_t *p = E.rows.pages[k];
+    if (p->state != PAGE_RESIDENT) {
+      bytes += p->bytes;
+      continue;
+    }
+    for (int i = 0; i < p->n; ++ i) bytes += p->rows[i].size + 1;
+  }
+  return bytes;
+}
+
+/**
+ * @brief Hash of the rows of E as the lines of a file, without reading
+ *        pages back (see page_hash_add()).
+ */
+void editor_rows_hash(lhash_t *text, uint64_t *eol) {
+  *text = (lhash_t){ 0, 1 };
+  *eol = 0;
+  for (int k = 0; k < E.rows.npages; ++ k) {
+    row_page_t *p = E.rows.pages[k];
+    if (p->state != PAGE_RESIDENT) {
+      page_hash_join(text, eol, p->text, p->eol);
+      continue;
+    }
+    for (int i = 0; i < p->n; ++ i) page_hash_add(text, eol, p->rows[i].hash, p->rows[i].origin_crlf);
+  }
+}
+
+/**
+ * @brief Mark the pages a save from offset 0 of the attached file leaves
+ *        where they are: paged to that file, at the offset the save writes
+ *        them to, with '\n' line breaks only. The save skips them, and they
+ *        are not moved to the temp file before it.
+ *
+ * @param size Size of the file before the save, -1 if it is written whole.
+ */
+void editor_rows_keep(int64_t size) {
+  if (size < 0) return;
+
+  struct cold_file *file = editor_page_file();
+  int64_t at = 0;
+  for (int k = 0; k < E.rows.npages; ++ k) {
+    row_page_t *p = E.rows.pages[k];
+    if (p->state == PAGE_RESIDENT) {
+      for (int i = 0; i < p->n; ++ i) at += p->rows[i].size + 1;
+      continue;
+    }
+    p->keep = p->state == PAGE_IN_FILE && p->file == file && p->eol == 0 &&
+              p->pos == at && at + p->len <= size;
+    at += p->bytes;
+  }
+}
+
+/**
+ * @brief If row `at` is the first row of a page editor_rows_keep() left in
+ *        the file, give its rows and bytes (the save skips them).
+ *
+ * @return Returns the bytes of the page, 0 if the row starts no such page.
+ */
+int64_t editor_rows_kept(int at, int *n) {
+  if (at < 0 || at >= E.numrows) return 0;
+
+  int first;
+  int k = store_find(&E.rows, at, &first);
+  row_page_t *p = E.rows.pages[k];
+  if (first != at || !p->keep) return 0;
+  *n = p->n;
+  return p->bytes;
+}
+
+/**
+ * @brief The rows were saved as the lines of the file now attached (`ok`),
+ *        or the save failed.
+ *
+ * The pages that are out are now the clean lines of the file, with '\n'
+ * line breaks, and are read back from it from now on (when a file is
+ * attached); the rows in memory get their new origins.
+ */
+void editor_rows_saved(bool ok) {
+  struct cold_file *file = editor_page_file();
+  int64_t at = 0;
+  for (int k = 0; k < E.rows.npages; ++ k) {
+    row_page_t *p = E.rows.pages[k];
+    bool keep = p->keep;
+    p->keep = false;
+    if (!ok) continue;
+
+    if (p->state == PAGE_RESIDENT) {
+      for (int i = 0; i < p->n; ++ i) {
+        editor_row_set_origin(&p->rows[i], at, false);
+        at += p->rows[i].size + 1;
+      }
+      continue;
+    }
+
+    // Lines of another file (no file to read them from is attached now)
+    // are checked against their own line breaks while they can still be
+    if (!file && p->state == PAGE_IN_FILE && !keep && page_move_to_temp(p) == -1) {
+      // Read back as new rows: written again by the next save
+      E.modified_rows += p->n - p->modified;
+      p->modified = p->n;
+      p->clean = false;
+      at += p->bytes;
+      continue;
+    }
+
+    E.modified_rows -= p->modified;
+    p->modified = 0;
+    p->clean = true;
+    p->file_pos = at;
+    p->eol = 0;
+
+    if (file && !(keep && p->file == file)) {
+      page_drop_storage(p);
+      p->state = PAGE_IN_FILE;
+      p->pos = at;
+      p->len = p->bytes;
+      p->file = file;
+      editor_page_hold(file);
+      page_link_file(p);
+      g_stats.in_file ++;
+    }
+    at += p->bytes;
+  }
+}
+
+/**
+ * @brief Move every page read from `file` to the temp file, whichever
+ *        buffer it belongs to, except those a save under way leaves there.
+ *
+ * @return Returns 0 on success, -1 if a page could not be moved.
+ */
+int editor_pages_detach_file(struct cold_file *file) {
+  int ret = 0;
+  for (row_page_t *p = g_file_pages, *next; p; p = next) {
+    next = p->file_next;
+    if (p->file != file || p->keep) continue;
+    if (page_move_to_temp(p) == -1) ret = -1;
+  }
+  return ret;
+}
+
+/**
+ * @brief A sweep point: the pages read back so far may be dropped again.
+ */
+void editor_pages_unpin(void) {
+  if (++ g_epoch == 0) g_epoch = 1;
+}
+
+/**
+ * @brief Drop pages of E far from the view and the cursor, until row memory
+ *        is back to `target` (second-chance clock over the pages). Pages
+ *        read back since the last sweep and the last page (where a load
+ *        appends) stay.
+ *
+ * @return Returns the number of pages dropped.
+ */
+int editor_pages_trim(int64_t target) {
+  row_store_t *s = &E.rows;
+  if (!editor_page_enabled() || s->npages < 2) return 0;
+
+  int64_t resident = editor_cold_resident();
+  int visits = 2 * s->npages;
+  int dropped = 0;
+  while (resident > target && visits -- > 0) {
+    if (s->hand >= s->npages) s->hand = 0;
+    int k = s->hand ++;
+    row_page_t *p = s->pages[k];
+    if (p->state != PAGE_RESIDENT || p->pinned == g_epoch || k == s->npages - 1) continue;
+    if (p->used) {
+      p->used = false;
+      continue;
+    }
+    if (page_near_view(store_tree_prefix(s, k), p->n)) continue;
+
+    if (page_out(p) == -1) break;
+    dropped ++;
+    resident = editor_cold_resident();
+  }
+
+  if (dropped > 0) {
+    LOG_DEBUG("editor_pages_trim", "Dropped %d pages of rows, row memory now %lld bytes.",
+              dropped, (long long)resident);
+  }
+  return dropped;
+}
+
+/**
+ * @brief Snapshot the counters.
+ */
+void editor_pages_stats(page_stats_t *out) {
+  *out = g_stats;
+}
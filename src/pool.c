@@ -0,0 +1,481 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "pool.h"
+#include "logger.h"
+#include "mem.h"
+#include "trace.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+ * Work-stealing pool. Every worker owns a deque: it pushes and pops its own
+ * jobs at the tail (newest first, cache-warm), while idle workers steal from
+ * the head of the others (oldest first, usually the largest piece of work).
+ * Jobs submitted by the main thread are dealt round-robin over the deques.
+ *
+ * Workers never touch the editor state. Results come back to the main
+ * thread through two lists (progress and completions) and a pipe that wakes
+ * the main loop; pool_dispatch() then runs the callbacks there.
+ */
+
+#define POOL_MAX_WORKERS 8
+#define POOL_DEQUE_INIT  64
+
+struct pool_token {
+  atomic_int refs;
+  atomic_bool cancelled;
+};
+
+struct pool_job {
+  pool_work_fn work;
+  pool_progress_fn progress;
+  pool_done_fn done;
+  void *arg;
+  pool_token_t *token;
+  int status;
+
+  atomic_llong progress_done;
+  atomic_llong progress_total;
+  atomic_bool progress_posted;    // Already in the progress list
+
+  pool_job_t *next_done;          // Completion list
+  pool_job_t *next_progress;      // Progress list
+};
+
+typedef struct {
+  pthread_mutex_t lock;
+  pool_job_t **jobs;              // Ring buffer
+  int head;                       // Oldest job (stolen first)
+  int count;
+  int cap;
+} pool_deque_t;
+
+typedef struct {
+  pthread_t thread;
+  pool_deque_t deque;
+} pool_worker_t;
+
+static pool_worker_t g_workers[POOL_MAX_WORKERS];
+static int g_nworkers = 0;             // Deques (fixed while the pool runs)
+static int g_nthreads = 0;             // Workers actually started
+static int g_next_worker = 0;         // Round-robin target of the main thread
+static atomic_bool g_stop;
+static atomic_int g_queued;           // Jobs waiting in a deque
+static atomic_int g_busy;             // Jobs submitted and not yet dispatched
+
+static pthread_mutex_t g_sleep_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_sleep_cond = PTHREAD_COND_INITIALIZER;
+
+// Results waiting for the main thread
+static pthread_mutex_t g_post_lock = PTHREAD_MUTEX_INITIALIZER;
+static pool_job_t *g_done_list = NULL;
+static pool_job_t *g_progress_list = NULL;
+static int g_wake[2] = { -1, -1 };
+static atomic_bool g_wake_pending;
+
+static __thread int t_worker = -1;    // Index of the calling worker (-1 elsewhere)
+
+/*------------------------------------------
+              CANCELLATION TOKENS
+ ------------------------------------------*/
+/**
+ * @brief Create a cancellation token.
+ *
+ * @return Returns the token with one reference (NULL on failure).
+ */
+pool_token_t *pool_token_new(void) {
+  pool_token_t *token = zilo_malloc(MEM_POOL, sizeof(pool_token_t));
+  if (!token) return NULL;
+
+  atomic_init(&token->refs, 1);
+  atomic_init(&token->cancelled, false);
+  return token;
+}
+
+/**
+ * @brief Ask every job holding `token` to stop.
+ *
+ * Cancellation is cooperative: a job that has not started is skipped, a
+ * running one stops at its next pool_job_cancelled() check.
+ */
+void pool_token_cancel(pool_token_t *token) {
+  if (token) atomic_store_explicit(&token->cancelled, true, memory_order_release);
+}
+
+/**
+ * @brief True once the token was cancelled.
+ */
+bool pool_token_cancelled(const pool_token_t *token) {
+  return token && atomic_load_explicit(&token->cancelled, memory_order_acquire);
+}
+
+static void pool_token_retain(pool_token_t *token) {
+  if (token) atomic_fetch_add_explicit(&token->refs, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Drop a reference to the token (freed with the last one).
+ */
+void pool_token_release(pool_token_t *token) {
+  if (token && atomic_fetch_sub_explicit(&token->refs, 1, memory_order_acq_rel) == 1) {
+    zilo_free(MEM_POOL, token);
+  }
+}
+
+/*------------------------------------------
+                  DEQUES
+ ------------------------------------------*/
+static int deque_push(pool_deque_t *dq, pool_job_t *job) {
+  pthread_mutex_lock(&dq->lock);
+  if (dq->count == dq->cap) {
+    int cap = dq->cap ? dq->cap * 2 : POOL_DEQUE_INIT;
+    pool_job_t **jobs = zilo_malloc(MEM_POOL, sizeof(pool_job_t *) * cap);
+    if (!jobs) {
+      pthread_mutex_unlock(&dq->lock);
+      return -1;
+    }
+    for (int i = 0; i < dq->count; ++ i) jobs[i] = dq->jobs[(dq->head + i) % dq->cap];
+    zilo_free(MEM_POOL, dq->jobs);
+    dq->jobs = jobs;
+    dq->head = 0;
+    dq->cap = cap;
+  }
+
+  dq->jobs[(dq->head + dq->count) % dq->cap] = job;
+  dq->count ++;
+  pthread_mutex_unlock(&dq->lock);
+  return 0;
+}
+
+/**
+ * @brief Take the newest job (owner) or the oldest one (thief).
+ */
+static pool_job_t *deque_take(pool_deque_t *dq, bool steal) {
+  pool_job_t *job = NULL;
+
+  pthread_mutex_lock(&dq->lock);
+  if (dq->count > 0) {
+    if (steal) {
+      job = dq->jobs[dq->head];
+      dq->head = (dq->head + 1) % dq->cap;
+    } else {
+      job = dq->jobs[(dq->head + dq->count - 1) % dq->cap];
+    }
+    dq->count --;
+  }
+  pthread_mutex_unlock(&dq->lock);
+
+  return job;
+}
+
+/*------------------------------------------
+                  WORKERS
+ ------------------------------------------*/
+static void pool_wake_main(void) {
+  if (atomic_exchange(&g_wake_pending, true)) return;
+
+  char c = 1;
+  if (write(g_wake[1], &c, 1) == -1 && errno != EAGAIN) {
+    LOG_ERROR("write", "Failed to wake the main loop.");
+  }
+}
+
+/**
+ * @brief Find a job: the worker's own deque first, then steal.
+ */
+static pool_job_t *pool_find_job(int self) {
+  pool_job_t *job = deque_take(&g_workers[self].deque, false);
+  for (int k = 1; !job && k < g_nworkers; ++ k) {
+    job = deque_take(&g_workers[(self + k) % g_nworkers].deque, true);
+  }
+  if (job) atomic_fetch_sub(&g_queued, 1);
+  return job;
+}
+
+static void pool_run_job(pool_job_t *job) {
+  TRACE_SPAN("pool_job");
+
+  if (pool_job_cancelled(job)) job->status = POOL_CANCELLED;
+  else job->status = job->work(job, job->arg);
+
+  if (pool_token_cancelled(job->token)) job->status = POOL_CANCELLED;
+
+  pthread_mutex_lock(&g_post_lock);
+  job->next_done = g_done_list;
+  g_done_list = job;
+  pthread_mutex_unlock(&g_post_lock);
+
+  pool_wake_main();
+}
+
+static void *pool_worker_main(void *arg) {
+  int self = (int)(intptr_t)arg;
+  t_worker = self;
+
+  while (!atomic_load(&g_stop)) {
+    pool_job_t *job = pool_find_job(self);
+    if (job) {
+      pool_run_job(job);
+      continue;
+    }
+
+    pthread_mutex_lock(&g_sleep_lock);
+    while (atomic_load(&g_queued) == 0 && !atomic_load(&g_stop)) {
+      pthread_cond_wait(&g_sleep_cond, &g_sleep_lock);
+    }
+    pthread_mutex_unlock(&g_sleep_lock);
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Start the workers (one per CPU but one, at most POOL_MAX_WORKERS).
+ *
+ * ZILO_POOL_THREADS=n overrides the number of workers.
+ *
+ * @return Returns 0 on success, -1 on failure.
+ */
+static int pool_start(void) {
+  if (pipe(g_wake) == -1) {
+    LOG_ERROR("pipe", "Failed to create the pool wake pipe.");
+    return -1;
+  }
+  for (int i = 0; i < 2; ++ i) {
+    fcntl(g_wake[i], F_SETFL, fcntl(g_wake[i], F_GETFL) | O_NONBLOCK);
+    fcntl(g_wake[i], F_SETFD, FD_CLOEXEC);
+  }
+
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int n = cpus > 1 ? cpus - 1 : 1;
+  const char *env = getenv("ZILO_POOL_THREADS");
+  if (env && atoi(env) > 0) n = atoi(env);
+  if (n > POOL_MAX_WORKERS) n = POOL_MAX_WORKERS;
+
+  atomic_init(&g_stop, false);
+  atomic_init(&g_queued, 0);
+  atomic_init(&g_busy, 0);
+  atomic_init(&g_wake_pending, false);
+
+  // Every deque exists before any worker runs; the deque of a worker that
+  // failed to start is still drained by the others
+  for (int i = 0; i < n; ++ i) pthread_mutex_init(&g_workers[i].deque.lock, NULL);
+  g_nworkers = n;
+
+  for (int i = 0; i < n; ++ i) {
+    if (pthread_create(&g_workers[i].thread, NULL, pool_worker_main, (void *)(intptr_t)i) != 0) {
+      LOG_ERROR("pthread_create", "Failed to start pool worker %d.", i);
+      break;
+    }
+    g_nthreads ++;
+  }
+
+  if (g_nthreads == 0) {
+    for (int i = 0; i < n; ++ i) pthread_mutex_destroy(&g_workers[i].deque.lock);
+    g_nworkers = 0;
+    close(g_wake[0]);
+    close(g_wake[1]);
+    g_wake[0] = g_wake[1] = -1;
+    return -1;
+  }
+
+  LOG_INFO("pool_start", "Started %d pool workers.", g_nthreads);
+  return 0;
+}
+
+/*------------------------------------------
+              PUBLIC INTERFACE
+ ------------------------------------------*/
+/**
+ * @brief Queue a job.
+ *
+ * A job submitted from a worker goes to that worker's deque, so jobs that
+ * split themselves stay local unless another worker runs dry.
+ *
+ * @param token    Cancellation token (retained by the job, may be NULL).
+ * @param work     Job body (worker thread).
+ * @param progress Progress callback (main thread, may be NULL).
+ * @param done     Completion (main thread, may be NULL).
+ * @param arg      Passed to the three callbacks.
+ *
+ * @return Returns 0 on success, -1 on failure (no callback will run).
+ */
+int pool_submit(pool_token_t *token, pool_work_fn work,
+                pool_progress_fn progress, pool_done_fn done, void *arg) {
+  if (g_nworkers == 0 && pool_start() == -1) return -1;
+
+  pool_job_t *job = zilo_malloc(MEM_POOL, sizeof(pool_job_t));
+  if (!job) return -1;
+
+  job->work = work;
+  job->progress = progress;
+  job->done = done;
+  job->arg = arg;
+  job->token = token;
+  job->status = 0;
+  atomic_init(&job->progress_done, 0);
+  atomic_init(&job->progress_total, 0);
+  atomic_init(&job->progress_posted, false);
+  job->next_done = NULL;
+  job->next_progress = NULL;
+
+  int target = t_worker;
+  if (target == -1) target = g_next_worker ++ % g_nworkers;
+
+  // Counted before it becomes visible: a thief may finish it before push returns
+  pool_token_retain(token);
+  atomic_fetch_add(&g_busy, 1);
+  if (deque_push(&g_workers[target].deque, job) == -1) {
+    atomic_fetch_sub(&g_busy, 1);
+    pool_token_release(token);
+    zilo_free(MEM_POOL, job);
+    return -1;
+  }
+  atomic_fetch_add(&g_queued, 1);
+
+  pthread_mutex_lock(&g_sleep_lock);
+  pthread_cond_signal(&g_sleep_cond);
+  pthread_mutex_unlock(&g_sleep_lock);
+  return 0;
+}
+
+/**
+ * @brief True if the job should return early (token cancelled or pool stopping).
+ */
+bool pool_job_cancelled(const pool_job_t *job) {
+  return atomic_load_explicit(&g_stop, memory_order_relaxed) || pool_token_cancelled(job->token);
+}
+
+/**
+ * @brief Report how far a job got.
+ *
+ * Cheap enough to call often: only the first report after the main thread
+ * consumed the previous one wakes it up.
+ */
+void pool_job_progress(pool_job_t *job, int64_t done, int64_t total) {
+  atomic_store_explicit(&job->progress_done, done, memory_order_relaxed);
+  atomic_store_explicit(&job->progress_total, total, memory_order_relaxed);
+  if (!job->progress || atomic_exchange(&job->progress_posted, true)) return;
+
+  pthread_mutex_lock(&g_post_lock);
+  job->next_progress = g_progress_list;
+  g_progress_list = job;
+  pthread_mutex_unlock(&g_post_lock);
+
+  pool_wake_main();
+}
+
+/**
+ * @brief File descriptor to poll next to the terminal.
+ */
+int pool_wake_fd(void) {
+  return g_wake[0];
+}
+
+/**
+ * @brief Run pending progress and completion callbacks (main thread).
+ *
+ * Both lists are taken under the same lock: a job's last progress report is
+ * always delivered before (or with) its completion, and never after the job
+ * was freed.
+ *
+ * @return Returns the number of callbacks that ran.
+ */
+int pool_dispatch(void) {
+  if (g_nworkers == 0) return 0;
+
+  atomic_store(&g_wake_pending, false);
+  char buf[64];
+  while (read(g_wake[0], buf, sizeof(buf)) > 0) {}
+
+  pthread_mutex_lock(&g_post_lock);
+  pool_job_t *progress = g_progress_list;
+  pool_job_t *done = g_done_list;
+  g_progress_list = NULL;
+  g_done_list = NULL;
+  pthread_mutex_unlock(&g_post_lock);
+
+  int ran = 0;
+  while (progress) {
+    pool_job_t *job = progress;
+    progress = job->next_progress;
+
+    // Once cleared, the worker may link the job into the next list
+    atomic_store(&job->progress_posted, false);
+    if (pool_token_cancelled(job->token)) continue;
+
+    job->progress(job->arg, atomic_load(&job->progress_done), atomic_load(&job->progress_total));
+    ran ++;
+  }
+
+  while (done) {
+    pool_job_t *job = done;
+    done = job->next_done;
+
+    if (job->done) {
+      job->done(job->arg, job->status);
+      ran ++;
+    }
+    pool_token_release(job->token);
+    zilo_free(MEM_POOL, job);
+    atomic_fetch_sub(&g_busy, 1);
+  }
+
+  return ran;
+}
+
+/**
+ * @brief Number of jobs queued or running (or waiting for dispatch).
+ */
+int pool_busy(void) {
+  return g_nworkers ? atomic_load(&g_busy) : 0;
+}
+
+/**
+ * @brief Cancel every job, wait for the workers and deliver what is left.
+ *
+ * Every submitted job still gets exactly one completion: jobs that never
+ * ran complete with POOL_CANCELLED, so their owners can free `arg`.
+ */
+void pool_shutdown(void) {
+  if (g_nworkers == 0) return;
+
+  pthread_mutex_lock(&g_sleep_lock);
+  atomic_store(&g_stop, true);
+  pthread_cond_broadcast(&g_sleep_cond);
+  pthread_mutex_unlock(&g_sleep_lock);
+
+  for (int i = 0; i < g_nthreads; ++ i) pthread_join(g_workers[i].thread, NULL);
+
+  for (int i = 0; i < g_nworkers; ++ i) {
+    pool_deque_t *dq = &g_workers[i].deque;
+    pool_job_t *job;
+    while ((job = deque_take(dq, true))) {
+      if (job->done) job->done(job->arg, POOL_CANCELLED);
+      pool_token_release(job->token);
+      zilo_free(MEM_POOL, job);
+    }
+    zilo_free(MEM_POOL, dq->jobs);
+    pthread_mutex_destroy(&dq->lock);
+    *dq = (pool_deque_t){ 0 };
+  }
+
+  while (g_done_list) {
+    pool_job_t *job = g_done_list;
+    g_done_list = job->next_done;
+    if (job->done) job->done(job->arg, job->status);
+    pool_token_release(job->token);
+    zilo_free(MEM_POOL, job);
+  }
+  g_progress_list = NULL;
+
+  close(g_wake[0]);
+  close(g_wake[1]);
+  g_wake[0] = g_wake[1] = -1;
+  g_nworkers = 0;
+  g_nthreads = 0;
+}
@@ -0,0 +1,256 @@
+#define _XOPEN_SOURCE 600
+#include "replay.h"
+#include "file.h"
+#include "input.h"
+#include "logger.h"
+#include "output.h"
+#include "stats.h"
+#include "zilo.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Key trace format (text, one key per line):
+ *
+ *   # zilo keytrace v1 rows=<R> cols=<C>
+ *   <microseconds since start> <key byte>
+ *   ...
+ */
+
+#define TRACE_HEADER "# zilo keytrace v1"
+
+/*------------------------------------------
+                RECORD
+ ------------------------------------------*/
+static FILE *g_record_fp = NULL;
+static int64_t g_record_origin_ns = 0;
+
+/**
+ * @brief Start recording every key read from the terminal.
+ *
+ * @param path Trace file (truncated).
+ *
+ * @return Returns 0 on success, -1 on error.
+ */
+int editor_record_start(const char *path) {
+  g_record_fp = fopen(path, "w");
+  if (!g_record_fp) {
+    LOG_ERROR("fopen", "Failed to open the key trace <%s>.", path);
+    return -1;
+  }
+
+  g_record_origin_ns = editor_stats_now();
+  fprintf(g_record_fp, TRACE_HEADER " rows=%d cols=%d\n", E.screenrows, E.screencols);
+  fflush(g_record_fp);
+  return 0;
+}
+
+/**
+ * @brief Append one key to the recording.
+ *
+ * Keys arrive at human speed, so each one is flushed to survive a crash.
+ *
+ * @param c The key.
+ */
+void editor_record_key(char c) {
+  if (!g_record_fp) return;
+
+  fprintf(g_record_fp, "%lld %d\n",
+          (long long)((editor_stats_now() - g_record_origin_ns) / 1000),
+          (unsigned char)c);
+  fflush(g_record_fp);
+}
+
+/**
+ * @brief Stop recording and close the trace file.
+ */
+void editor_record_stop(void) {
+  if (!g_record_fp) return;
+
+  fclose(g_record_fp);
+  g_record_fp = NULL;
+}
+
+/*------------------------------------------
+                REPLAY
+ ------------------------------------------*/
+typedef struct {
+  int64_t t_us;
+  char key;
+} trace_key_t;
+
+/**
+ * @brief Load a key trace.
+ *
+ * @return Returns the keys (to be freed), or NULL on error.
+ */
+static trace_key_t *load_trace(const char *path, int *nkeys, int *rows, int *cols) {
+  FILE *fp = fopen(path, "r");
+  if (!fp) return NULL;
+
+  char line[128];
+  if (!fgets(line, sizeof(line), fp) ||
+      strncmp(line, TRACE_HEADER, strlen(TRACE_HEADER)) ||
+      sscanf(line + strlen(TRACE_HEADER), " rows=%d cols=%d", rows, cols) != 2) {
+    fclose(fp);
+    return NULL;
+  }
+
+  trace_key_t *keys = NULL;
+  int n = 0, cap = 0;
+  long long t;
+  int key;
+  while (fgets(line, sizeof(line), fp)) {
+    if (sscanf(line, "%lld %d", &t, &key) != 2) continue;
+    if (n == cap) {
+      cap = cap ? cap * 2 : 256;
+      trace_key_t *new = realloc(keys, sizeof(trace_key_t) * cap);
+      if (!new) {
+        free(keys);
+        fclose(fp);
+        return NULL;
+      }
+      keys = new;
+    }
+    keys[n ++] = (trace_key_t){ t, (char)key };
+  }
+
+  fclose(fp);
+  *nkeys = n;
+  return keys;
+}
+
+// Drains the pseudo-terminal master and counts what the editor wrote
+typedef struct {
+  int fd;
+  int64_t bytes;
+} pty_sink_t;
+
+static void *pty_sink_main(void *arg) {
+  pty_sink_t *sink = arg;
+  char buf[65536];
+  ssize_t n;
+  while ((n = read(sink->fd, buf, sizeof(buf))) > 0) sink->bytes += n;
+  return NULL;
+}
+
+static int64_t cpu_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void sleep_until(int64_t deadline_ns) {
+  int64_t now = editor_stats_now();
+  if (deadline_ns <= now) return;
+
+  struct timespec ts = {
+    .tv_sec = (deadline_ns - now) / 1000000000,
+    .tv_nsec = (deadline_ns - now) % 1000000000
+  };
+  nanosleep(&ts, NULL);
+}
+
+/**
+ * @brief Replay a key trace and report what it cost.
+ *
+ * The editor draws into a pseudo-terminal of the recorded size whose output
+ * is drained and counted by a sink thread. Every key goes through
+ * editor_process_key() followed by editor_refresh_screen(); the time of
+ * that pair is the key's latency. With `timed` the recorded gaps between
+ * keys are kept, otherwise keys are fed back to back.
+ *
+ * The file is edited (and saved on Ctrl+S) exactly as in the recorded
+ * session, so replay against a copy.
+ *
+ * @param trace    Key trace.
+ * @param filename File to open.
+ * @param timed    Keep the recorded timing.
+ *
+ * @return Returns 0 on success, 1 on error.
+ */
+int editor_replay(const char *trace, char *filename, bool timed) {
+  int nkeys, rows, cols;
+  trace_key_t *keys = load_trace(trace, &nkeys, &rows, &cols);
+  if (!keys) {
+    fprintf(stderr, "zilo: cannot read key trace <%s>\n", trace);
+    return 1;
+  }
+
+  // Pseudo-terminal sink of the recorded size
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master == -1 || grantpt(master) == -1 || unlockpt(master) == -1) {
+    fprintf(stderr, "zilo: cannot allocate a pseudo-terminal\n");
+    free(keys);
+    return 1;
+  }
+  int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+  if (slave == -1) {
+    fprintf(stderr, "zilo: cannot open the pseudo-terminal\n");
+    close(master);
+    free(keys);
+    return 1;
+  }
+  struct winsize ws = { .ws_row = rows + 1, .ws_col = cols };
+  ioctl(slave, TIOCSWINSZ, &ws);
+
+  pty_sink_t sink = { master, 0 };
+  pthread_t sink_thread;
+  pthread_create(&sink_thread, NULL, pty_sink_main, &sink);
+
+  int saved_stdout = dup(STDOUT_FILENO);
+  dup2(slave, STDOUT_FILENO);
+
+  init_editor();
+  E.screenrows = rows;
+  E.screencols = cols;
+  E.headless = true;
+  editor_open(filename);
+  editor_refresh_screen();
+
+  static hist_t latency;
+  int64_t wall_start = editor_stats_now();
+  int64_t cpu_start = cpu_ns();
+  int replayed = 0;
+
+  for (int i = 0; i < nkeys && !E.quit; ++ i) {
+    if (timed) sleep_until(wall_start + keys[i].t_us * 1000);
+
+    int64_t t0 = editor_stats_now();
+    editor_process_key(keys[i].key);
+    editor_refresh_screen();
+    hist_record(&latency, editor_stats_now() - t0);
+    replayed ++;
+  }
+
+  int64_t cpu = cpu_ns() - cpu_start;
+  int64_t wall = editor_stats_now() - wall_start;
+
+  // Close the slave side so the sink sees EOF once everything is drained
+  dup2(saved_stdout, STDOUT_FILENO);
+  close(saved_stdout);
+  close(slave);
+  pthread_join(sink_thread, NULL);
+  close(master);
+
+  printf("keys=%d cpu_ms=%.3f wall_ms=%.3f output_bytes=%lld bytes_per_key=%.1f "
+         "latency_us p50=%.1f p90=%.1f p99=%.1f max=%.1f\n",
+         replayed, cpu / 1e6, wall / 1e6, (long long)sink.bytes,
+         replayed ? (double)sink.bytes / replayed : 0.0,
+         hist_percentile(&latency, 50) / 1e3,
+         hist_percentile(&latency, 90) / 1e3,
+         hist_percentile(&latency, 99) / 1e3,
+         latency.max / 1e3);
+
+  free_editor();
+  free(keys);
+  return 0;
+}
@@ -1,9 +1,87 @@
+#define ZILO_LOG_MODULE LOG_MODULE_EDIT
 #include "row.h"
+#include "cold.h"
+#include "intern.h"
+#include "lline.h"
 #include "logger.h"
+#include "mem.h"
+#include "page.h"
+#include "syntax.h"
+#include "utf8.h"
+#include "wrap.h"
 #include "zilo.h"
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#define ROW_HASH_LONG LLINE_FLATTEN   // Lines of this many bytes or more hash as a long row does
+
+/**
+ * @brief Mix the length of a long line into its polynomial hash.
+ */
+static inline uint64_t row_hash_long(uint64_t poly, size_t len) {
+  uint64_t h = (len ^ poly) * 0x9e3779b97f4a7c15ULL;
+  return h ^ (h >> 31);
+}
+
+/**
+ * @brief Initialize the row object `row` with a copy of the string `s`.
+ *
+ * The derived data (render cache, highlighting) is built by 'editor_update_row()'.
+ * Rows of at most ROW_INLINE_MAX bytes are stored inside the row object and
+ * rows longer than LLINE_THRESHOLD are stored in chunks (see lline.h). With
+ * E.intern set, the other rows share one payload per distinct content.
+ *
+ * @param row Row object.
+ * @param s   The string on the row.
+ * @param len String length.
+ */
+int editor_row_init(erow_t *row, char *s, size_t len) {
+  row->size = len;
+  row->is_inline = false;
+  row->is_shared = false;
+  row->is_cold = false;
+  row->origin_crlf = false;
+  row->chars = NULL;
+  row->ll = NULL;
+  row->origin = -1;
+  row->hash = 0;        // Set by editor_update_row()
+  row->file_hash = 0;   // Not a line of the file until editor_row_set_origin()
+
+  if (len <= ROW_INLINE_MAX) {
+    row->is_inline = true;
+    memcpy(row->buf, s, len);
+    row->buf[len] = '\0';
+  } else if (len > LLINE_THRESHOLD) {
+    row->ll = lline_new(s, len);
+  } else if (E.intern) {
+    row->chars = intern_get(s, len);
+    row->is_shared = row->chars != NULL;
+  }
+
+  if (!row->is_inline && !row->ll && !row->is_shared) {
+    // Copy string to `chars`
+    row->chars = zilo_malloc(MEM_ROWS, len + 1);
+    if (!row->chars) {
+      LOG_ERROR("malloc", "Failed to allocate memory.");
+      return -1;
+    }
+    memcpy(row->chars, s, len);
+    row->chars[len] = '\0';
+  }
+
+  row->rsize = 0;
+  row->render = NULL;
+  row->cx2rx = NULL;
+  row->cx2rb = NULL;
+
+  row->hl = NULL;
+  row->hl_count = 0;
+  row->hl_state = HL_STATE_UNKNOWN;
+  return 0;
+}
+
 /**
  * @brief  Append the string `s` (length `len`) as a new line to the end of the editor.
  *
@@ -11,30 +89,534 @@
  * @param len String length.
  */
 void editor_append_row(char *s, size_t len) {
-  // Expand memory size
-  erow_t *new = realloc(E.row, sizeof(erow_t) * (E.numrows + 1));
-  if (!new) LOG_ERROR("realloc", "Failed to expand memory.");
-  E.row = new;
-   
-  // Copy string to `chars`
-  E.row[E.numrows].chars = malloc(len + 1);
-  memcpy(E.row[E.numrows].chars, s, len);
-  E.row[E.numrows].chars[len] = '\0';
+  erow_t row;
+  if (editor_row_init(&row, s, len) == -1) return;
+  if (editor_rows_insert(E.numrows, &row) == -1) {
+    editor_row_release(&row);
+    return;
+  }
 
   // Update
-  E.row[E.numrows].size = len;
-  E.numrows ++;
+  E.modified_rows ++;
+  editor_wrap_insert_row(E.numrows - 1);
+
+  editor_update_row(editor_row_at(E.numrows - 1));
+}
+
+/**
+ * @brief Make the rows already loaded share their payloads (`:set intern`).
+ *
+ * Pages that are out are left as they are: their rows are new rows, which
+ * share their payloads when they are read back.
+ *
+ * @return Returns the number of rows pointing at a shared payload.
+ */
+int editor_intern_rows(void) {
+  int shared = 0;
+  for (int i = 0; i < E.numrows; ++ i) {
+    erow_t *row = editor_row_peek(i);
+    if (!row) {
+      i = editor_row_page_end(i) - 1;
+      continue;
+    }
+    if (row->is_inline || row->is_cold || row->ll) continue;
+
+    if (!row->is_shared) {
+      char *chars = intern_get(row->chars, row->size);
+      if (!chars) break;
+      zilo_free(MEM_ROWS, row->chars);
+      row->chars = chars;
+      row->is_shared = true;
+    }
+    shared ++;
+  }
+  return shared;
+}
+
+/**
+ * @brief Measure the character at `chars[j]` placed at display column `rx`.
+ *
+ * @param row   Row object.
+ * @param j     Byte offset of the character.
+ * @param rx    Display column of the character.
+ * @param width Display width (tab stops, "^X" escapes, wide and combining characters).
+ * @param rlen  Number of bytes the character takes in the render buffer.
+ *
+ * @return Returns the length of the character in `chars`.
+ */
+static int render_measure(const erow_t *row, int j, int rx, int *width, int *rlen) {
+  const char *chars = editor_row_chars(row);
+  unsigned char c = chars[j];
+
+  if (c == '\t') {
+    *width = *rlen = ZILO_TAB_STOP - (rx % ZILO_TAB_STOP);
+    return 1;
+  }
+  if (c < 32 || c == 127) {
+    *width = *rlen = 2; // "^X"
+    return 1;
+  }
+  if (c < 0x80) {
+    *width = *rlen = 1;
+    return 1;
+  }
+
+  uint32_t cp;
+  int n = utf8_decode(chars + j, row->size - j, &cp);
+  if (n == 1) {
+    // Invalid byte: shown as U+FFFD
+    *width = 1;
+    *rlen = sizeof(UTF8_REPLACEMENT_BYTES) - 1;
+    return 1;
+  }
+  *width = utf8_width(cp);
+  *rlen = n;
+  return n;
+}
+
+/**
+ * @brief Rebuild the render cache and the display-width index of a row.
+ *
+ * Tabs are expanded to the next tab stop, control bytes are shown as "^X"
+ * and invalid UTF-8 bytes as U+FFFD. `cx2rx` maps every byte offset to the
+ * display column of the character containing it (combining marks share the
+ * column of their base character), so it is non-decreasing and can be
+ * binary searched.
+ *
+ * Printable ASCII rows (the common case, checked with SIMD) keep `render`,
+ * `cx2rx` and `cx2rb` NULL and cost nothing. Rows whose bytes render as-is
+ * (valid UTF-8 without tabs or control bytes) only get `cx2rx`.
+ *
+ * @param row Row object.
+ */
+static void editor_update_render(erow_t *row) {
+  zilo_free(MEM_RENDER, row->render);
+  zilo_free(MEM_RENDER, row->cx2rx);
+  zilo_free(MEM_RENDER, row->cx2rb);
+  row->render = NULL;
+  row->cx2rx = NULL;
+  row->cx2rb = NULL;
+  row->rsize = row->size;
+
+  // Long rows have no render cache: only the visible slice is rendered
+  if (row->ll) {
+    row->rsize = 0;
+    return;
+  }
+
+  const char *chars = editor_row_chars(row);
+  if (utf8_is_plain_ascii(chars, row->size)) return;
+
+  // Pass 1: size the render buffer
+  int rsize = 0;
+  int rx = 0;
+  bool verbatim = true;
+  for (int j = 0; j < row->size; ) {
+    int width, rlen;
+    int n = render_measure(row, j, rx, &width, &rlen);
+    if (rlen != n || chars[j] == '\t' || (unsigned char)chars[j] < 32) verbatim = false;
+    rx += width;
+    rsize += rlen;
+    j += n;
+  }
+
+  row->cx2rx = zilo_malloc(MEM_RENDER, sizeof(int) * (row->size + 1));
+  if (!verbatim) {
+    row->render = zilo_malloc(MEM_RENDER, rsize + 1);
+    row->cx2rb = zilo_malloc(MEM_RENDER, sizeof(int) * (row->size + 1));
+  }
+  if (!row->cx2rx || (!verbatim && (!row->render || !row->cx2rb))) {
+    LOG_ERROR("malloc", "Failed to allocate render cache.");
+    zilo_free(MEM_RENDER, row->render);
+    zilo_free(MEM_RENDER, row->cx2rx);
+    zilo_free(MEM_RENDER, row->cx2rb);
+    row->render = NULL;
+    row->cx2rx = NULL;
+    row->cx2rb = NULL;
+    return;
+  }
+
+  // Pass 2: fill the render buffer and the indexes
+  int rb = 0;
+  int base_rx = 0;
+  rx = 0;
+  for (int j = 0; j < row->size; ) {
+    unsigned char c = chars[j];
+    int width, rlen;
+    int n = render_measure(row, j, rx, &width, &rlen);
+
+    // Zero-width characters belong to the character before them
+    int col = (width == 0 && j > 0) ? base_rx : rx;
+    for (int k = 0; k < n; ++ k) {
+      row->cx2rx[j + k] = col;
+      if (row->cx2rb) row->cx2rb[j + k] = rb;
+    }
+
+    if (row->render) {
+      if (c == '\t') {
+        memset(row->render + rb, ' ', rlen);
+      } else if (c < 32 || c == 127) {
+        row->render[rb] = '^';
+        row->render[rb + 1] = c == 127 ? '?' : c + '@';
+      } else if (rlen != n) {
+        memcpy(row->render + rb, UTF8_REPLACEMENT_BYTES, rlen);
+      } else {
+        memcpy(row->render + rb, chars + j, n);
+      }
+    }
+
+    if (width > 0 || j == 0) base_rx = rx;
+    rx += width;
+    rb += rlen;
+    j += n;
+  }
+  row->cx2rx[row->size] = rx;
+  if (row->cx2rb) row->cx2rb[row->size] = rb;
+  if (row->render) row->render[rb] = '\0';
+  row->rsize = rb;
+}
+
+/**
+ * @brief Switch a row between flat and chunked storage when its size crosses
+ *        the thresholds (with hysteresis, so this happens rarely).
+ *
+ * @param row Row object.
+ */
+static void editor_row_check_storage(erow_t *row) {
+  if (!row->ll && row->size > LLINE_THRESHOLD) {
+    lline_t *ll = lline_new(row->chars, row->size);
+    if (!ll) {
+      LOG_ERROR("lline_new", "Failed to switch a row to long-line mode.");
+      return;
+    }
+    zilo_free(MEM_ROWS, row->chars);
+    row->chars = NULL;
+    row->ll = ll;
+  }
+  else if (row->ll && row->size < LLINE_FLATTEN) {
+    char *chars = zilo_malloc(MEM_ROWS, row->size + 1);
+    if (!chars) {
+      LOG_ERROR("malloc", "Failed to flatten a long row.");
+      return;
+    }
+    lline_read(row->ll, 0, row->size, chars);
+    chars[row->size] = '\0';
+    lline_free(row->ll);
+    row->ll = NULL;
+    row->chars = chars;
+  }
+}
+
+/**
+ * @brief Hash of `len` bytes of a line, as kept in `row->hash`.
+ *
+ * A line of ROW_HASH_LONG bytes or more gets the polynomial hash a long row
+ * keeps up to date chunk by chunk (see lline.h), so the value does not
+ * depend on how the row is stored and an edit of a long row does not hash
+ * it again from the start.
+ */
+uint64_t editor_hash_line(const char *s, size_t len) {
+  if (len < ROW_HASH_LONG) return intern_hash(s, len);
+  return row_hash_long(lline_hash_bytes(s, len), len);
+}
+
+/**
+ * @brief Hash the bytes of a flat or chunked row (O(1) for a chunked one).
+ */
+static uint64_t editor_row_compute_hash(const erow_t *row) {
+  if (!row->ll) return editor_hash_line(editor_row_chars(row), row->size);
+  return row_hash_long(lline_hash(row->ll), row->size);
+}
+
+/**
+ * @brief Record that the row is the line at `origin` of the file (it was
+ *        just loaded from there, or saved there).
+ *
+ * @param crlf The line ends with "\r\n" in the file.
+ */
+void editor_row_set_origin(erow_t *row, int64_t origin, bool crlf) {
+  if (!editor_row_in_file(row)) E.modified_rows --;
+  row->origin = origin;
+  row->origin_crlf = crlf;
+  row->file_hash = row->hash;
+}
+
+/**
+ * @brief Refresh the derived data of a row after its content changed.
+ *
+ * The render cache and the visual-line count are rebuilt for this row only.
+ * Only the edited row is re-lexed; the rows below it are visited only while
+ * their lexer state keeps changing.
+ *
+ * @param row Pointer to row object (must be a row of E).
+ */
+void editor_update_row(erow_t *row) {
+  if (!row) return;
+
+  E.generation ++;
+  editor_row_check_storage(row);
+
+  // A row edited back to the line of the file counts as unchanged again
+  bool in_file = editor_row_in_file(row);
+  row->hash = editor_row_compute_hash(row);
+  E.modified_rows += in_file - editor_row_in_file(row);
+
+  editor_update_render(row);
+
+  int at = editor_row_index(row);
+  editor_update_syntax(at);
+  editor_wrap_update_row(at);
+}
+
+/**
+ * @brief Rebuild the hash and the render cache of a row read back from a
+ *        page (see page.c); it counts as no change.
+ */
+void editor_row_restore(erow_t *row) {
+  editor_row_check_storage(row);
+  row->hash = editor_row_compute_hash(row);
+  editor_update_render(row);
+}
+
+/**
+ * @brief Return the rendered bytes of a row.
+ *
+ * @param row Row object.
+ */
+const char *editor_row_render(const erow_t *row) {
+  return row->render ? row->render : editor_row_chars(row);
+}
+
+/**
+ * @brief Copy `len` bytes of a row starting at `at` into `dst`.
+ *
+ * Works for flat, chunked (long) and compressed rows; a compressed row is
+ * read through the block cache and stays compressed.
+ *
+ * @param row Row object.
+ * @param at  Start offset.
+ * @param len Number of bytes (clamped to the row).
+ * @param dst Destination buffer.
+ *
+ * @return Returns 0 on success, -1 if a compressed row cannot be read.
+ */
+int editor_row_read(const erow_t *row, int at, int len, char *dst) {
+  if (at < 0 || at >= row->size) return 0;
+  if (len > row->size - at) len = row->size - at;
+
+  if (row->ll) {
+    lline_read(row->ll, at, len, dst);
+  } else if (row->is_cold) {
+    const char *s = editor_cold_bytes(row);
+    if (!s) return -1;
+    memcpy(dst, s + at, len);
+  } else {
+    memcpy(dst, editor_row_chars(row) + at, len);
+  }
+  return 0;
+}
+
+/**
+ * @brief Row `at` of E, ready to be drawn.
+ *
+ * A page that is out is read back and a compressed row is thawed (see
+ * cold.h); if that fails it is returned as is and must only be read with
+ * editor_row_read().
+ *
+ * @param at Row index (0 ~ E.numrows - 1).
+ *
+ * @return Returns the row, NULL if its page cannot be read back.
+ */
+erow_t *editor_row(int at) {
+  erow_t *row = editor_row_at(at);
+  if (row && row->is_cold) editor_row_thaw(row);
+  return row;
+}
+
+/**
+ * @brief Convert a byte offset into a display column (O(1)).
+ *
+ * @param row Row object.
+ * @param cx  Byte offset (0 ~ row->size).
+ */
+int editor_row_cx_to_rx(const erow_t *row, int cx) {
+  if (cx <= 0) return 0;
+  if (cx > row->size) cx = row->size;
+  if (row->ll) return lline_cx_to_rx(row->ll, cx);
+
+  return row->cx2rx ? row->cx2rx[cx] : cx;
+}
+
+/**
+ * @brief Convert a byte offset into an offset in the render buffer (O(1)).
+ *
+ * @param row Row object.
+ * @param cx  Byte offset (0 ~ row->size).
+ */
+int editor_row_cx_to_rb(const erow_t *row, int cx) {
+  if (cx <= 0) return 0;
+  if (cx > row->size) cx = row->size;
+
+  return row->cx2rb ? row->cx2rb[cx] : cx;
+}
+
+/**
+ * @brief Move a byte offset back to the start of the character containing it.
+ *
+ * Continuation bytes and combining marks share the display column of their
+ * character, so no decoding is needed.
+ *
+ * @param row Row object.
+ * @param cx  Byte offset.
+ */
+int editor_row_char_start(const erow_t *row, int cx) {
+  if (cx <= 0) return 0;
+  if (cx >= row->size) return row->size;
+  if (row->ll) return lline_prev_char(row->ll, cx + 1);
+  if (!row->cx2rx) return cx;
+
+  while (cx > 0 && row->cx2rx[cx - 1] == row->cx2rx[cx]) cx --;
+  return cx;
+}
+
+/**
+ * @brief Return the byte offset of the character after the one at `cx`.
+ *
+ * @param row Row object.
+ * @param cx  Byte offset of a character.
+ */
+int editor_row_next_char(const erow_t *row, int cx) {
+  if (cx >= row->size) return row->size;
+  if (row->ll) return lline_next_char(row->ll, cx);
+  if (!row->cx2rx) return cx + 1;
+
+  int j = cx + 1;
+  while (j < row->size && row->cx2rx[j] == row->cx2rx[cx]) j ++;
+  return j;
+}
+
+/**
+ * @brief Return the byte offset of the character before the one at `cx`.
+ *
+ * @param row Row object.
+ * @param cx  Byte offset of a character.
+ */
+int editor_row_prev_char(const erow_t *row, int cx) {
+  if (cx <= 0) return 0;
+  if (cx > row->size) cx = row->size;
+  if (row->ll) return lline_prev_char(row->ll, cx);
+  if (!row->cx2rx) return cx - 1;
+
+  // Step into the previous character, then back to its first byte
+  cx --;
+  while (cx > 0 && row->cx2rx[cx - 1] == row->cx2rx[cx]) cx --;
+  return cx;
+}
+
+/**
+ * @brief Convert a display column into the character that covers it (O(log n)).
+ *
+ * @param row Row object.
+ * @param rx  Display column.
+ *
+ * @return Returns the byte offset (`row->size` if `rx` is past the end).
+ */
+int editor_row_rx_to_cx(const erow_t *row, int rx) {
+  if (rx <= 0) return 0;
+  if (row->ll) return lline_rx_to_cx(row->ll, rx);
+  if (!row->cx2rx) return MIN(rx, row->size);
+  if (rx >= row->cx2rx[row->size]) return row->size;
+
+  // Binary search the last byte whose display column is <= rx
+  int lo = 0, hi = row->size - 1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (row->cx2rx[mid] <= rx) lo = mid;
+    else hi = mid - 1;
+  }
+  return editor_row_char_start(row, lo);
 }
 
 /**
  * @brief Release memory for one row (used for deleting a row).
  *
- * @param row Memory needs to be freed for the row object.
+ * @param row Memory needs to be freed for the row object (a row of E).
  */
 void editor_free_row(erow_t *row) {
   if (!row) return;
 
-  free(row->chars);
+  // Out of E.modified_rows for good: freeing the row again changes nothing
+  if (!editor_row_in_file(row)) E.modified_rows --;
+  row->origin = 0;
+  row->file_hash = row->hash;
+
+  editor_row_release(row);
+}
+
+/**
+ * @brief Release memory for a row that is not counted in E: one not yet
+ *        inserted, or one of a parked buffer.
+ */
+void editor_row_release(erow_t *row) {
+  if (row->is_cold) editor_cold_release(row);
+  else if (row->is_shared) intern_release(row->chars);
+  else if (!row->is_inline) zilo_free(MEM_ROWS, row->chars);
+  lline_free(row->ll);
+  row->is_inline = false;
+  row->is_shared = false;
+  row->is_cold = false;
+  row->chars = NULL;
+  row->ll = NULL;
+  zilo_free(MEM_RENDER, row->render);
+  zilo_free(MEM_RENDER, row->cx2rx);
+  zilo_free(MEM_RENDER, row->cx2rb);
+  row->render = NULL;
+  row->cx2rx = NULL;
+  row->cx2rb = NULL;
+  zilo_free(MEM_SYNTAX, row->hl);
+  row->hl = NULL;
+  row->hl_count = 0;
+}
+
+/**
+ * @brief Make room for `size` bytes (plus '\0') in a flat row.
+ *
+ * An inline row moves to the heap once it outgrows ROW_INLINE_MAX and stays
+ * there, so a line edited around the limit does not flip back and forth. A
+ * shared row gets a private copy (copy on write).
+ *
+ * @param row  Row object (not a long row).
+ * @param size New number of bytes.
+ *
+ * @return Returns 0 on success, -1 on failure (the row is unchanged).
+ */
+static int editor_row_grow(erow_t *row, int size) {
+  if (row->is_inline && size <= ROW_INLINE_MAX) return 0;
+
+  bool copy = row->is_inline || row->is_shared;
+  char *new = copy ? zilo_malloc(MEM_ROWS, size + 1)
+                   : zilo_realloc(MEM_ROWS, row->chars, size + 1);
+  if (!new) {
+    LOG_ERROR("realloc", "Failed to expand memory.");
+    return -1;
+  }
+  if (copy) {
+    memcpy(new, editor_row_chars(row), row->size + 1);
+    if (row->is_shared) intern_release(row->chars);
+    row->is_inline = false;
+    row->is_shared = false;
+  }
+  row->chars = new;
+  return 0;
+}
+
+/**
+ * @brief Give a shared row its own copy before it is written in place.
+ *
+ * @return Returns 0 on success, -1 on failure (the row is unchanged).
+ */
+static int editor_row_unshare(erow_t *row) {
+  return row->is_shared ? editor_row_grow(row, row->size) : 0;
 }
 
 /**
@@ -47,18 +629,28 @@ void editor_free_row(erow_t *row) {
 void editor_row_insert_char(erow_t *row, int at, int c) {
   if (!row) return;
   if (at < 0 || at > row->size) return;
+  if (editor_row_thaw(row) == -1) return;
+
+  if (row->ll) {
+    char ch = c;
+    lline_insert(row->ll, at, &ch, 1);
+    row->size ++;
+    editor_update_row(row);
+    return;
+  }
 
   // Expand memory.
-  char *new = realloc(row->chars, row->size + 2); // new character + '\0'
-  if (!new) LOG_ERROR("realloc", "Failed to expand memory.");
-  row->chars = new;
+  if (editor_row_grow(row, row->size + 1) == -1) return;
+  char *chars = editor_row_chars(row);
 
-  // Move the data starting from position `at` to position `at + 1`.
-  memmove(row->chars + at + 1, row->chars + at, row->size - at);
+  // Move the data starting from position `at` (and the '\0') to position `at + 1`.
+  memmove(chars + at + 1, chars + at, row->size - at + 1);
 
   // Update.
-  row->chars[at] = c;
+  chars[at] = c;
   row->size ++;
+
+  editor_update_row(row);
 }
 
 /**
@@ -70,12 +662,25 @@ void editor_row_insert_char(erow_t *row, int at, int c) {
 void editor_row_remove_char(erow_t *row, int at) {
   if (!row) return;
   if (at < 0 || at >= row->size) return;
+  if (editor_row_thaw(row) == -1) return;
+
+  if (row->ll) {
+    lline_delete(row->ll, at, 1);
+    row->size --;
+    editor_update_row(row);
+    return;
+  }
+
+  if (editor_row_unshare(row) == -1) return;
 
-  // Move the data starting from position `at + 1` to position `at`.
-  memmove(row->chars + at, row->chars + at + 1, row->size - at - 1);
+  // Move the data starting from position `at + 1` (and the '\0') to position `at`.
+  char *chars = editor_row_chars(row);
+  memmove(chars + at, chars + at + 1, row->size - at);
 
   // Update.
   row->size --;
+
+  editor_update_row(row);
 }
 
 /**
@@ -86,11 +691,25 @@ void editor_row_remove_char(erow_t *row, int at) {
  * @param len   The length of to the characters to be deleted.
  */
 void editor_row_remove_range(erow_t *row, int start, int len) {
+  if (!row) return;
   if (start < 0 || start >= row->size) return;
   if (len < 0 || len > row->size - start) return;
+  if (editor_row_thaw(row) == -1) return;
+
+  if (row->ll) {
+    lline_delete(row->ll, start, len);
+    row->size -= len;
+    editor_update_row(row);
+    return;
+  }
 
-  memmove(row->chars + start, row->chars + start + len, row->size - start - len);
+  if (editor_row_unshare(row) == -1) return;
+
+  char *chars = editor_row_chars(row);
+  memmove(chars + start, chars + start + len, row->size - start - len + 1);
   row->size -= len;
+
+  editor_update_row(row);
 }
 
 /**
@@ -102,16 +721,72 @@ void editor_row_remove_range(erow_t *row, int start, int len) {
  */
 void editor_row_append_string(erow_t *row, char *s, size_t len) {
   if (!row) return;
+  if (editor_row_thaw(row) == -1) return;
+
+  if (row->ll) {
+    lline_insert(row->ll, row->size, s, len);
+    row->size += len;
+    editor_update_row(row);
+    return;
+  }
 
   // Expand char array memory
-  char *new = realloc(row->chars, row->size + len + 1);
-  if (!new) LOG_ERROR("realloc", "Failed to expand memory.");
-  row->chars = new;
+  if (editor_row_grow(row, row->size + len) == -1) return;
+  char *chars = editor_row_chars(row);
 
   // Append string to the end of row
-  memcpy(row->chars + row->size, s, len);
-  row->chars[row->size + len] = '\0';
+  memcpy(chars + row->size, s, len);
+  chars[row->size + len] = '\0';
 
   // Update
   row->size += len;
+
+  editor_update_row(row);
+}
+
+/**
+ * @brief Concatenate the bytes [from, size) of row `src` to the end of `dst`.
+ *
+ * @param dst  Destination row.
+ * @param src  Source row (flat or chunked).
+ * @param from First byte of `src` to append.
+ */
+void editor_row_append_row(erow_t *dst, const erow_t *src, int from) {
+  if (!dst || !src) return;
+  if (from < 0) from = 0;
+
+  int len = src->size - from;
+  if (len <= 0) return;
+
+  if (!src->ll && !src->is_cold) {
+    editor_row_append_string(dst, editor_row_chars(src) + from, len);
+    return;
+  }
+
+  char *buf = zilo_malloc(MEM_ROWS, len);
+  if (!buf) {
+    LOG_ERROR("malloc", "Failed to allocate memory.");
+    return;
+  }
+  if (editor_row_read(src, from, len, buf) == 0) editor_row_append_string(dst, buf, len);
+  zilo_free(MEM_ROWS, buf);
+}
+
+/**
+ * @brief Overwrite the byte at position `at` (Replace mode).
+ *
+ * @param row Pointer to row object.
+ * @param at  Byte offset.
+ * @param c   New byte.
+ */
+void editor_row_set_char(erow_t *row, int at, int c) {
+  if (!row) return;
+  if (at < 0 || at >= row->size) return;
+  if (editor_row_thaw(row) == -1) return;
+
+  if (row->ll) lline_set_byte(row->ll, at, c);
+  else if (editor_row_unshare(row) == -1) return;
+  else editor_row_chars(row)[at] = c;
+
+  editor_update_row(row);
 }
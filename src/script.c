@@ -0,0 +1,225 @@
+#define _POSIX_C_SOURCE 200809L
+#include "script.h"
+#include "file.h"
+#include "input.h"
+#include "logger.h"
+#include "zilo.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+ * Script format: every byte is a key, except
+ *  - newlines, which are ignored so scripts can be split over lines;
+ *  - <...> names: <Esc>, <CR> (Enter), <Tab>, <BS>, <Space>, <lt> ('<')
+ *    and <C-x> (Ctrl+x).
+ * A '<' that does not start a known name is a plain key.
+ *
+ * Example: "gg:set wrap<CR>A;<Esc>j0x<C-s>"
+ */
+
+typedef struct {
+  const char *name;
+  char key;
+} key_name_t;
+
+static const key_name_t key_names[] = {
+  { "Esc",   27 },
+  { "CR",    '\r' },
+  { "Enter", '\r' },
+  { "Tab",   '\t' },
+  { "BS",    127 },
+  { "Space", ' ' },
+  { "lt",    '<' },
+};
+
+#define KEY_NAMES_SIZE (sizeof(key_names) / sizeof(key_names[0]))
+
+/**
+ * @brief Decode the name at `s` ("<...>").
+ *
+ * @return Returns the number of bytes used, or 0 if it is not a key name.
+ */
+static int parse_key_name(const char *s, size_t len, char *key) {
+  const char *end = memchr(s, '>', len);
+  if (!end) return 0;
+
+  const char *name = s + 1;
+  size_t nlen = end - name;
+
+  if (nlen == 3 && (name[0] == 'C' || name[0] == 'c') && name[1] == '-') {
+    *key = name[2] & 0x1f;
+    return end - s + 1;
+  }
+  for (size_t i = 0; i < KEY_NAMES_SIZE; ++ i) {
+    if (strlen(key_names[i].name) == nlen && !strncasecmp(name, key_names[i].name, nlen)) {
+      *key = key_names[i].key;
+      return end - s + 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Read a script and decode it into keys.
+ *
+ * @param path  Script path.
+ * @param nkeys Set to the number of keys.
+ *
+ * @return Returns the keys (to be freed), or NULL on error.
+ */
+static char *load_script(const char *path, size_t *nkeys) {
+  FILE *fp = fopen(path, "r");
+  if (!fp) return NULL;
+
+  char *text = NULL;
+  size_t len = 0;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+    char *new = realloc(text, len + n);
+    if (!new) {
+      free(text);
+      fclose(fp);
+      return NULL;
+    }
+    text = new;
+    memcpy(text + len, buf, n);
+    len += n;
+  }
+  fclose(fp);
+
+  // Keys are never longer than the text
+  char *keys = malloc(len + 1);
+  if (!keys) {
+    free(text);
+    return NULL;
+  }
+
+  size_t k = 0;
+  for (size_t i = 0; i < len; ) {
+    char key;
+    int used;
+    if (text[i] == '\n' || text[i] == '\r') {
+      i ++;
+    } else if (text[i] == '<' && (used = parse_key_name(text + i, len - i, &key)) > 0) {
+      keys[k ++] = key;
+      i += used;
+    } else {
+      keys[k ++] = text[i ++];
+    }
+  }
+
+  free(text);
+  *nkeys = k;
+  return keys;
+}
+
+/**
+ * @brief Apply the keys to one file and save it (runs in a worker process).
+ *
+ * @return Returns the exit status of the worker.
+ */
+static int script_one_file(const char *keys, size_t nkeys, char *filename) {
+  zilo_log_init("zilo.log");
+
+  init_editor();
+  E.headless = true;
+  editor_open(filename);
+
+  for (size_t i = 0; i < nkeys && !E.quit; ++ i) {
+    editor_process_key(keys[i]);
+  }
+
+  // A file that could not be written (or changed on disk meanwhile) fails the worker
+  int status = 0;
+  if (editor_save() == -1) {
+    LOG_ERROR("script_one_file", "<%s> not saved: %s", filename, E.statusmsg);
+    fprintf(stderr, "zilo: %s\n", E.statusmsg);
+    status = 1;
+  } else {
+    LOG_INFO("script_one_file", "Applied %zu keys to <%s>.", nkeys, filename);
+  }
+
+  free_editor();
+  zilo_log_close();
+  return status;
+}
+
+/**
+ * @brief Apply a key script to files with no terminal and no rendering.
+ *
+ * Each file is edited in its own worker process (at most one per online
+ * CPU), so files are processed in parallel and a failure only affects its
+ * own file. The file is saved after the last key; a 'q' in the script
+ * stops it early.
+ *
+ * @param path   Script path.
+ * @param files  Files to edit.
+ * @param nfiles Number of files.
+ *
+ * @return Returns the number of files that failed.
+ */
+int editor_run_script(const char *path, char **files, int nfiles) {
+  size_t nkeys;
+  char *keys = load_script(path, &nkeys);
+  if (!keys) {
+    fprintf(stderr, "zilo: cannot read script <%s>\n", path);
+    return nfiles;
+  }
+
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  int max_workers = ncpu > 0 ? ncpu : 1;
+
+  pid_t *pids = calloc(nfiles, sizeof(pid_t));
+  if (!pids) {
+    free(keys);
+    return nfiles;
+  }
+
+  int failed = 0;
+  int running = 0;
+  int next = 0;
+
+  while (next < nfiles || running > 0) {
+    // Start workers while there are files and free CPUs
+    while (next < nfiles && running < max_workers) {
+      pid_t pid = fork();
+      if (pid == 0) {
+        _exit(script_one_file(keys, nkeys, files[next]));
+      }
+      if (pid == -1) {
+        fprintf(stderr, "zilo: fork failed for <%s>\n", files[next]);
+        failed ++;
+      } else {
+        pids[next] = pid;
+        running ++;
+      }
+      next ++;
+    }
+    if (running == 0) break;
+
+    // Reap one worker
+    int status;
+    pid_t pid = wait(&status);
+    if (pid == -1) break;
+    running --;
+
+    for (int i = 0; i < nfiles; ++ i) {
+      if (pids[i] != pid) continue;
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "zilo: script failed on <%s>\n", files[i]);
+        failed ++;
+      }
+      break;
+    }
+  }
+
+  free(pids);
+  free(keys);
+  return failed;
+}
@@ -0,0 +1,179 @@
+#include "snapshot.h"
+#include "intern.h"
+#include "logger.h"
+#include "mem.h"
+#include "page.h"
+#include "row.h"
+#include "trace.h"
+#include "zilo.h"
+#include <stdlib.h>
+
+/*
+ * Workers must not read the rows of E: the main thread keeps editing (and
+ * paging) them. A snapshot copies only the row descriptors: a row on
+ * the heap is turned into an interned payload (see intern.h), which is
+ * immutable, and the snapshot takes a reference to it. The next edit of
+ * that row takes a private copy (copy on write), so a job can read the
+ * snapshot for as long as it wants, and a second snapshot shares every
+ * payload the first one did. Only inline, long and compressed rows, which
+ * have no payload of their own, are copied, into blocks that never move.
+ *
+ * The rows are taken in one pass, pages read back and dropped again on the
+ * way, so a snapshot of a buffer larger than memory needs no more of it
+ * than its copies and the payloads it holds.
+ *
+ * References are taken and dropped on the main thread (the interning table
+ * is owned by it); jobs drop theirs from their completion callback.
+ */
+
+#define SNAPSHOT_DATA_BLOCK (1024 * 1024)   // Bytes of a block of copied rows
+
+static row_snapshot_t *g_last = NULL;   // Snapshot of the current generation, while a job holds it
+
+/**
+ * @brief Free a snapshot and drop its payload references.
+ */
+static void snapshot_free(row_snapshot_t *snap) {
+  if (snap == g_last) g_last = NULL;
+
+  for (int i = 0; i < snap->nheld; ++ i) intern_release(snap->held[i]);
+  for (int i = 0; i < snap->ndata; ++ i) zilo_free(MEM_SNAPSHOT, snap->data[i]);
+  zilo_free(MEM_SNAPSHOT, snap->held);
+  zilo_free(MEM_SNAPSHOT, snap->data);
+  zilo_free(MEM_SNAPSHOT, snap->rows);
+  zilo_free(MEM_SNAPSHOT, snap->lens);
+  zilo_free(MEM_SNAPSHOT, snap);
+}
+
+/**
+ * @brief Append `p` to a list growing geometrically.
+ *
+ * @return Returns 0 on success, -1 on failure (the list is unchanged).
+ */
+static int snapshot_push(char ***list, int *n, int *cap, char *p) {
+  if (*n == *cap) {
+    int new_cap = *cap ? *cap * 2 : 64;
+    char **new = zilo_realloc(MEM_SNAPSHOT, *list, sizeof(char *) * new_cap);
+    if (!new) return -1;
+    *list = new;
+    *cap = new_cap;
+  }
+  (*list)[(*n) ++] = p;
+  return 0;
+}
+
+/**
+ * @brief True if the row has a heap payload the snapshot can share.
+ */
+static bool snapshot_row_shareable(const erow_t *row) {
+  return !row->is_inline && !row->is_cold && !row->ll;
+}
+
+/**
+ * @brief Make a heap row share an interned payload.
+ *
+ * @return Returns the payload with one more reference for the snapshot, or
+ *         NULL on failure (the row is unchanged).
+ */
+static char *snapshot_share_row(erow_t *row) {
+  if (row->is_shared) return intern_ref(row->chars);
+
+  char *chars = intern_get(row->chars, row->size);
+  if (!chars) return NULL;
+  zilo_free(MEM_ROWS, row->chars);
+  row->chars = chars;
+  row->is_shared = true;
+  return intern_ref(chars);
+}
+
+/**
+ * @brief Snapshot the current rows (main thread).
+ *
+ * @return Returns a snapshot with one reference for the caller (NULL on failure).
+ */
+row_snapshot_t *editor_snapshot_take(void) {
+  TRACE_SPAN("snapshot_take");
+
+  if (g_last && g_last->generation == E.generation) {
+    atomic_fetch_add_explicit(&g_last->refs, 1, memory_order_relaxed);
+    return g_last;
+  }
+
+  row_snapshot_t *snap = zilo_calloc(MEM_SNAPSHOT, 1, sizeof(row_snapshot_t));
+  const char **rows = zilo_malloc(MEM_SNAPSHOT, sizeof(char *) * (E.numrows ? E.numrows : 1));
+  int *lens = zilo_malloc(MEM_SNAPSHOT, sizeof(int) * (E.numrows ? E.numrows : 1));
+  if (!snap || !rows || !lens) {
+    LOG_ERROR("malloc", "Failed to allocate a row snapshot.");
+    zilo_free(MEM_SNAPSHOT, snap);
+    zilo_free(MEM_SNAPSHOT, rows);
+    zilo_free(MEM_SNAPSHOT, lens);
+    return NULL;
+  }
+  atomic_init(&snap->refs, 1);
+  snap->generation = E.generation;
+  snap->numrows = E.numrows;
+  snap->rows = rows;
+  snap->lens = lens;
+
+  int held_cap = 0, data_cap = 0;
+  char *block = NULL;       // Block the next copy goes to
+  int64_t block_left = 0;   // Room left in it
+  for (int i = 0; i < E.numrows; ++ i) {
+    erow_t *row = editor_row_scan(i);
+    if (!row) {
+      snapshot_free(snap);
+      return NULL;
+    }
+    lens[i] = row->size;
+    snap->size += row->size + 1;
+
+    if (snapshot_row_shareable(row)) {
+      char *chars = snapshot_share_row(row);
+      if (!chars || snapshot_push(&snap->held, &snap->nheld, &held_cap, chars) == -1) {
+        LOG_ERROR("intern_get", "Failed to share a row with a snapshot.");
+        if (chars) intern_release(chars);
+        snapshot_free(snap);
+        return NULL;
+      }
+      rows[i] = chars;
+      continue;
+    }
+
+    if (!block || row->size > block_left) {
+      int64_t cap = MAX(SNAPSHOT_DATA_BLOCK, row->size);
+      block = zilo_malloc(MEM_SNAPSHOT, cap);
+      if (!block || snapshot_push(&snap->data, &snap->ndata, &data_cap, block) == -1) {
+        LOG_ERROR("malloc", "Failed to allocate a row snapshot.");
+        zilo_free(MEM_SNAPSHOT, block);
+        snapshot_free(snap);
+        return NULL;
+      }
+      block_left = cap;
+    }
+    if (editor_row_read(row, 0, row->size, block) == -1) {
+      snapshot_free(snap);
+      return NULL;
+    }
+    rows[i] = block;
+    block += row->size;
+    block_left -= row->size;
+  }
+
+  g_last = snap;
+  return snap;
+}
+
+/**
+ * @brief Drop a reference (main thread). The last one frees the snapshot.
+ */
+void editor_snapshot_release(row_snapshot_t *snap) {
+  if (!snap || atomic_fetch_sub_explicit(&snap->refs, 1, memory_order_acq_rel) != 1) return;
+  snapshot_free(snap);
+}
+
+/**
+ * @brief Stop handing out the current snapshot (jobs holding it keep their reference).
+ */
+void editor_snapshot_forget(void) {
+  g_last = NULL;
+}
@@ -0,0 +1,178 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "stats.h"
+#include "logger.h"
+#include <stdio.h>
+#include <time.h>
+
+/*------------------------------------------
+                HISTOGRAM
+ ------------------------------------------*/
+/**
+ * @brief Bucket of a value.
+ *
+ * Values below HIST_SUB have their own bucket. Above that, the bucket is
+ * chosen by the position of the highest set bit and the HIST_SUB_BITS bits
+ * below it.
+ */
+static int hist_index(uint64_t v) {
+  if (v < HIST_SUB) return v;
+
+  int msb = 63 - __builtin_clzll(v);
+  int shift = msb - HIST_SUB_BITS + 1;
+  int mantissa = v >> shift;   // In [HIST_SUB / 2, HIST_SUB)
+  return HIST_SUB + (msb - HIST_SUB_BITS) * (HIST_SUB / 2) + (mantissa - HIST_SUB / 2);
+}
+
+/**
+ * @brief Highest value that falls into bucket `i`.
+ */
+static int64_t hist_bucket_max(int i) {
+  if (i < HIST_SUB) return i;
+
+  int k = i - HIST_SUB;
+  int msb = k / (HIST_SUB / 2) + HIST_SUB_BITS;
+  int shift = msb - HIST_SUB_BITS + 1;
+  int64_t mantissa = k % (HIST_SUB / 2) + HIST_SUB / 2;
+  return ((mantissa + 1) << shift) - 1;
+}
+
+/**
+ * @brief Record one value in O(1).
+ *
+ * @param h     Histogram.
+ * @param value Value (negative values count as 0).
+ */
+void hist_record(hist_t *h, int64_t value) {
+  if (value < 0) value = 0;
+
+  h->counts[hist_index(value)] ++;
+  if (h->total == 0 || value < h->min) h->min = value;
+  if (h->total == 0 || value > h->max) h->max = value;
+  h->total ++;
+}
+
+/**
+ * @brief Value below which `p` percent of the recorded values fall.
+ *
+ * @param h Histogram.
+ * @param p Percentile in [0, 100].
+ *
+ * @return Returns the upper bound of the bucket holding that rank (clamped
+ *         to the recorded maximum), or 0 if nothing was recorded.
+ */
+int64_t hist_percentile(const hist_t *h, double p) {
+  if (h->total == 0) return 0;
+
+  uint64_t rank = (uint64_t)(p / 100.0 * h->total + 0.5);
+  if (rank < 1) rank = 1;
+  if (rank > h->total) rank = h->total;
+
+  uint64_t seen = 0;
+  for (int i = 0; i < HIST_BUCKETS; ++ i) {
+    seen += h->counts[i];
+    if (seen >= rank) {
+      int64_t v = hist_bucket_max(i);
+      return v > h->max ? h->max : v;
+    }
+  }
+  return h->max;
+}
+
+/*------------------------------------------
+              EDITOR LATENCIES
+ ------------------------------------------*/
+static hist_t g_key_latency;    // Key read -> frame written
+static hist_t g_frame_cost;     // editor_refresh_screen() duration
+static hist_t g_frame_bytes;    // Bytes written per frame
+static hist_t g_frame_allocs;   // Allocations per frame
+static int64_t g_key_ns = 0;    // When the key awaiting its frame was read
+
+/**
+ * @brief Monotonic clock in nanoseconds.
+ */
+int64_t editor_stats_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief A key was read (starts a keystroke-to-frame measurement).
+ *
+ * Keys read before the next frame (typeahead) are measured from the first one.
+ */
+void editor_stats_key_read(void) {
+  if (!g_key_ns) g_key_ns = editor_stats_now();
+}
+
+/**
+ * @brief A frame was built and written.
+ *
+ * @param start_ns Start of editor_refresh_screen().
+ * @param end_ns   After the frame was written.
+ * @param bytes    Size of the frame.
+ * @param allocs   Allocations made while it was built (see zilo_mem_allocs()).
+ */
+void editor_stats_frame(int64_t start_ns, int64_t end_ns, int64_t bytes, int64_t allocs) {
+  hist_record(&g_frame_cost, end_ns - start_ns);
+  hist_record(&g_frame_bytes, bytes);
+  hist_record(&g_frame_allocs, allocs);
+
+  if (g_key_ns) {
+    hist_record(&g_key_latency, end_ns - g_key_ns);
+    g_key_ns = 0;
+  }
+}
+
+/**
+ * @brief Format the keystroke latency percentiles, and the median size and
+ *        allocations of a frame, for the status bar.
+ *
+ * @param buf  Buffer.
+ * @param size Buffer size.
+ *
+ * @return Returns the snprintf result.
+ */
+int editor_stats_status(char *buf, int size) {
+  return snprintf(buf, size, "p50 %.2f p99 %.2fms %lldB %lld allocs",
+                  hist_percentile(&g_key_latency, 50) / 1e6,
+                  hist_percentile(&g_key_latency, 99) / 1e6,
+                  (long long)hist_percentile(&g_frame_bytes, 50),
+                  (long long)hist_percentile(&g_frame_allocs, 50));
+}
+
+static void stats_log(const char *what, const hist_t *h) {
+  LOG_INFO("editor_stats_report",
+           "%s: n=%llu min=%.3fms p50=%.3fms p90=%.3fms p99=%.3fms p99.9=%.3fms max=%.3fms",
+           what, (unsigned long long)h->total,
+           h->min / 1e6,
+           hist_percentile(h, 50) / 1e6,
+           hist_percentile(h, 90) / 1e6,
+           hist_percentile(h, 99) / 1e6,
+           hist_percentile(h, 99.9) / 1e6,
+           h->max / 1e6);
+}
+
+static void stats_log_count(const char *what, const hist_t *h) {
+  LOG_INFO("editor_stats_report",
+           "%s: n=%llu min=%lld p50=%lld p90=%lld p99=%lld p99.9=%lld max=%lld",
+           what, (unsigned long long)h->total,
+           (long long)h->min,
+           (long long)hist_percentile(h, 50),
+           (long long)hist_percentile(h, 90),
+           (long long)hist_percentile(h, 99),
+           (long long)hist_percentile(h, 99.9),
+           (long long)h->max);
+}
+
+/**
+ * @brief Write the latency, frame cost, frame size and frame allocation
+ *        summaries to the log.
+ */
+void editor_stats_report(void) {
+  stats_log("keystroke-to-frame latency", &g_key_latency);
+  stats_log("frame cost", &g_frame_cost);
+  stats_log_count("frame bytes", &g_frame_bytes);
+  stats_log_count("frame allocations", &g_frame_allocs);
+}
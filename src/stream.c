@@ -0,0 +1,291 @@
+#define _POSIX_C_SOURCE 200809L
+#define ZILO_LOG_MODULE LOG_MODULE_FILE
+
+#include "stream.h"
+#include "buffer.h"
+#include "file.h"
+#include "logger.h"
+#include "mem.h"
+#include "output.h"
+#include "zilo.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Streaming input (`zilo -`). A reader thread blocks on the pipe and queues
+ * every chunk it gets, sized to what was actually read; the main loop wakes
+ * on a pipe of its own and appends the queued chunks as rows, so the first
+ * screen is drawn as soon as the first bytes arrive.
+ *
+ * The reader stops once STREAM_QUEUE_MAX bytes wait in the queue, which
+ * keeps memory to what the rows need even when the writer is much faster
+ * than the editor. The rows go to the buffer that was loaded when the
+ * stream started; while another one is in E the chunks wait (and so does
+ * the reader).
+ */
+
+#define STREAM_POLL_BYTES (1024 * 1024)   // Appended per editor_stream_poll(), so keys stay responsive
+
+typedef struct stream_chunk {
+  struct stream_chunk *next;
+  int len;
+  char data[];
+} stream_chunk_t;
+
+typedef struct {
+  bool active;
+  int fd;               // Input being read
+  int wake[2];          // Reader -> main loop: chunks are queued
+  int stop[2];          // Main loop -> reader: give up
+  int buffer_id;        // Buffer the rows go to
+  pthread_t reader;
+
+  pthread_mutex_t lock; // Guards the fields below
+  pthread_cond_t room;  // Signalled when the queue shrinks
+  stream_chunk_t *head, *tail;
+  int64_t queued;       // Bytes in the queue
+  bool stopping;
+  bool eof;             // The reader is done (end of input or error)
+  int error;            // errno of a failed read (0 at the end of input)
+} stream_t;
+
+static stream_t S = { .fd = -1, .wake = { -1, -1 }, .stop = { -1, -1 } };
+
+/**
+ * @brief Wake the main loop (the pipe is non-blocking: a full one is awake already).
+ */
+static void stream_wake(void) {
+  char c = 1;
+  if (write(S.wake[1], &c, 1) == -1 && errno != EAGAIN) {
+    LOG_WARN("write", "Failed to wake the main loop: %s.", strerror(errno));
+  }
+}
+
+/**
+ * @brief Reader thread: queue what the input delivers until its end.
+ */
+static void *stream_reader_main(void *arg) {
+  (void)arg;
+
+  char buf[STREAM_READ_SIZE];
+  struct pollfd fds[2] = {
+    { .fd = S.fd, .events = POLLIN },
+    { .fd = S.stop[0], .events = POLLIN },
+  };
+  int error = 0;
+
+  while (1) {
+    // Backpressure: wait for the editor to catch up
+    pthread_mutex_lock(&S.lock);
+    while (S.queued >= STREAM_QUEUE_MAX && !S.stopping) pthread_cond_wait(&S.room, &S.lock);
+    bool stopping = S.stopping;
+    pthread_mutex_unlock(&S.lock);
+    if (stopping) break;
+
+    if (poll(fds, 2, -1) == -1) {
+      if (errno == EINTR) continue;
+      error = errno;
+      break;
+    }
+    if (fds[1].revents) break;
+
+    ssize_t n = read(S.fd, buf, sizeof(buf));
+    if (n == -1 && (errno == EINTR || errno == EAGAIN)) continue;
+    if (n <= 0) {
+      error = n == -1 ? errno : 0;
+      break;
+    }
+
+    stream_chunk_t *chunk = zilo_malloc(MEM_FILE, sizeof(stream_chunk_t) + n);
+    if (!chunk) {
+      error = ENOMEM;
+      break;
+    }
+    chunk->next = NULL;
+    chunk->len = n;
+    memcpy(chunk->data, buf, n);
+
+    pthread_mutex_lock(&S.lock);
+    bool was_empty = S.head == NULL;
+    if (S.tail) S.tail->next = chunk;
+    else S.head = chunk;
+    S.tail = chunk;
+    S.queued += n;
+    pthread_mutex_unlock(&S.lock);
+
+    if (was_empty) stream_wake();
+  }
+
+  pthread_mutex_lock(&S.lock);
+  S.eof = true;
+  S.error = error;
+  pthread_mutex_unlock(&S.lock);
+  stream_wake();
+  return NULL;
+}
+
+/**
+ * @brief Join the reader and release everything the stream holds.
+ */
+static void stream_close(void) {
+  pthread_mutex_lock(&S.lock);
+  S.stopping = true;
+  pthread_cond_signal(&S.room);
+  pthread_mutex_unlock(&S.lock);
+
+  char c = 1;
+  if (write(S.stop[1], &c, 1) == -1) LOG_WARN("write", "Failed to stop the reader: %s.", strerror(errno));
+  pthread_join(S.reader, NULL);
+
+  while (S.head) {
+    stream_chunk_t *next = S.head->next;
+    zilo_free(MEM_FILE, S.head);
+    S.head = next;
+  }
+  pthread_cond_destroy(&S.room);
+  pthread_mutex_destroy(&S.lock);
+
+  close(S.fd);
+  for (int i = 0; i < 2; ++ i) {
+    close(S.wake[i]);
+    close(S.stop[i]);
+  }
+  S = (stream_t){ .fd = -1, .wake = { -1, -1 }, .stop = { -1, -1 } };
+}
+
+/*------------------------------------------
+              PUBLIC INTERFACE
+ ------------------------------------------*/
+/**
+ * @brief Start reading `fd` into the buffer loaded in E.
+ *
+ * The descriptor is owned by the stream from here on, and closed when the
+ * stream stops.
+ *
+ * @return Returns 0 on success, -1 on failure.
+ */
+int editor_stream_start(int fd) {
+  if (S.active) return -1;
+
+  if (pipe(S.wake) == -1 || pipe(S.stop) == -1) {
+    LOG_ERROR("pipe", "Failed to create the stream pipes: %s.", strerror(errno));
+    for (int i = 0; i < 2; ++ i) {
+      if (S.wake[i] != -1) close(S.wake[i]);
+      if (S.stop[i] != -1) close(S.stop[i]);
+    }
+    S.wake[0] = S.wake[1] = S.stop[0] = S.stop[1] = -1;
+    return -1;
+  }
+  for (int i = 0; i < 2; ++ i) {
+    fcntl(S.wake[i], F_SETFL, fcntl(S.wake[i], F_GETFL) | O_NONBLOCK);
+    fcntl(S.wake[i], F_SETFD, FD_CLOEXEC);
+    fcntl(S.stop[i], F_SETFD, FD_CLOEXEC);
+  }
+
+  S.fd = fd;
+  S.buffer_id = editor_buffer_id();
+  pthread_mutex_init(&S.lock, NULL);
+  pthread_cond_init(&S.room, NULL);
+
+  if (pthread_create(&S.reader, NULL, stream_reader_main, NULL) != 0) {
+    LOG_ERROR("pthread_create", "Failed to start the stream reader.");
+    pthread_cond_destroy(&S.room);
+    pthread_mutex_destroy(&S.lock);
+    for (int i = 0; i < 2; ++ i) {
+      close(S.wake[i]);
+      close(S.stop[i]);
+    }
+    S = (stream_t){ .fd = -1, .wake = { -1, -1 }, .stop = { -1, -1 } };
+    return -1;
+  }
+
+  S.active = true;
+  LOG_INFO("editor_stream_start", "Reading the buffer from descriptor %d.", fd);
+  return 0;
+}
+
+/**
+ * @brief Stop reading (what was queued but not appended is dropped).
+ */
+void editor_stream_stop(void) {
+  if (!S.active) return;
+  stream_close();
+}
+
+/**
+ * @brief True until the end of the input has been appended.
+ */
+bool editor_stream_active(void) {
+  return S.active;
+}
+
+/**
+ * @brief The descriptor to poll for new chunks (-1 when not reading, or
+ *        while another buffer is in E: the chunks could not be appended).
+ */
+int editor_stream_fd(void) {
+  return S.active && editor_buffer_id() == S.buffer_id ? S.wake[0] : -1;
+}
+
+/**
+ * @brief Append the chunks read so far, at most STREAM_POLL_BYTES at a time
+ *        (the main loop is woken again for the rest).
+ *
+ * @return Returns true if the rows changed.
+ */
+bool editor_stream_poll(void) {
+  if (!S.active || editor_buffer_id() != S.buffer_id) return false;
+
+  char drain[64];
+  while (read(S.wake[0], drain, sizeof(drain)) > 0) {}
+
+  // Take a batch off the queue and let the reader go on meanwhile
+  pthread_mutex_lock(&S.lock);
+  stream_chunk_t *batch = S.head;
+  stream_chunk_t *last = NULL;
+  int64_t bytes = 0;
+  for (stream_chunk_t *c = S.head; c && bytes < STREAM_POLL_BYTES; c = c->next) {
+    bytes += c->len;
+    last = c;
+  }
+  if (last) {
+    S.head = last->next;
+    if (!S.head) S.tail = NULL;
+    last->next = NULL;
+    S.queued -= bytes;
+    pthread_cond_signal(&S.room);
+  }
+  bool more = S.head != NULL;
+  bool done = S.eof && !more;
+  int error = S.error;
+  pthread_mutex_unlock(&S.lock);
+
+  while (batch) {
+    stream_chunk_t *next = batch->next;
+    editor_append_text(batch->data, batch->len, -1);
+    E.file_bytes += batch->len;
+    zilo_free(MEM_FILE, batch);
+    batch = next;
+  }
+
+  if (more) stream_wake();
+
+  if (done) {
+    stream_close();
+    if (error) {
+      LOG_ERROR("read", "Failed to read the input: %s.", strerror(error));
+      editor_set_status_message("Input stopped: %s (%d lines read)", strerror(error), E.numrows);
+    } else {
+      LOG_INFO("editor_stream_poll", "End of input (%lld bytes).", (long long)E.file_bytes);
+      editor_set_status_message("End of input: %d lines, %lld bytes (:w <file> to save)",
+                                E.numrows, (long long)E.file_bytes);
+    }
+  }
+  return bytes > 0;
+}
@@ -0,0 +1,389 @@
+#define ZILO_LOG_MODULE LOG_MODULE_RENDER
+#include "syntax.h"
+#include "cold.h"
+#include "logger.h"
+#include "mem.h"
+#include "page.h"
+#include "row.h"
+#include "zilo.h"
+#include <ctype.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*------------------------------------------
+              HIGHLIGHT DATABASE
+ ------------------------------------------*/
+static const char *c_hl_extensions[] = { ".c", ".h", ".cc", ".cpp", ".hpp", NULL };
+static const char *c_hl_keywords[] = {
+  "switch", "if", "while", "for", "break", "continue", "return", "else",
+  "struct", "union", "typedef", "static", "enum", "case", "default", "do",
+  "goto", "sizeof", "const", "extern", "volatile", "inline", "register",
+  "class", "namespace", "template", "public", "private", "protected",
+
+  "int|", "long|", "double|", "float|", "char|", "unsigned|", "signed|",
+  "void|", "short|", "bool|", "size_t|", "ssize_t|", "auto|", NULL
+};
+
+static const char *generic_hl_extensions[] = {
+  ".sh", ".py", ".conf", ".cfg", ".ini", ".toml", ".yaml", ".yml", ".mk",
+  "Makefile", NULL
+};
+
+static const editor_syntax_t HLDB[] = {
+  {
+    "c",
+    c_hl_extensions,
+    c_hl_keywords,
+    "//", "/*", "*/",
+    HL_HIGHLIGHT_NUMBERS | HL_HIGHLIGHT_STRINGS | HL_HIGHLIGHT_PREPROC
+  },
+  {
+    "generic",
+    generic_hl_extensions,
+    NULL,
+    "#", NULL, NULL,
+    HL_HIGHLIGHT_NUMBERS | HL_HIGHLIGHT_STRINGS
+  },
+};
+
+#define HLDB_ENTRIES (sizeof(HLDB) / sizeof(HLDB[0]))
+
+/*------------------------------------------
+                  LEXER
+ ------------------------------------------*/
+// Scratch span list reused by every lexer run
+static hl_span_t *g_spans = NULL;
+static int g_spans_len = 0;
+static int g_spans_cap = 0;
+
+static bool is_separator(int c) {
+  return isspace(c) || c == '\0' || strchr(",.()+-/*=~%<>[];{}&|!^?:", c) != NULL;
+}
+
+/**
+ * @brief Push a span to the scratch list (merging it with the previous one if possible).
+ *
+ * @param start Start byte offset.
+ * @param len   Length in bytes.
+ * @param hl    Highlight class.
+ */
+static void span_push(int start, int len, unsigned char hl) {
+  if (len <= 0 || hl == HL_NORMAL) return;
+
+  // Run-length: extend the previous span when it is adjacent and of the same class
+  if (g_spans_len > 0) {
+    hl_span_t *last = &g_spans[g_spans_len - 1];
+    if (last->hl == hl && last->start + last->len == start) {
+      last->len += len;
+      return;
+    }
+  }
+
+  if (g_spans_len == g_spans_cap) {
+    int cap = g_spans_cap ? g_spans_cap * 2 : 16;
+    hl_span_t *new = zilo_realloc(MEM_SYNTAX, g_spans, sizeof(hl_span_t) * cap);
+    if (!new) {
+      LOG_ERROR("realloc", "Failed to expand highlight spans.");
+      return;
+    }
+    g_spans = new;
+    g_spans_cap = cap;
+  }
+
+  g_spans[g_spans_len ++] = (hl_span_t){ start, len, hl };
+}
+
+/**
+ * @brief Find `needle` in `s[from, size)`.
+ *
+ * @return Returns the offset of the match, or -1.
+ */
+static int find_token(const char *s, int size, int from, const char *needle) {
+  int nlen = strlen(needle);
+  for (int i = from; i + nlen <= size; ++ i) {
+    if (s[i] == needle[0] && !strncmp(s + i, needle, nlen)) return i;
+  }
+  return -1;
+}
+
+/**
+ * @brief Scan a string literal starting after its opening quote.
+ *
+ * @param s     Row bytes.
+ * @param size  Row length.
+ * @param i     Offset just after the opening quote.
+ * @param quote Quote character.
+ * @param state Set to HL_STATE_STRING if the line ends inside the string.
+ *
+ * @return Returns the offset just after the closing quote (or `size`).
+ */
+static int scan_string(const char *s, int size, int i, char quote, unsigned char *state) {
+  while (i < size) {
+    if (s[i] == '\\') {
+      // A trailing backslash continues the string on the next line
+      if (i + 1 == size) {
+        if (quote == '"') *state = HL_STATE_STRING;
+        return size;
+      }
+      i += 2;
+      continue;
+    }
+    if (s[i] == quote) return i + 1;
+    i ++;
+  }
+  return size;
+}
+
+/**
+ * @brief Lex one row and store its spans and end-of-line state.
+ *
+ * @param row         Row object.
+ * @param start_state End-of-line state of the previous row.
+ */
+static void editor_lex_row(erow_t *row, unsigned char start_state) {
+  const editor_syntax_t *syn = E.syntax;
+  // A compressed row is lexed from the block cache for its end state only
+  const char *s = row->is_cold ? editor_cold_bytes(row) : editor_row_chars(row);
+  int size = row->size;
+  if (row->is_cold && !s) return;
+
+  const char *scs = syn->singleline_comment_start;
+  const char *mcs = syn->multiline_comment_start;
+  const char *mce = syn->multiline_comment_end;
+  int scs_len = scs ? strlen(scs) : 0;
+  int mcs_len = mcs ? strlen(mcs) : 0;
+  int mce_len = mce ? strlen(mce) : 0;
+
+  unsigned char state = start_state;
+  bool prev_sep = true;
+  int i = 0;
+
+  g_spans_len = 0;
+
+  // Long rows are not highlighted and pass the state through unchanged
+  if (row->ll) size = 0;
+
+  // Continue the construct left open by the previous row
+  if (state == HL_STATE_COMMENT) {
+    int end = mce_len ? find_token(s, size, 0, mce) : -1;
+    if (end == -1) {
+      span_push(0, size, HL_COMMENT);
+      i = size;
+    } else {
+      span_push(0, end + mce_len, HL_COMMENT);
+      i = end + mce_len;
+      state = HL_STATE_NORMAL;
+    }
+  } else if (state == HL_STATE_STRING) {
+    state = HL_STATE_NORMAL;
+    int end = scan_string(s, size, 0, '"', &state);
+    span_push(0, end, HL_STRING);
+    i = end;
+  }
+
+  while (i < size) {
+    char c = s[i];
+
+    // Single-line comment: the rest of the row
+    if (scs_len && !strncmp(s + i, scs, scs_len)) {
+      span_push(i, size - i, HL_COMMENT);
+      break;
+    }
+
+    // Multi-line comment
+    if (mcs_len && !strncmp(s + i, mcs, mcs_len)) {
+      int end = find_token(s, size, i + mcs_len, mce);
+      if (end == -1) {
+        span_push(i, size - i, HL_COMMENT);
+        state = HL_STATE_COMMENT;
+        break;
+      }
+      span_push(i, end + mce_len - i, HL_COMMENT);
+      i = end + mce_len;
+      prev_sep = true;
+      continue;
+    }
+
+    // String and character literals
+    if ((syn->flags & HL_HIGHLIGHT_STRINGS) && (c == '"' || c == '\'')) {
+      int end = scan_string(s, size, i + 1, c, &state);
+      span_push(i, end - i, HL_STRING);
+      i = end;
+      prev_sep = true;
+      continue;
+    }
+
+    // Preprocessor directive (only the `#word` token)
+    if ((syn->flags & HL_HIGHLIGHT_PREPROC) && c == '#' && prev_sep) {
+      int j = i + 1;
+      while (j < size && (isalnum((unsigned char)s[j]) || s[j] == '_')) j ++;
+      span_push(i, j - i, HL_PREPROC);
+      i = j;
+      prev_sep = false;
+      continue;
+    }
+
+    // Numbers (decimal, hex, float, suffixes)
+    if ((syn->flags & HL_HIGHLIGHT_NUMBERS) && prev_sep && isdigit((unsigned char)c)) {
+      int j = i + 1;
+      while (j < size && (isalnum((unsigned char)s[j]) || s[j] == '.')) j ++;
+      span_push(i, j - i, HL_NUMBER);
+      i = j;
+      prev_sep = false;
+      continue;
+    }
+
+    // Identifiers and keywords
+    if (prev_sep && (isalpha((unsigned char)c) || c == '_')) {
+      int j = i + 1;
+      while (j < size && (isalnum((unsigned char)s[j]) || s[j] == '_')) j ++;
+
+      if (syn->keywords) {
+        for (int k = 0; syn->keywords[k]; ++ k) {
+          const char *kw = syn->keywords[k];
+          int klen = strlen(kw);
+          bool kw2 = kw[klen - 1] == '|';
+          if (kw2) klen --;
+
+          if (klen == j - i && !strncmp(s + i, kw, klen)) {
+            span_push(i, klen, kw2 ? HL_KEYWORD2 : HL_KEYWORD1);
+            break;
+          }
+        }
+      }
+
+      i = j;
+      prev_sep = false;
+      continue;
+    }
+
+    prev_sep = is_separator((unsigned char)c);
+    i ++;
+  }
+
+  if (row->is_cold) {
+    row->hl_state = state;
+    return;
+  }
+
+  // Store the spans on the row (exact size, freed when empty)
+  if (g_spans_len != row->hl_count) {
+    hl_span_t *new = NULL;
+    if (g_spans_len > 0) {
+      new = zilo_realloc(MEM_SYNTAX, row->hl, sizeof(hl_span_t) * g_spans_len);
+      if (!new) {
+        LOG_ERROR("realloc", "Failed to store highlight spans.");
+        return;
+      }
+    } else {
+      zilo_free(MEM_SYNTAX, row->hl);
+    }
+    row->hl = new;
+    row->hl_count = g_spans_len;
+  }
+  if (g_spans_len > 0) memcpy(row->hl, g_spans, sizeof(hl_span_t) * g_spans_len);
+
+  row->hl_state = state;
+}
+
+/**
+ * @brief Re-lex rows starting at `at` until the end-of-line state converges.
+ *
+ * A row's spans only depend on its own bytes and the end-of-line state of the
+ * previous row, so once a re-lexed row ends in the same state as before, every
+ * row below it is still valid.
+ *
+ * @param at The first row whose content (or start state) changed.
+ *
+ * @return Returns the number of rows that were lexed.
+ */
+int editor_update_syntax(int at) {
+  if (!E.syntax) return 0;
+  if (at < 0) at = 0;
+
+  int lexed = 0;
+  for (int i = at; i < E.numrows; ++ i) {
+    // A page that is out is lexed whole when it is read back
+    erow_t *row = editor_row_peek(i);
+    if (!row) break;
+    unsigned char old_state = row->hl_state;
+    unsigned char start_state = i > 0 ? editor_row_end_state(i - 1) : HL_STATE_NORMAL;
+
+    editor_lex_row(row, start_state);
+    lexed ++;
+
+    if (row->hl_state == old_state) break;
+  }
+
+  return lexed;
+}
+
+/**
+ * @brief Re-lex every row in memory (used after the language changes); the
+ *        pages that are out are lexed when they are read back.
+ */
+void editor_update_syntax_all(void) {
+  for (int i = 0; i < E.numrows; ++ i) {
+    erow_t *row = editor_row_peek(i);
+    if (!row) {
+      i = editor_row_page_end(i) - 1;
+      continue;
+    }
+    if (!E.syntax) {
+      zilo_free(MEM_SYNTAX, row->hl);
+      row->hl = NULL;
+      row->hl_count = 0;
+      row->hl_state = HL_STATE_UNKNOWN;
+      continue;
+    }
+    editor_lex_row(row, i > 0 ? editor_row_end_state(i - 1) : HL_STATE_NORMAL);
+  }
+}
+
+/**
+ * @brief Select the language for E.filename.
+ *
+ * Patterns starting with '.' are matched against the file extension,
+ * anything else against the base name.
+ */
+void editor_select_syntax(void) {
+  E.syntax = NULL;
+  if (!E.filename) return;
+
+  const char *base = strrchr(E.filename, '/');
+  base = base ? base + 1 : E.filename;
+  const char *ext = strrchr(base, '.');
+
+  for (unsigned int j = 0; j < HLDB_ENTRIES; ++ j) {
+    const editor_syntax_t *s = &HLDB[j];
+    for (int i = 0; s->filematch[i]; ++ i) {
+      const char *pat = s->filematch[i];
+      bool is_ext = pat[0] == '.';
+      if ((is_ext && ext && !strcmp(ext, pat)) ||
+          (!is_ext && !strcmp(base, pat))) {
+        E.syntax = s;
+        editor_update_syntax_all();
+        return;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Return the SGR color code of a highlight class.
+ *
+ * @param hl Highlight class.
+ */
+int editor_syntax_to_color(int hl) {
+  switch (hl) {
+    case HL_COMMENT:  return 36;  // Cyan
+    case HL_KEYWORD1: return 33;  // Yellow
+    case HL_KEYWORD2: return 32;  // Green
+    case HL_STRING:   return 35;  // Magenta
+    case HL_NUMBER:   return 31;  // Red
+    case HL_PREPROC:  return 34;  // Blue
+    default:          return HL_DEFAULT_COLOR;
+  }
+}
@@ -1,7 +1,10 @@
+#define ZILO_LOG_MODULE LOG_MODULE_INPUT
 #include "terminal.h"
 #include "logger.h"
 #include "zilo.h"
 #include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -101,6 +104,28 @@ char editor_readkey(void) {
   return c;
 }
 
+/**
+ * @brief Wait until a key can be read or one of `fds` becomes readable.
+ *
+ * @param fds  Extra descriptors to watch (negative ones are ignored).
+ * @param nfds Number of descriptors (at most EDITOR_WAIT_FDS).
+ *
+ * @return Returns true if a key is waiting on standard input.
+ */
+bool editor_wait_input(const int *fds, int nfds) {
+  struct pollfd pfds[1 + EDITOR_WAIT_FDS] = { { .fd = STDIN_FILENO, .events = POLLIN } };
+  if (nfds > EDITOR_WAIT_FDS) nfds = EDITOR_WAIT_FDS;
+  for (int i = 0; i < nfds; ++ i) pfds[1 + i] = (struct pollfd){ .fd = fds[i], .events = POLLIN };
+
+  while (poll(pfds, 1 + nfds, -1) == -1) {
+    if (errno != EINTR) {
+      LOG_ERROR("poll", "Failed to wait for input.");
+      return true;
+    }
+  }
+  return pfds[0].revents != 0;
+}
+
 /**
  * @brief Get the window size of terminal.
  *
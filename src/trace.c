@@ -0,0 +1,180 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "trace.h"
+#include "logger.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Every thread records its spans into its own buffer (no locking on the
+ * record path); buffers are linked into a global list the first time a
+ * thread records something. A buffer is a ring: when it is full the oldest
+ * spans are overwritten.
+ */
+
+// Spans kept per thread (power of two)
+#define TRACE_BUFFER_EVENTS (1 << 16)
+
+typedef struct {
+  const char *name;
+  int64_t start_ns;
+  int64_t dur_ns;
+} trace_event_t;
+
+typedef struct trace_buffer {
+  trace_event_t *events;
+  atomic_size_t count;        // Spans ever recorded
+  int tid;                    // Small per-process thread number
+  struct trace_buffer *next;
+} trace_buffer_t;
+
+bool zilo_trace_enabled = false;
+
+static char *g_trace_path = NULL;
+static int64_t g_trace_origin_ns = 0;
+
+static trace_buffer_t *g_buffers = NULL;
+static int g_next_tid = 1;
+static pthread_mutex_t g_buffers_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread trace_buffer_t *t_buffer = NULL;
+
+/**
+ * @brief Monotonic clock in nanoseconds.
+ */
+int64_t zilo_trace_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Create the calling thread's buffer and link it into the list.
+ */
+static trace_buffer_t *trace_register(void) {
+  trace_buffer_t *buf = calloc(1, sizeof(trace_buffer_t));
+  if (!buf) return NULL;
+  buf->events = malloc(sizeof(trace_event_t) * TRACE_BUFFER_EVENTS);
+  if (!buf->events) {
+    free(buf);
+    return NULL;
+  }
+  atomic_init(&buf->count, 0);
+
+  pthread_mutex_lock(&g_buffers_lock);
+  buf->tid = g_next_tid ++;
+  buf->next = g_buffers;
+  g_buffers = buf;
+  pthread_mutex_unlock(&g_buffers_lock);
+
+  t_buffer = buf;
+  return buf;
+}
+
+/**
+ * @brief Record a finished span into the calling thread's buffer.
+ *
+ * @param name     Span name (string literal).
+ * @param start_ns Start time (zilo_trace_now()).
+ * @param end_ns   End time.
+ */
+void zilo_trace_record(const char *name, int64_t start_ns, int64_t end_ns) {
+  if (!zilo_trace_enabled) return;
+
+  trace_buffer_t *buf = t_buffer ? t_buffer : trace_register();
+  if (!buf) return;
+
+  size_t n = atomic_load_explicit(&buf->count, memory_order_relaxed);
+  buf->events[n & (TRACE_BUFFER_EVENTS - 1)] = (trace_event_t){ name, start_ns, end_ns - start_ns };
+  atomic_store_explicit(&buf->count, n + 1, memory_order_release);
+}
+
+/**
+ * @brief Start tracing if ZILO_TRACE=path is set.
+ */
+void zilo_trace_init(void) {
+  const char *path = getenv("ZILO_TRACE");
+  if (!path || !*path) return;
+
+  g_trace_path = malloc(strlen(path) + 1);
+  if (!g_trace_path) return;
+  strcpy(g_trace_path, path);
+
+  g_trace_origin_ns = zilo_trace_now();
+  zilo_trace_enabled = true;
+  LOG_INFO("zilo_trace_init", "Tracing to <%s>.", g_trace_path);
+}
+
+/**
+ * @brief Write every recorded span to the trace file.
+ *
+ * The file is rewritten in the Chrome trace event format ("X" complete
+ * events, microseconds), which chrome://tracing and Perfetto load directly.
+ *
+ * @return Returns the number of spans written, or -1 on error.
+ */
+int zilo_trace_dump(void) {
+  if (!g_trace_path) return -1;
+
+  FILE *fp = fopen(g_trace_path, "w");
+  if (!fp) {
+    LOG_ERROR("fopen", "Failed to open the trace file <%s>.", g_trace_path);
+    return -1;
+  }
+
+  int pid = getpid();
+  int written = 0;
+  fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+  pthread_mutex_lock(&g_buffers_lock);
+  for (trace_buffer_t *buf = g_buffers; buf; buf = buf->next) {
+    fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                "\"args\":{\"name\":\"%s\"}}",
+            written ? ",\n" : "", pid, buf->tid, buf->tid == 1 ? "main" : "worker");
+    written ++;
+
+    size_t count = atomic_load_explicit(&buf->count, memory_order_acquire);
+    size_t first = count > TRACE_BUFFER_EVENTS ? count - TRACE_BUFFER_EVENTS : 0;
+    for (size_t i = first; i < count; ++ i) {
+      trace_event_t *ev = &buf->events[i & (TRACE_BUFFER_EVENTS - 1)];
+      fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"zilo\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+                  "\"ts\":%.3f,\"dur\":%.3f}",
+              ev->name, pid, buf->tid,
+              (ev->start_ns - g_trace_origin_ns) / 1000.0,
+              ev->dur_ns / 1000.0);
+      written ++;
+    }
+  }
+  pthread_mutex_unlock(&g_buffers_lock);
+
+  fprintf(fp, "\n]}\n");
+  fclose(fp);
+  return written;
+}
+
+/**
+ * @brief Dump the trace and stop tracing.
+ */
+void zilo_trace_close(void) {
+  if (!zilo_trace_enabled) return;
+
+  zilo_trace_dump();
+  zilo_trace_enabled = false;
+
+  pthread_mutex_lock(&g_buffers_lock);
+  while (g_buffers) {
+    trace_buffer_t *next = g_buffers->next;
+    free(g_buffers->events);
+    free(g_buffers);
+    g_buffers = next;
+  }
+  pthread_mutex_unlock(&g_buffers_lock);
+  t_buffer = NULL;
+
+  free(g_trace_path);
+  g_trace_path = NULL;
+}
@@ -0,0 +1,469 @@
+#define ZILO_LOG_MODULE LOG_MODULE_RENDER
+#include "wrap.h"
+#include "logger.h"
+#include "mem.h"
+#include "page.h"
+#include "row.h"
+#include "zilo.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*------------------------------------------
+              ROW SEGMENTS
+ ------------------------------------------*/
+/*
+ * Long rows (see lline.h) are cut on a fixed grid of E.screencols columns so
+ * that any visual line can be found in O(log n) without walking the row:
+ * visual line `sub` shows the columns [sub * W, (sub + 1) * W) and starts
+ * with the first character beginning in that range. A tab or wide character
+ * cut by the grid is drawn as blanks.
+ */
+static int long_segment_start(const erow_t *row, int sub) {
+  int col = sub * MAX(E.screencols, 1);
+  int cx = editor_row_rx_to_cx(row, col);
+  if (cx < row->size && editor_row_cx_to_rx(row, cx) < col) cx = editor_row_next_char(row, cx);
+  return cx;
+}
+
+/**
+ * @brief Byte offset where the visual line starting at `cx` ends.
+ *
+ * The next visual line starts with the character covering display column
+ * `start + width`; a wide character or tab that does not fit is moved to
+ * the next line instead of being cut.
+ *
+ * @param row Row object.
+ * @param cx  Byte offset of the first character of the visual line.
+ */
+int editor_wrap_segment_end(const erow_t *row, int cx) {
+  int width = MAX(E.screencols, 1);
+  int end = row->ll
+            ? long_segment_start(row, editor_row_cx_to_rx(row, cx) / width + 1)
+            : editor_row_rx_to_cx(row, editor_row_cx_to_rx(row, cx) + width);
+
+  // A single character wider than the screen still takes one line
+  if (end <= cx) end = editor_row_next_char(row, cx);
+  return end;
+}
+
+/**
+ * @brief Byte offset where visual line `sub` of the row starts.
+ *
+ * @param row Row object.
+ * @param sub Visual line inside the row.
+ */
+int editor_wrap_segment_start(const erow_t *row, int sub) {
+  if (row->ll) return long_segment_start(row, sub);
+
+  int cx = 0;
+  for (int i = 0; i < sub && cx < row->size; ++ i) {
+    cx = editor_wrap_segment_end(row, cx);
+  }
+  return cx;
+}
+
+/**
+ * @brief Visual line of the row that contains `cx`.
+ *
+ * @param row       Row object.
+ * @param cx        Byte offset.
+ * @param seg_start Set to the byte offset where that visual line starts.
+ */
+int editor_wrap_segment_of(const erow_t *row, int cx, int *seg_start) {
+  int sub = 0;
+  int start = 0;
+
+  if (row->ll) {
+    int width = MAX(E.screencols, 1);
+    int total = editor_row_cx_to_rx(row, row->size);
+    sub = MIN(editor_row_cx_to_rx(row, cx) / width, MAX(total - 1, 0) / width);
+    start = long_segment_start(row, sub);
+  }
+
+  while (!row->ll && start < row->size) {
+    int end = editor_wrap_segment_end(row, start);
+    // The end of the row belongs to the last visual line
+    if (cx < end || end >= row->size) break;
+    start = end;
+    sub ++;
+  }
+
+  if (seg_start) *seg_start = start;
+  return sub;
+}
+
+/**
+ * @brief Display column of the row shown at the left edge of a visual line.
+ *
+ * @param row Row object.
+ * @param sub Visual line inside the row.
+ * @param seg Byte offset where that visual line starts.
+ */
+int editor_wrap_segment_col(const erow_t *row, int sub, int seg) {
+  if (row->ll) return sub * MAX(E.screencols, 1);
+  return editor_row_cx_to_rx(row, seg);
+}
+
+/**
+ * @brief Count the visual lines of a row (at least one, even when empty).
+ */
+static int row_count_lines(const erow_t *row) {
+  if (row->ll) {
+    int width = MAX(E.screencols, 1);
+    int total = editor_row_cx_to_rx(row, row->size);
+    return MAX(total - 1, 0) / width + 1;
+  }
+
+  int lines = 1;
+  int cx = 0;
+  while (cx < row->size) {
+    cx = editor_wrap_segment_end(row, cx);
+    if (cx < row->size) lines ++;
+  }
+  return lines;
+}
+
+/*------------------------------------------
+        PREFIX SUMS (FENWICK TREES)
+ ------------------------------------------*/
+/*
+ * The counts are kept in blocks of WRAP_BLOCK_ROWS to 2 * WRAP_BLOCK_ROWS
+ * consecutive rows. Two Fenwick trees over the blocks hold their row and
+ * visual-line totals, so a row or a visual line is found by a descent over
+ * the blocks and a scan inside one block. Inserting or deleting a row moves
+ * the counts of its block only; the trees are rebuilt (O(n / block), no
+ * row measured) when a block splits or empties.
+ */
+
+// A run of consecutive rows of the index
+typedef struct wrap_block {
+  int n;      // Rows
+  int sum;    // Their visual lines
+  int lines[2 * WRAP_BLOCK_ROWS];
+} wrap_block_t;
+
+/**
+ * @brief Add `delta` to entry `b` of a Fenwick tree over the blocks.
+ */
+static void fenwick_add(const wrap_index_t *wi, int *tree, int b, int delta) {
+  for (int k = b + 1; k <= wi->nblocks; k += k & -k) tree[k] += delta;
+}
+
+/**
+ * @brief Sum of entries [0, b) of a Fenwick tree over the blocks.
+ */
+static int fenwick_prefix(const int *tree, int b) {
+  int sum = 0;
+  for (int k = b; k > 0; k -= k & -k) sum += tree[k];
+  return sum;
+}
+
+/**
+ * @brief Find the block holding entry `at` of a Fenwick tree (O(log n) descent).
+ *
+ * @param rem Set to `at` minus the entries of the blocks before it.
+ *
+ * @return Returns the block (`nblocks` if `at` is past the end).
+ */
+static int fenwick_find(const wrap_index_t *wi, const int *tree, int at, int *rem) {
+  int pos = 0;
+  int step = 1;
+  while (step * 2 <= wi->nblocks) step *= 2;
+
+  for (; step > 0; step /= 2) {
+    if (pos + step <= wi->nblocks && tree[pos + step] <= at) {
+      pos += step;
+      at -= tree[pos];
+    }
+  }
+  *rem = at;
+  return pos;
+}
+
+/**
+ * @brief Rebuild both trees from the block totals in O(n / block).
+ */
+static void wrap_rebuild_trees(wrap_index_t *wi) {
+  int nb = wi->nblocks;
+  wi->rows_tree[0] = wi->lines_tree[0] = 0;
+  for (int b = 0; b < nb; ++ b) {
+    wi->rows_tree[b + 1] = wi->blocks[b]->n;
+    wi->lines_tree[b + 1] = wi->blocks[b]->sum;
+  }
+  // Linear-time construction: push every node into its parent once
+  for (int k = 1; k <= nb; ++ k) {
+    int parent = k + (k & -k);
+    if (parent <= nb) {
+      wi->rows_tree[parent] += wi->rows_tree[k];
+      wi->lines_tree[parent] += wi->lines_tree[k];
+    }
+  }
+}
+
+/**
+ * @brief Make room for `n` blocks.
+ *
+ * @return Returns 0 on success, -1 on failure.
+ */
+static int wrap_reserve_blocks(wrap_index_t *wi, int n) {
+  if (n <= wi->blockcap) return 0;
+
+  int cap = MAX(n, wi->blockcap * 2);
+  wrap_block_t **blocks = zilo_realloc(MEM_WRAP, wi->blocks, sizeof(wrap_block_t *) * cap);
+  if (blocks) wi->blocks = blocks;
+  int *rows_tree = zilo_realloc(MEM_WRAP, wi->rows_tree, sizeof(int) * (cap + 1));
+  if (rows_tree) wi->rows_tree = rows_tree;
+  int *lines_tree = zilo_realloc(MEM_WRAP, wi->lines_tree, sizeof(int) * (cap + 1));
+  if (lines_tree) wi->lines_tree = lines_tree;
+  if (!blocks || !rows_tree || !lines_tree) {
+    LOG_ERROR("realloc", "Failed to expand the visual-line index.");
+    return -1;
+  }
+  wi->blockcap = cap;
+  return 0;
+}
+
+/**
+ * @brief Free the blocks of an index (the index is left empty and stale).
+ */
+void editor_wrap_free(wrap_index_t *wi) {
+  for (int b = 0; b < wi->nblocks; ++ b) zilo_free(MEM_WRAP, wi->blocks[b]);
+  zilo_free(MEM_WRAP, wi->blocks);
+  zilo_free(MEM_WRAP, wi->rows_tree);
+  zilo_free(MEM_WRAP, wi->lines_tree);
+  *wi = (wrap_index_t){ .dirty = true };
+}
+
+/**
+ * @brief Rebuild the index from scratch in O(n), measuring every row (only
+ *        when it is stale: wrapping turned on, width changed, rows reloaded).
+ */
+static void wrap_rebuild(void) {
+  wrap_index_t *wi = &E.wrap_index;
+  if (!wi->dirty && wi->width == E.screencols) return;
+
+  editor_wrap_free(wi);
+  int nb = (E.numrows + WRAP_BLOCK_ROWS - 1) / WRAP_BLOCK_ROWS;
+  if (wrap_reserve_blocks(wi, MAX(nb, 1)) == -1) return;
+
+  for (int b = 0; b < nb; ++ b) {
+    wrap_block_t *block = zilo_malloc(MEM_WRAP, sizeof(wrap_block_t));
+    if (!block) {
+      LOG_ERROR("malloc", "Failed to allocate the visual-line index.");
+      editor_wrap_free(wi);
+      return;
+    }
+    block->n = MIN(E.numrows - b * WRAP_BLOCK_ROWS, WRAP_BLOCK_ROWS);
+    block->sum = 0;
+    for (int k = 0; k < block->n; ++ k) {
+      // Pages are read back (and dropped again) on the way
+      erow_t *row = editor_row_scan(b * WRAP_BLOCK_ROWS + k);
+      block->lines[k] = row ? row_count_lines(row) : 1;
+      block->sum += block->lines[k];
+    }
+    wi->blocks[wi->nblocks ++] = block;
+  }
+
+  wi->n = E.numrows;
+  wi->width = E.screencols;
+  wi->dirty = false;
+  wrap_rebuild_trees(wi);
+}
+
+/**
+ * @brief True if the index follows the rows (it is patched, not rebuilt).
+ */
+static bool wrap_maintained(void) {
+  wrap_index_t *wi = &E.wrap_index;
+  if (!E.wrap) wi->dirty = true;   // Not maintained while wrapping is off
+  return !wi->dirty && wi->width == E.screencols && wi->blocks;
+}
+
+/**
+ * @brief Mark the visual-line index stale: it is rebuilt, measuring every
+ *        row, the next time it is queried.
+ */
+void editor_wrap_invalidate(void) {
+  E.wrap_index.dirty = true;
+}
+
+/**
+ * @brief A row was inserted at `at`: shift the counts of its block (one
+ *        visual line until editor_wrap_update_row() measures it).
+ *
+ * @param at Row index.
+ */
+void editor_wrap_insert_row(int at) {
+  wrap_index_t *wi = &E.wrap_index;
+  if (!wrap_maintained()) return;
+  if (at < 0 || at > wi->n) return;
+
+  int k;
+  int b = fenwick_find(wi, wi->rows_tree, at, &k);
+  if (b == wi->nblocks) {
+    // At the end: the last block takes it, or a new one if there is none
+    if (b == 0) {
+      wrap_block_t *block = zilo_malloc(MEM_WRAP, sizeof(wrap_block_t));
+      if (!block) {
+        editor_wrap_invalidate();
+        return;
+      }
+      block->n = block->sum = 0;
+      wi->blocks[wi->nblocks ++] = block;
+      wrap_rebuild_trees(wi);
+    }
+    b = wi->nblocks - 1;
+    k = wi->blocks[b]->n;
+  }
+
+  wrap_block_t *block = wi->blocks[b];
+  memmove(block->lines + k + 1, block->lines + k, sizeof(int) * (block->n - k));
+  block->lines[k] = 1;
+  block->n ++;
+  block->sum ++;
+  wi->n ++;
+  fenwick_add(wi, wi->rows_tree, b, 1);
+  fenwick_add(wi, wi->lines_tree, b, 1);
+
+  // A full block splits in two halves
+  if (block->n < 2 * WRAP_BLOCK_ROWS) return;
+  wrap_block_t *half = wrap_reserve_blocks(wi, wi->nblocks + 1) == 0
+                       ? zilo_malloc(MEM_WRAP, sizeof(wrap_block_t)) : NULL;
+  if (!half) {
+    editor_wrap_invalidate();
+    return;
+  }
+  half->n = block->n - WRAP_BLOCK_ROWS;
+  half->sum = 0;
+  memcpy(half->lines, block->lines + WRAP_BLOCK_ROWS, sizeof(int) * half->n);
+  for (int i = 0; i < half->n; ++ i) half->sum += half->lines[i];
+  block->n = WRAP_BLOCK_ROWS;
+  block->sum -= half->sum;
+
+  memmove(wi->blocks + b + 2, wi->blocks + b + 1, sizeof(wrap_block_t *) * (wi->nblocks - b - 1));
+  wi->blocks[b + 1] = half;
+  wi->nblocks ++;
+  wrap_rebuild_trees(wi);
+}
+
+/**
+ * @brief Row `at` was deleted: drop its count.
+ *
+ * @param at Row index.
+ */
+void editor_wrap_delete_row(int at) {
+  wrap_index_t *wi = &E.wrap_index;
+  if (!wrap_maintained()) return;
+  if (at < 0 || at >= wi->n) return;
+
+  int k;
+  int b = fenwick_find(wi, wi->rows_tree, at, &k);
+  wrap_block_t *block = wi->blocks[b];
+  int lines = block->lines[k];
+  memmove(block->lines + k, block->lines + k + 1, sizeof(int) * (block->n - k - 1));
+  block->n --;
+  block->sum -= lines;
+  wi->n --;
+
+  if (block->n > 0) {
+    fenwick_add(wi, wi->rows_tree, b, -1);
+    fenwick_add(wi, wi->lines_tree, b, -lines);
+    return;
+  }
+
+  // An empty block goes away
+  zilo_free(MEM_WRAP, block);
+  memmove(wi->blocks + b, wi->blocks + b + 1, sizeof(wrap_block_t *) * (wi->nblocks - b - 1));
+  wi->nblocks --;
+  wrap_rebuild_trees(wi);
+}
+
+/**
+ * @brief Refresh the visual-line count of row `at` in O(log n).
+ *
+ * @param at Row index.
+ */
+void editor_wrap_update_row(int at) {
+  wrap_index_t *wi = &E.wrap_index;
+  if (!wrap_maintained()) return;
+  if (at < 0 || at >= wi->n) return;
+
+  int k;
+  int b = fenwick_find(wi, wi->rows_tree, at, &k);
+  wrap_block_t *block = wi->blocks[b];
+  erow_t *row = editor_row_at(at);
+  if (!row) return;
+  int lines = row_count_lines(row);
+  if (lines != block->lines[k]) {
+    fenwick_add(wi, wi->lines_tree, b, lines - block->lines[k]);
+    block->sum += lines - block->lines[k];
+    block->lines[k] = lines;
+  }
+}
+
+/**
+ * @brief Number of visual lines of row `at`.
+ *
+ * @param at Row index.
+ */
+int editor_wrap_row_lines(int at) {
+  wrap_rebuild();
+  wrap_index_t *wi = &E.wrap_index;
+  if (at < 0 || at >= wi->n || !wi->blocks) return 1;
+
+  int k;
+  int b = fenwick_find(wi, wi->rows_tree, at, &k);
+  return wi->blocks[b]->lines[k];
+}
+
+/**
+ * @brief Index of the first visual line of row `at` (O(log n) plus a scan
+ *        inside one block).
+ *
+ * @param at Row index (E.numrows gives the total number of visual lines).
+ */
+int editor_wrap_row_to_line(int at) {
+  wrap_rebuild();
+  wrap_index_t *wi = &E.wrap_index;
+  if (!wi->blocks) return at;
+  if (at >= wi->n) return fenwick_prefix(wi->lines_tree, wi->nblocks);
+
+  int k;
+  int b = fenwick_find(wi, wi->rows_tree, at, &k);
+  int line = fenwick_prefix(wi->lines_tree, b);
+  for (int i = 0; i < k; ++ i) line += wi->blocks[b]->lines[i];
+  return line;
+}
+
+/**
+ * @brief Map a visual line to its row (O(log n) descent plus a scan inside
+ *        one block).
+ *
+ * @param line Visual line index.
+ * @param sub  Set to the visual line inside the returned row.
+ *
+ * @return Returns the row index (E.numrows if `line` is past the end).
+ */
+int editor_wrap_line_to_row(int line, int *sub) {
+  wrap_rebuild();
+  wrap_index_t *wi = &E.wrap_index;
+
+  if (!wi->blocks) {
+    if (sub) *sub = 0;
+    return MIN(line, E.numrows);
+  }
+
+  int rem;
+  int b = fenwick_find(wi, wi->lines_tree, line, &rem);
+  if (b == wi->nblocks) {
+    if (sub) *sub = 0;
+    return wi->n;
+  }
+
+  const wrap_block_t *block = wi->blocks[b];
+  int k = 0;
+  while (k < block->n - 1 && rem >= block->lines[k]) rem -= block->lines[k ++];
+  if (sub) *sub = rem;
+  return fenwick_prefix(wi->rows_tree, b) + k;
+}